@@ -1,17 +1,28 @@
 #include "application.h"
 #include "colors.h"
 #include "version.h"
+#include <algorithm>
+
+Application::Application(Bsp &bsp) : mBsp(bsp), mLeds(*mBsp.leds), mAnimator(mLeds, cFramePeriod),
+                                     mChannelsSettings(*mBsp.extFlash, cChannelsSettingsAddress, cLegacyChannelsSettingsAddress,
+                                                       cLegacyChannels * sizeof(ControlChannelSettingsV1), migrateChannelsSettings),
+                                     mUserSettings(*mBsp.extFlash, cUserSettingsAddress, cLegacyUserSettingsAddress),
+                                     mEventLog(*mBsp.extFlash, cEventLogAddress, cEventLogSectors),
+                                     mSampleLog(*mBsp.extFlash, cSampleLogAddress, cSampleLogSectors), mLastSampleTime(0),
+                                     mLoadWindowStart(getTime()), mLoadWindowIdle(getIdleTime()), mIdle(1000), mMinIdle(1000),
+                                     mTestSwitch(*mBsp.testSwitch, getTime, cDebounceTime),
+                                     mLdgSwitch(*mBsp.ldgSwitch, getTime, cDebounceTime),
+                                     mRudSwitch(*mBsp.rudSwitch, getTime, cDebounceTime),
+                                     mSwitchChanged(false), mSwitchChangeTime(0),
+                                     mExpanderChanged(false), mLastInputsRefresh(0) {
+    // The channels move to the bus of their settings in applyChannelSettings()
+    for (ControlChannel &channel : mChannels) {
+        channel.setBus(*mBsp.i2cBuses[0]);
+    }
 
-Application::Application(Bsp &bsp) : mBsp(bsp), mLeds(*mBsp.leds),
-                                     mChannels{ControlChannel(*mBsp.i2cBus),
-                                               ControlChannel(*mBsp.i2cBus),
-                                               ControlChannel(*mBsp.i2cBus),
-                                               ControlChannel(*mBsp.i2cBus),
-                                               ControlChannel(*mBsp.i2cBus),
-                                               ControlChannel(*mBsp.i2cBus)},
-                                     mChannelsSettings(*mBsp.extFlash, 4096), mUserSettings(*mBsp.extFlash, 0) {
     mProtocol.registerCmd('v', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->sendAppVersion(in, out, outlen); });
     mProtocol.registerCmd('r', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->resetDevice(in, out, outlen); });
+    mProtocol.registerCmd('B', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->enterBootloader(in, out, outlen); });
     mProtocol.registerCmd('s', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->scanI2cDevices(in, out, outlen); });
     mProtocol.registerCmd('u', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->sendUserSettings(in, out, outlen); });
     mProtocol.registerCmd('U', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->updateUserSettings(in, out, outlen); });
@@ -19,6 +30,38 @@ Application::Application(Bsp &bsp) : mBsp(bsp), mLeds(*mBsp.leds),
     mProtocol.registerCmd('C', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->updateChannelSettings(in, out, outlen); });
     mProtocol.registerCmd('m', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->sendMonitoringData(in, out, outlen); });
     mProtocol.registerCmd('t', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->setTestChannel(in, out, outlen); });
+    mProtocol.registerCmd('W', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->commitSettings(in, out, outlen); });
+    mProtocol.registerCmd('e', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->sendEventLog(in, out, outlen); });
+    mProtocol.registerCmd('a', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->sendSampleLog(in, out, outlen); });
+    mProtocol.registerCmd('M', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->sendMemoryUsage(in, out, outlen); });
+    mProtocol.registerCmd('p', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->sendProfile(in, out, outlen); });
+    mProtocol.registerCmd('i', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->sendIdleStats(in, out, outlen); });
+    mProtocol.registerCmd('n', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->sendDeviceInfo(in, out, outlen); });
+    mProtocol.registerCmd('S', [this](const InProtocolData &in, OutProtocolData &out, size_t &outlen) { return this->updateI2cSpeed(in, out, outlen); });
+
+    // The logs occupy the flash up to the end of the sample log, a smaller chip would wrap them onto the settings
+    uint32_t logsEnd = cSampleLogAddress + cSampleLogSectors * mBsp.extFlash->getSectorSize();
+    mLogsEnabled = mBsp.extFlash->getCapacity() >= logsEnd;
+    if (!mLogsEnabled) {
+        LOG << "External flash smaller than " << logsEnd << " B, logs disabled";
+    }
+
+    for (size_t i = 0; i < NO_CHANNELS; ++i) {
+        mChannelLog[i] = {};
+        mChannelLog[i].state = cUnknownState;
+    }
+    logEvent(EventType::BOOT, cNoChannel);
+
+    mBsp.ledTimer->registerCallback([this]() {
+        Profiler<ZONE_COUNT>::Scope<ZONE_LED> zone(this->mProfiler);
+        this->mAnimator.tick();
+    });
+    mBsp.ledTimer->start(1000 / cFramePeriod);
+
+    mTestSwitch.attach();
+    mLdgSwitch.attach();
+    mRudSwitch.attach();
+    mBsp.expanderInt->registerEdgeCallback([this]() { this->mExpanderChanged = true; });
 
     loadSettings();
     setBrightness();
@@ -37,24 +80,59 @@ bool waitForPushRelease(uint32_t time_ms, IGpio &pin, bool expectedState) {
 }
 
 void Application::spin() {
-    if (!mBsp.testSwitch->get()) {
+    mAnimator.setBrightness(mUserSettings.get().brightness);
+
+    uint32_t time = getTime();
+    processSwitches(time);
+    if (!mTestSwitch.get()) {
         testSwitchProcedure();
         sleep(10);
         return;
     }
 
-    uint32_t time = getTime();
-    bool ldgGearSwitchState = getLdgGearSwitch();
-    bool rudderSwitchState = getRudderSwitch();
+    updateIdleStats(time);
+    {
+        Profiler<ZONE_COUNT>::Scope<ZONE_LOOP> loop(mProfiler);
+        bool ldgGearSwitchState = getLdgGearSwitch();
+        bool rudderSwitchState = getRudderSwitch();
+        refreshChannelInputs(time);
 
-    for (size_t channel = 0; channel < NO_CHANNELS; ++channel) {
-        processChannel(channel, rudderSwitchState, ldgGearSwitchState, time);
-    }
+        for (size_t channel = 0; channel < NO_CHANNELS; ++channel) {
+            Profiler<ZONE_COUNT>::Scope<ZONE_CHANNEL> zone(mProfiler);
+            processChannel(channel, rudderSwitchState, ldgGearSwitchState, time);
+        }
+        recordSwitchLatency(getTime());
 
-    mLeds.update();
+        Profiler<ZONE_COUNT>::Scope<ZONE_FLASH> zone(mProfiler);
+        mUserSettings.commitIfIdle(getTime(), cSettingsCommitDelay);
+        mChannelsSettings.commitIfIdle(getTime(), cSettingsCommitDelay);
+    }
 
-    handleUartCommunication();
-    sleep(100);
+    // Serve commands while waiting for the next iteration, so back-to-back requests
+    // such as an event log download are not paced by the control loop. A switch change
+    // or a limit switch change signalled by the expanders ends the wait, their interrupts
+    // wake the CPU from sleep.
+    uint32_t idleStart = getTime();
+    while (getTime() - idleStart < cLoopDelay) {
+        if (processSwitches(getTime()) || mExpanderChanged) {
+            break;
+        }
+        {
+            Profiler<ZONE_COUNT>::Scope<ZONE_SAMPLE> zone(mProfiler);
+            sampleChannels(getTime());
+        }
+        {
+            Profiler<ZONE_COUNT>::Scope<ZONE_FLASH> zone(mProfiler);
+            mBsp.extFlash->process();
+            if (mLogsEnabled) {
+                mEventLog.process();
+                mSampleLog.process();
+            }
+        }
+        if (!handleUartCommunication()) {
+            sleep(1);
+        }
+    }
 }
 
 bool Application::sendAppVersion(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
@@ -70,8 +148,18 @@ bool Application::resetDevice(const InProtocolData &in, OutProtocolData &out, si
     return true;
 }
 
+bool Application::enterBootloader(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
+    LOG << "Entering bootloader";
+    UartStream::getInstance()->flush();
+    mBsp.resetToBootloader();
+    return true;
+}
+
 bool Application::scanI2cDevices(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
-    bool result = mBsp.i2cBus->isDeviceReady(in.i2cScan.i2cAddress);
+    if (in.i2cScan.bus >= Bsp::cI2cBusCount) {
+        return false;
+    }
+    bool result = mBsp.i2cBuses[in.i2cScan.bus]->isDeviceReady(in.i2cScan.i2cAddress);
     if(result) {
         LOG << "Found I2C device:" << in.i2cScan.i2cAddress;
     }
@@ -87,9 +175,11 @@ bool Application::sendUserSettings(const InProtocolData &in, OutProtocolData &ou
 }
 
 bool Application::updateUserSettings(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
-    mUserSettings.get() = in.userSettings;
-    bool result = mUserSettings.save();
-    out.result = result;
+    if (memcmp(&mUserSettings.get(), &in.userSettings, sizeof(UserSettings)) != 0) {
+        mUserSettings.get() = in.userSettings;
+        mUserSettings.markDirty(getTime());
+    }
+    out.result = true;
     outlen = sizeof(out.result);
     return true;
 }
@@ -110,18 +200,30 @@ bool Application::updateChannelSettings(const InProtocolData &in, OutProtocolDat
     if(channel>=NO_CHANNELS) {
         return false;
     }
-    mChannelsSettings.get().channelSettings[channel] = in.controlChannelSettings.settings;
-    bool result = mChannelsSettings.save();
+    ControlChannelSettings &settings = mChannelsSettings.get().channelSettings[channel];
+    if (memcmp(&settings, &in.controlChannelSettings.settings, sizeof(settings)) != 0) {
+        settings = in.controlChannelSettings.settings;
+        mChannelsSettings.markDirty(getTime());
+        applyChannelSettings(channel);
+    }
+    out.result = true;
+    outlen = sizeof(out.result);
+    return true;
+}
+
+bool Application::commitSettings(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
+    bool result = mUserSettings.commit();
+    result &= mChannelsSettings.commit();
     out.result = result;
     outlen = sizeof(out.result);
-    for (size_t i = 0; i < NO_CHANNELS; ++i) {
-        mChannels[i].setSettings(mChannelsSettings.get().channelSettings[i]);
-    }
     return true;
 }
 
 bool Application::sendMonitoringData(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
     uint8_t channel_id = in.channel_id;
+    if (channel_id >= NO_CHANNELS) {
+        return false;
+    }
     uint16_t current=0, voltage=0;
     mChannels[channel_id].getPowerSensorStatus(voltage, current);
     out.monitoringData.current = current;
@@ -132,7 +234,10 @@ bool Application::sendMonitoringData(const InProtocolData &in, OutProtocolData &
 }
 
 bool Application::setTestChannel(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
-    ControlChannel testChannel(*mBsp.i2cBus.get());
+    if (in.channelTest.bus >= Bsp::cI2cBusCount) {
+        return false;
+    }
+    ControlChannel testChannel(*mBsp.i2cBuses[in.channelTest.bus]);
     ControlChannelSettings settings = {};
     settings.enable = true;
     settings.ina_addr = in.channelTest.ina_addr;
@@ -148,12 +253,244 @@ bool Application::setTestChannel(const InProtocolData &in, OutProtocolData &out,
     return true;
 }
 
+bool Application::sendEventLog(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
+    if (!mLogsEnabled) {
+        return false;
+    }
+    uint32_t first = mEventLog.getFirst();
+    uint32_t next = mEventLog.getNext();
+    uint32_t seq = in.eventLogSeq;
+    if (seq - first >= next - first) {
+        seq = first;
+    }
+
+    // Bound the number of skipped records, so a corrupted region does not stall the loop
+    uint8_t count = 0;
+    for (size_t i = 0; i < 2 * cEventLogRecordsPerFrame && count < cEventLogRecordsPerFrame && seq != next; ++i, ++seq) {
+        if (mEventLog.read(seq, out.eventLog.records[count].record)) {
+            out.eventLog.records[count].seq = seq;
+            count++;
+        } else if (mBsp.extFlash->isBusy()) {
+            // The flash could not be read yet, continue with this record in the next request
+            break;
+        }
+    }
+
+    out.eventLog.first = first;
+    out.eventLog.next = next;
+    out.eventLog.cont = seq;
+    out.eventLog.count = count;
+    outlen = sizeof(out.eventLog);
+    return true;
+}
+
+bool Application::sendSampleLog(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
+    if (!mLogsEnabled) {
+        return false;
+    }
+    uint32_t first = mSampleLog.getFirst();
+    uint32_t next = mSampleLog.getNext();
+    uint32_t seq = in.sampleLogSeq;
+    if (seq - first >= next - first) {
+        seq = first;
+    }
+
+    out.sampleLog.valid = false;
+    for (size_t i = 0; i < 4 && seq != next; ++i, ++seq) {
+        out.sampleLog.valid = mSampleLog.read(seq, out.sampleLog.block);
+        if (out.sampleLog.valid) {
+            seq++;
+            break;
+        }
+        if (mBsp.extFlash->isBusy()) {
+            // The flash could not be read yet, continue with this block in the next request
+            break;
+        }
+    }
+
+    out.sampleLog.first = first;
+    out.sampleLog.next = next;
+    out.sampleLog.cont = seq;
+    outlen = sizeof(out.sampleLog);
+    return true;
+}
+
+bool Application::sendMemoryUsage(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
+    UartStream *stream = UartStream::getInstance();
+    out.memoryUsage.staticSize = mStackMonitor.getStaticSize();
+    out.memoryUsage.stackSize = mStackMonitor.getStackSize();
+    out.memoryUsage.stackPeak = mStackMonitor.getPeak();
+    out.memoryUsage.txSize = stream->getTxBufferSize();
+    out.memoryUsage.txPeak = stream->getTxPeak();
+    out.memoryUsage.rxSize = stream->getRxBufferSize();
+    out.memoryUsage.rxPeak = stream->getRxPeak();
+    outlen = sizeof(out.memoryUsage);
+    return true;
+}
+
+bool Application::sendProfile(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
+    if (in.profile.zone >= ZONE_COUNT) {
+        return false;
+    }
+
+    ProfileStats stats = mProfiler.getStats(in.profile.zone);
+    out.profile.frequency = ProfileClock::frequency();
+    out.profile.count = stats.count;
+    out.profile.min = stats.min;
+    out.profile.max = stats.max;
+    out.profile.average = stats.average();
+    memcpy(out.profile.histogram, stats.histogram, sizeof(out.profile.histogram));
+    out.profile.zones = ZONE_COUNT;
+    out.profile.zone = in.profile.zone;
+    static_assert(sizeof(out.profile) == 40, "The PC decodes the profile including its 2 bytes of tail padding");
+    outlen = sizeof(out.profile);
+
+    if (in.profile.reset) {
+        mProfiler.reset();
+    }
+    return true;
+}
+
+bool Application::sendDeviceInfo(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
+    out.deviceInfo.channels = NO_CHANNELS;
+    out.deviceInfo.buses = Bsp::cI2cBusCount;
+    outlen = sizeof(out.deviceInfo);
+    return true;
+}
+
+bool Application::updateI2cSpeed(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
+    if (in.i2cSpeed.bus >= Bsp::cI2cBusCount) {
+        return false;
+    }
+    II2cMaster &bus = *mBsp.i2cBuses[in.i2cSpeed.bus];
+    if (in.i2cSpeed.speed != 0) {
+        bus.setSpeed(in.i2cSpeed.speed);
+        for (size_t i = 0; i < NO_CHANNELS; ++i) {
+            if (mChannelsSettings.get().channelSettings[i].bus == in.i2cSpeed.bus) {
+                probeChannelDevices(i);
+            }
+        }
+    }
+    out.i2cSpeed.busSpeed = bus.getSpeed(0);
+    out.i2cSpeed.deviceSpeed = in.i2cSpeed.addr != 0 && bus.isDeviceReady(in.i2cSpeed.addr) ? bus.getSpeed(in.i2cSpeed.addr) : 0;
+    outlen = sizeof(out.i2cSpeed);
+    return true;
+}
+
+bool Application::sendIdleStats(const InProtocolData &in, OutProtocolData &out, size_t &outlen) {
+    out.idleStats.uptime = getTime();
+    out.idleStats.idle = mIdle;
+    out.idleStats.minIdle = mMinIdle;
+    outlen = sizeof(out.idleStats);
+    return true;
+}
+
+void Application::updateIdleStats(uint32_t time) {
+    uint32_t elapsed = time - mLoadWindowStart;
+    if (elapsed < cLoadWindow) {
+        return;
+    }
+
+    uint64_t idle = getIdleTime();
+    uint64_t permille = (idle - mLoadWindowIdle) / elapsed;
+    mIdle = static_cast<uint16_t>(std::min(permille, static_cast<uint64_t>(1000)));
+    mMinIdle = std::min(mMinIdle, mIdle);
+    mLoadWindowStart = time;
+    mLoadWindowIdle = idle;
+}
+
+void Application::sampleChannels(uint32_t time) {
+    if (time - mLastSampleTime < cSamplePeriod) {
+        return;
+    }
+    mLastSampleTime = time;
+
+    // Each bus reads one sensor at a time from its interrupts, so the buses transfer concurrently
+    // and the sampling time grows with the channels of the busiest bus only
+    size_t next[Bsp::cI2cBusCount] = {};
+    size_t active[Bsp::cI2cBusCount];
+    bool pending = false;
+    for (size_t bus = 0; bus < Bsp::cI2cBusCount; ++bus) {
+        active[bus] = startNextSample(bus, next[bus], time);
+        pending |= active[bus] < NO_CHANNELS;
+    }
+    while (pending) {
+        pending = false;
+        for (size_t bus = 0; bus < Bsp::cI2cBusCount; ++bus) {
+            if (active[bus] >= NO_CHANNELS) {
+                continue;
+            }
+            if (!mChannels[active[bus]].processSample()) {
+                recordSample(active[bus], time);
+                active[bus] = startNextSample(bus, next[bus], time);
+            }
+            pending |= active[bus] < NO_CHANNELS;
+        }
+    }
+}
+
+size_t Application::startNextSample(size_t bus, size_t &next, uint32_t time) {
+    while (next < NO_CHANNELS) {
+        size_t channel = next++;
+        if (mChannelsSettings.get().channelSettings[channel].bus != bus) {
+            continue;
+        }
+        // Running motors are sampled even before their limit switch is released, so the
+        // supervisor checks the current from the start of the movement
+        bool moving = mChannelLog[channel].state == static_cast<uint8_t>(State::MOVING);
+        if (!moving && !mChannels[channel].isMotorRunning()) {
+            continue;
+        }
+        if (mChannels[channel].startSample(time)) {
+            return channel;
+        }
+    }
+    return NO_CHANNELS;
+}
+
+void Application::recordSample(size_t channel, uint32_t time) {
+    uint16_t voltage = 0;
+    int16_t current = 0;
+    bool moving = mChannelLog[channel].state == static_cast<uint8_t>(State::MOVING);
+    if (!mChannels[channel].finishSample(time, voltage, current) || !moving) {
+        return;
+    }
+
+    const int32_t sample[] = {voltage, current};
+    if (!mSampleEncoders[channel].append(sample)) {
+        // The block is full, continue the movement in a new one
+        flushSampleBlock(channel);
+        startSampleBlock(channel);
+        mSampleEncoders[channel].append(sample);
+    }
+    if (mSampleEncoders[channel].getCount() == 1) {
+        mSampleBlocks[channel].startTime = time;
+    }
+}
+
+void Application::startSampleBlock(size_t channel) {
+    SampleBlock &block = mSampleBlocks[channel];
+    block = {};
+    block.period = cSamplePeriod;
+    block.channel = channel;
+    mSampleEncoders[channel].reset(block.data, sizeof(block.data));
+}
+
+void Application::flushSampleBlock(size_t channel) {
+    SampleBlock &block = mSampleBlocks[channel];
+    block.count = mSampleEncoders[channel].getCount();
+    block.size = mSampleEncoders[channel].getSize();
+    if (block.count > 0 && mLogsEnabled) {
+        mSampleLog.append(block);
+    }
+    mSampleEncoders[channel].reset(block.data, sizeof(block.data));
+}
+
 void Application::testSwitchProcedure() {
     const uint32_t colors[] = {Colors::RED, Colors::GREEN, Colors::BLUE};
 
     for (uint32_t color : colors) {
-        mLeds.setColor(color);
-        mLeds.update();
+        mAnimator.setAnimation(LedAnimation::solid(color));
         if (waitForPushRelease(500, *mBsp.testSwitch, true)) {
             return;
         }
@@ -161,91 +498,266 @@ void Application::testSwitchProcedure() {
 }
 
 void Application::loadSettings() {
-    mUserSettings.load();
+    // The second user settings slot holds the legacy channels settings, migrate them first
     mChannelsSettings.load();
+    mUserSettings.load();
+    for (size_t i = 0; i < NO_CHANNELS; ++i) {
+        applyChannelSettings(i);
+    }
+}
+
+bool Application::migrateChannelsSettings(const uint8_t *data, size_t size, ChannelsSettings &settings) {
+    static_assert(cLegacyChannels * sizeof(ControlChannelSettingsV1) % sizeof(ControlChannelSettings) != 0,
+                  "The legacy layout must not be taken for the current one");
+    if (size % sizeof(ControlChannelSettings) == 0) {
+        // Current layout saved by a build with another CHANNEL_COUNT, data holds at most NO_CHANNELS entries
+        size_t stored = size / sizeof(ControlChannelSettings);
+        for (size_t i = 0; i < NO_CHANNELS; ++i) {
+            ControlChannelSettings &channel = settings.channelSettings[i];
+            channel = {};
+            if (i < stored) {
+                memcpy(&channel, data + i * sizeof(channel), sizeof(channel));
+            }
+        }
+        return true;
+    }
+    if (size != cLegacyChannels * sizeof(ControlChannelSettingsV1)) {
+        return false;
+    }
     for (size_t i = 0; i < NO_CHANNELS; ++i) {
-        mChannels[i].setSettings(mChannelsSettings.get().channelSettings[i]);
+        ControlChannelSettings &channel = settings.channelSettings[i];
+        channel = {};
+        if (i >= cLegacyChannels) {
+            continue;
+        }
+        ControlChannelSettingsV1 old;
+        memcpy(&old, data + i * sizeof(old), sizeof(old));
+        // The flags kept their bits, the bus bit was unused and is cleared
+        memcpy(&channel, &old.flags, sizeof(old.flags));
+        channel.bus = 0;
+        channel.ina_addr = old.ina_addr;
+        channel.ina_callibration = old.ina_callibration;
+        channel.pcf_addr = old.pcf_addr;
+        channel.pcf_channel = old.pcf_channel;
+        channel.max_voltage_limit = old.max_voltage_limit;
+        channel.min_voltage_limit = old.min_voltage_limit;
+        channel.max_current_limit = old.max_current_limit;
+        channel.min_current_limit = old.min_current_limit;
+        // The movement time limits did not exist, leave them disabled
+        channel.max_move_time = 0;
+        channel.min_move_time = 0;
     }
+    return true;
+}
+
+void Application::applyChannelSettings(size_t channel) {
+    const ControlChannelSettings &settings = mChannelsSettings.get().channelSettings[channel];
+    mChannels[channel].setBus(*mBsp.i2cBuses[settings.bus]);
+    probeChannelDevices(channel);
+    mChannels[channel].setSettings(settings);
+}
+
+void Application::probeChannelDevices(size_t channel) {
+    const ControlChannelSettings &settings = mChannelsSettings.get().channelSettings[channel];
+    if (!settings.enable) {
+        return;
+    }
+    II2cMaster &bus = *mBsp.i2cBuses[settings.bus];
+    uint32_t inaSpeed = bus.probe(settings.ina_addr);
+    uint32_t pcfSpeed = bus.probe(settings.pcf_addr);
+    LOG << "Channel " << channel << " I2C speed: INA219 " << inaSpeed << " Hz, PCF8574 " << pcfSpeed << " Hz";
 }
 
 bool Application::getLdgGearSwitch() {
-    return mBsp.ldgSwitch->get();
+    return mLdgSwitch.get();
 }
 
 bool Application::getRudderSwitch() {
-    return mBsp.rudSwitch->get();
+    return mRudSwitch.get();
+}
+
+bool Application::processSwitches(uint32_t time) {
+    bool changed = mTestSwitch.process(time);
+    // Only the switches commanding the motors are measured
+    DebouncedSwitch *switches[] = {&mLdgSwitch, &mRudSwitch};
+    for (DebouncedSwitch *sw : switches) {
+        if (sw->process(time)) {
+            if (!mSwitchChanged || static_cast<int32_t>(sw->getChangeTime() - mSwitchChangeTime) < 0) {
+                mSwitchChangeTime = sw->getChangeTime();
+            }
+            mSwitchChanged = true;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void Application::refreshChannelInputs(uint32_t time) {
+    // The line stays low until the changed expander is read, so a change coming while
+    // the expanders are read is not lost
+    bool changed = mExpanderChanged || !mBsp.expanderInt->get();
+    mExpanderChanged = false;
+    if (!changed && time - mLastInputsRefresh < cInputsRefreshPeriod) {
+        return;
+    }
+    mLastInputsRefresh = time;
+    for (ControlChannel &channel : mChannels) {
+        channel.invalidateInputs();
+    }
+}
+
+void Application::recordSwitchLatency(uint32_t time) {
+    if (!mSwitchChanged) {
+        return;
+    }
+    mSwitchChanged = false;
+    mProfiler.record(ZONE_SWITCH, (time - mSwitchChangeTime) * (ProfileClock::frequency() / 1000));
 }
 
 void Application::processChannel(size_t channel, bool rudderSwitchState, bool ldgGearSwitchState, uint32_t time) {
     State state = mChannels[channel].getChannelState();
-    uint32_t color = 0;
+    LedAnimation animation = {};
 
     bool isRudder = mChannels[channel].isRudder();
     if (isRudder) {
-        mChannels[channel].setMotor(rudderSwitchState);
+        mChannels[channel].setMotor(rudderSwitchState, time);
     } else {
-        mChannels[channel].setMotor(ldgGearSwitchState);
+        mChannels[channel].setMotor(ldgGearSwitchState, time);
     }
 
     switch (state) {
     case State::DOWN:
-        color = getColorForDownState(isRudder, rudderSwitchState, ldgGearSwitchState, time);
+        animation = getAnimationForDownState(isRudder, rudderSwitchState, ldgGearSwitchState);
         break;
 
     case State::UP:
-        color = getColorForUpState(isRudder, rudderSwitchState, ldgGearSwitchState, time);
+        animation = getAnimationForUpState(isRudder, rudderSwitchState, ldgGearSwitchState);
         break;
 
     case State::MOVING:
-        color = getColorForMovingState(isRudder, rudderSwitchState, ldgGearSwitchState, time);
+        animation = getAnimationForMovingState(isRudder, rudderSwitchState, ldgGearSwitchState);
         break;
 
     case State::ERROR:
-        color = Colors::blinking(500, time, Colors::RED);
+        // Errors enumeration starts with NONE, so the bit number is the error code
+        animation = LedAnimation::blinkCode(getColorOrDefault(mUserSettings.get().errorColor, Colors::RED),
+                                            std::max(getLowestBit(mChannels[channel].getErrors()), static_cast<uint8_t>(1)));
         break;
     }
 
-    color = Colors::setBrightness(color, mUserSettings.get().brightness);
-    mLeds.setColor(channel, color);
+    uint32_t warnings = mChannels[channel].getWarnings();
+    if (state != State::ERROR && animation.type == LedAnimation::Type::SOLID && warnings != 0) {
+        // Warning blinks over the state color, so the gear position stays visible
+        animation = LedAnimation::blinkCode(getColorOrDefault(mUserSettings.get().warningColor, Colors::YELLOW),
+                                            getLowestBit(warnings) + 1, animation.color);
+    }
+
+    mAnimator.setAnimation(channel, animation);
+
+    logChannelEvents(channel, state, time);
 }
 
-uint32_t Application::getColorForDownState(bool isRudder, bool rudderSwitchState, bool ldgGearSwitchState, uint32_t time) {
-    uint32_t color = 0;
+uint8_t Application::getLowestBit(uint32_t mask) {
+    uint8_t bit = 0;
+    while (mask != 0 && (mask & 1) == 0) {
+        mask >>= 1;
+        bit++;
+    }
+    return bit;
+}
+
+uint32_t Application::getColorOrDefault(uint32_t color, uint32_t defaultColor) {
+    return color != 0 ? color : defaultColor;
+}
+
+void Application::logEvent(EventType type, uint8_t channel, uint16_t value0, uint16_t value1, uint16_t value2) {
+    EventRecord record = {};
+    record.time = getTime();
+    record.type = static_cast<uint8_t>(type);
+    record.channel = channel;
+    record.value[0] = value0;
+    record.value[1] = value1;
+    record.value[2] = value2;
+    if (mLogsEnabled) {
+        mEventLog.append(record);
+    }
+}
+
+void Application::logChannelEvents(size_t channel, State state, uint32_t time) {
+    ChannelLogState &log = mChannelLog[channel];
+    uint8_t newState = static_cast<uint8_t>(state);
+
+    if (state == State::MOVING) {
+        if (log.state != newState) {
+            startSampleBlock(channel);
+        }
+    } else if (log.state == static_cast<uint8_t>(State::MOVING)) {
+        flushSampleBlock(channel);
+    }
+
+    uint32_t movements = mChannels[channel].getMovementCount();
+    if (log.movements != movements) {
+        const MovementStats &movement = mChannels[channel].getLastMovement();
+        uint32_t duration = std::min(static_cast<uint32_t>(movement.duration / 10), static_cast<uint32_t>(UINT16_MAX));
+        logEvent(EventType::MOVEMENT, channel, static_cast<uint16_t>(duration), movement.minCurrent, movement.maxCurrent);
+        log.movements = movements;
+    }
+
+    if (log.state != newState) {
+        logEvent(EventType::STATE, channel, log.state, newState);
+        log.state = newState;
+    }
+
+    uint32_t errors = mChannels[channel].getErrors();
+    if (log.errors != errors) {
+        logEvent(EventType::ERRORS, channel, static_cast<uint16_t>(log.errors), static_cast<uint16_t>(errors));
+        log.errors = errors;
+    }
+
+    uint32_t warnings = mChannels[channel].getWarnings();
+    if (log.warnings != warnings) {
+        logEvent(EventType::WARNINGS, channel, static_cast<uint16_t>(log.warnings), static_cast<uint16_t>(warnings));
+        log.warnings = warnings;
+    }
+}
+
+LedAnimation Application::getAnimationForDownState(bool isRudder, bool rudderSwitchState, bool ldgGearSwitchState) {
+    LedAnimation animation = {};
     if (isRudder) {
         if (rudderSwitchState) {
-            color = ldgGearSwitchState ? mUserSettings.get().rudderInactiveColor : mUserSettings.get().rudderDownColor;
+            animation = LedAnimation::solid(ldgGearSwitchState ? mUserSettings.get().rudderInactiveColor : mUserSettings.get().rudderDownColor);
         } else {
-            color = getColorForMovingState(isRudder, rudderSwitchState, ldgGearSwitchState, time);
+            animation = getAnimationForMovingState(isRudder, rudderSwitchState, ldgGearSwitchState);
         }
     } else {
         if (ldgGearSwitchState) {
-            color = mUserSettings.get().ldgDownColor;
+            animation = LedAnimation::solid(mUserSettings.get().ldgDownColor);
         } else {
-            color = getColorForMovingState(isRudder, rudderSwitchState, ldgGearSwitchState, time);
+            animation = getAnimationForMovingState(isRudder, rudderSwitchState, ldgGearSwitchState);
         }
     }
-    return color;
+    return animation;
 }
 
-uint32_t Application::getColorForUpState(bool isRudder, bool rudderSwitchState, bool ldgGearSwitchState, uint32_t time) {
-    uint32_t color = 0;
+LedAnimation Application::getAnimationForUpState(bool isRudder, bool rudderSwitchState, bool ldgGearSwitchState) {
+    LedAnimation animation = {};
     if (isRudder) {
         if (rudderSwitchState) {
-            color = getColorForMovingState(isRudder, rudderSwitchState, ldgGearSwitchState, time);            
+            animation = getAnimationForMovingState(isRudder, rudderSwitchState, ldgGearSwitchState);
         } else {
-            color = mUserSettings.get().rudderUpColor;
+            animation = LedAnimation::solid(mUserSettings.get().rudderUpColor);
         }
     } else {
         if (ldgGearSwitchState) {
-            color = getColorForMovingState(isRudder, rudderSwitchState, ldgGearSwitchState, time);
+            animation = getAnimationForMovingState(isRudder, rudderSwitchState, ldgGearSwitchState);
         } else {
-            color = mUserSettings.get().ldgUpColor;
+            animation = LedAnimation::solid(mUserSettings.get().ldgUpColor);
         }
     }
-    return color;
+    return animation;
 }
 
-uint32_t Application::getColorForMovingState(bool isRudder, bool rudderSwitchState, bool ldgGearSwitchState, uint32_t time) {
+LedAnimation Application::getAnimationForMovingState(bool isRudder, bool rudderSwitchState, bool ldgGearSwitchState) {
     uint32_t color = 0;
     if (isRudder) {
         if (rudderSwitchState) {
@@ -256,7 +768,7 @@ uint32_t Application::getColorForMovingState(bool isRudder, bool rudderSwitchSta
     } else {
         color = ldgGearSwitchState ? mUserSettings.get().ldgDownColor : mUserSettings.get().ldgUpColor;
     }
-    return Colors::blinking(500, time, color);
+    return LedAnimation::blink(color, cBlinkPeriod);
 }
 
 bool Application::relaysTest() {
@@ -267,15 +779,22 @@ bool Application::relaysTest() {
     return result;
 }
 
-void Application::handleUartCommunication() {
+bool Application::handleUartCommunication() {
     char inBuff[128] = {};
-    char outBuff[128] = {};
+    char outBuff[256] = {};
 
-    if (UartStream::getInstance()->readLine(inBuff, sizeof(inBuff), 0)) {
-        if (mProtocol.process(inBuff, outBuff, sizeof(outBuff))) {
-            Logger() << outBuff;
-        }
+    if (!UartStream::getInstance()->readLine(inBuff, sizeof(inBuff), 0)) {
+        return false;
+    }
+    bool respond = false;
+    {
+        Profiler<ZONE_COUNT>::Scope<ZONE_PROTOCOL> zone(mProfiler);
+        respond = mProtocol.process(inBuff, outBuff, sizeof(outBuff));
     }
+    if (respond) {
+        Logger() << outBuff;
+    }
+    return true;
 }
 
 void Application::setBrightness() {
@@ -285,8 +804,8 @@ void Application::setBrightness() {
 
     for (size_t i = 0; i < 10; i++) {
         for (uint8_t b = 0xF; b < 0xFF; b += 0x18) {
-            mLeds.setColor(Colors::setBrightness(Colors::WHITE, b));
-            mLeds.update();
+            mAnimator.setBrightness(b);
+            mAnimator.setAnimation(LedAnimation::solid(Colors::WHITE));
             if (waitForPushRelease(500, *mBsp.testSwitch, true)) {
                 mUserSettings.get().brightness = b;
                 mUserSettings.save();
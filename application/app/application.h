@@ -6,15 +6,30 @@
 #include "control_channel.h"
 #include "logger.h"
 #include "settings.h"
+#include "circular_log.h"
+#include "event_log.h"
+#include "delta_encoder.h"
+#include "sample_log.h"
 #include "ws2812.h"
+#include "led_animator.h"
+#include "stack_monitor.h"
+#include "profiler.h"
+#include "debounced_switch.h"
 
 #define APP_VER "AppBS v" VERSION
 
+#ifndef CHANNEL_COUNT
+/// @brief Number of control channels, set with the CHANNEL_COUNT CMake option.
+#define CHANNEL_COUNT 6
+#endif
+
 /// @class Application
 /// @brief This class handles the main application logic, including protocol command processing and device communication.
 class Application
 {
 private:
+  static constexpr size_t cEventLogRecordsPerFrame = 7; ///< Number of event log records sent in a single response.
+
   struct UserSettings {
     uint32_t ldgUpColor;
     uint32_t ldgDownColor;
@@ -33,6 +48,7 @@ private:
     struct
     {
       uint8_t i2cAddress; ///< I2C device address used in I2C scan command.
+      uint8_t bus;        ///< Index of the scanned I2C bus.
     } i2cScan;
     struct UserSettings userSettings;
     struct {
@@ -44,8 +60,20 @@ private:
       uint8_t ina_addr;
       uint8_t pcf_addr;
       uint8_t pcf_channel;
+      uint8_t bus;
     } channelTest;
     size_t fileSize; ///< File size used for file-related commands (not currently implemented).
+    uint32_t eventLogSeq; ///< Sequence number of the first event log record to read.
+    uint32_t sampleLogSeq; ///< Sequence number of the first sample block to read.
+    struct {
+      uint8_t zone;  ///< Index of the profiled zone to read.
+      uint8_t reset; ///< Clears the statistics of all zones after reading if set.
+    } profile;
+    struct {
+      uint32_t speed; ///< New clock speed of the bus [Hz], 0 to keep the current one.
+      uint8_t bus;    ///< Index of the I2C bus.
+      uint8_t addr;   ///< I2C address of the device whose speed is reported, 0 for none.
+    } i2cSpeed;
     uint8_t raw[32];
   };
 
@@ -73,6 +101,55 @@ private:
       uint8_t state;
       uint8_t switches;
     } monitoringData;
+    struct {
+      uint32_t first; ///< Sequence number of the oldest record in the log.
+      uint32_t next;  ///< Sequence number of the next record to be logged.
+      uint32_t cont;  ///< Sequence number to continue reading from.
+      uint8_t count;  ///< Number of records in the response.
+      struct {
+        uint32_t seq;
+        EventRecord record;
+      } records[cEventLogRecordsPerFrame];
+    } eventLog;
+    struct {
+      uint32_t first; ///< Sequence number of the oldest block in the log.
+      uint32_t next;  ///< Sequence number of the next block to be logged.
+      uint32_t cont;  ///< Sequence number to continue reading from.
+      uint8_t valid;  ///< Set if the response holds a block.
+      SampleBlock block;
+    } sampleLog;
+    struct {
+      uint32_t staticSize; ///< Size of .data and .bss [B].
+      uint32_t stackSize;  ///< RAM available to the stack [B].
+      uint32_t stackPeak;  ///< Maximal stack usage since boot [B].
+      uint16_t txSize;     ///< Capacity of the UART transmit buffer [B].
+      uint16_t txPeak;     ///< Maximal occupancy of the UART transmit buffer [B].
+      uint16_t rxSize;     ///< Capacity of the UART receive buffer [B].
+      uint16_t rxPeak;     ///< Maximal occupancy of the UART receive buffer [B].
+    } memoryUsage;
+    struct {
+      uint32_t frequency; ///< Tick frequency of all times [Hz].
+      uint32_t count;     ///< Number of measurements.
+      uint32_t min;       ///< Shortest duration [ticks].
+      uint32_t max;       ///< Longest duration [ticks].
+      uint32_t average;   ///< Average duration [ticks].
+      uint16_t histogram[ProfileStats::cBuckets]; ///< Duration histogram, see ProfileStats.
+      uint8_t zones;      ///< Number of profiled zones.
+      uint8_t zone;       ///< Index of the reported zone.
+    } profile;
+    struct {
+      uint32_t uptime;  ///< Time since start [ms].
+      uint16_t idle;    ///< Share of the last load window the CPU slept [permille].
+      uint16_t minIdle; ///< Lowest idle share of a load window since start [permille].
+    } idleStats;
+    struct {
+      uint8_t channels; ///< Number of control channels.
+      uint8_t buses;    ///< Number of I2C buses.
+    } deviceInfo;
+    struct {
+      uint32_t busSpeed;    ///< Clock speed of the bus [Hz].
+      uint32_t deviceSpeed; ///< Clock speed negotiated with the device [Hz], 0 if it does not respond.
+    } i2cSpeed;
     uint8_t result;
     uint8_t raw[32];
   };
@@ -101,6 +178,13 @@ private:
   /// @return true Always returns true.
   bool resetDevice(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
 
+  /// @brief Handles the 'B' command to restart the device in the bootloader update mode.
+  /// @param in Input protocol data (unused).
+  /// @param out Output protocol data (unused).
+  /// @param outlen Output length of the data being sent (unused).
+  /// @return true Always returns true.
+  bool enterBootloader(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
+
   /// @brief Handles the 's' command to scan I2C devices.
   /// @param in Input protocol data containing the I2C device address to scan.
   /// @param out Output protocol data containing the result of the scan.
@@ -110,45 +194,265 @@ private:
 
   bool sendUserSettings(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
 
+  /// @brief Handles the 'U' command to update user settings.
+  /// The settings are applied immediately and saved to flash after a quiet period or on the 'W' command.
+  /// @param in Input protocol data containing the user settings.
+  /// @param out Output protocol data containing the result.
+  /// @param outlen Output length of the data being sent.
+  /// @return true Always returns true.
   bool updateUserSettings(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
 
   bool sendChannelSettings(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
 
+  /// @brief Handles the 'C' command to update settings of a single channel.
+  /// Only the addressed channel is reconfigured, and only if its settings changed. The settings
+  /// are saved to flash after a quiet period or on the 'W' command.
+  /// @param in Input protocol data containing the channel number and its settings.
+  /// @param out Output protocol data containing the result.
+  /// @param outlen Output length of the data being sent.
+  /// @return true if the channel number is valid, false otherwise.
   bool updateChannelSettings(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
 
+  /// @brief Handles the 'W' command to save pending settings changes to flash immediately.
+  /// @param in Input protocol data (unused).
+  /// @param out Output protocol data containing the result of the save.
+  /// @param outlen Output length of the data being sent.
+  /// @return true Always returns true.
+  bool commitSettings(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
+
   bool sendMonitoringData(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
 
   bool setTestChannel(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
 
+  /// @brief Handles the 'e' command to read records of the event log.
+  /// Valid records starting from the requested sequence number are sent, corrupted ones are skipped.
+  /// Reading is complete when the returned continuation number reaches the next sequence number.
+  /// @param in Input protocol data containing the sequence number of the first record to read.
+  /// @param out Output protocol data containing the log range and the records.
+  /// @param outlen Output length of the data being sent.
+  /// @return true if the logs are enabled, false otherwise.
+  bool sendEventLog(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
+
+  /// @brief Handles the 'a' command to read a block of the sample log.
+  /// The first valid block starting from the requested sequence number is sent, corrupted ones are skipped.
+  /// @param in Input protocol data containing the sequence number of the first block to read.
+  /// @param out Output protocol data containing the log range and the block.
+  /// @param outlen Output length of the data being sent.
+  /// @return true if the logs are enabled, false otherwise.
+  bool sendSampleLog(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
+
+  /// @brief Handles the 'M' command to read the RAM usage.
+  /// Reports the stack high-water mark and the peak occupancy of the UART buffers since boot.
+  /// @param in Input protocol data (unused).
+  /// @param out Output protocol data containing the memory usage.
+  /// @param outlen Output length of the data being sent.
+  /// @return true Always returns true.
+  bool sendMemoryUsage(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
+
+  /// @brief Handles the 'p' command to read the execution time statistics of a profiled zone.
+  /// @param in Input protocol data containing the zone index and the reset flag.
+  /// @param out Output protocol data containing the statistics of the zone.
+  /// @param outlen Output length of the data being sent.
+  /// @return true if the zone exists, false otherwise.
+  bool sendProfile(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
+
+  /// @brief Handles the 'i' command to read the CPU idle statistics.
+  /// @param in Input protocol data (unused).
+  /// @param out Output protocol data containing the idle statistics.
+  /// @param outlen Output length of the data being sent.
+  /// @return true Always returns true.
+  bool sendIdleStats(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
+
+  /// @brief Handles the 'n' command to read the number of channels and I2C buses.
+  /// @param in Input protocol data (unused).
+  /// @param out Output protocol data containing the device configuration.
+  /// @param outlen Output length of the data being sent.
+  /// @return true Always returns true.
+  bool sendDeviceInfo(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
+
+  /// @brief Handles the 'S' command to read and set the I2C clock speed.
+  ///
+  /// A new bus speed is not stored, it lasts until the next reset. The devices of the channels
+  /// on the bus are probed again at the new speed.
+  ///
+  /// @param in Input protocol data containing the bus, the device address and the new speed.
+  /// @param out Output protocol data containing the bus speed and the speed of the device.
+  /// @param outlen Output length of the data being sent.
+  /// @return true if the bus exists, false otherwise.
+  bool updateI2cSpeed(const InProtocolData &in, OutProtocolData &out, size_t &outlen);
+
+  /// @brief Updates the idle share when a load window is over.
+  /// @param time The current time [ms].
+  void updateIdleStats(uint32_t time);
+
+  /// @brief Debounces the edges of the cockpit switches.
+  /// @param time The current time [ms].
+  /// @return true if the state of any switch changed.
+  bool processSwitches(uint32_t time);
+
+  /// @brief Records the time from a switch change to the motors being commanded.
+  /// @param time The time the motors were commanded [ms].
+  void recordSwitchLatency(uint32_t time);
+
+  /// @brief Makes the channels read their limit switches if the expanders signalled a change
+  /// on the /INT line or the refresh period is over.
+  /// @param time The current time [ms].
+  void refreshChannelInputs(uint32_t time);
+
   void testSwitchProcedure();
 
   void loadSettings();
 
+  /// @brief Applies the stored settings of a channel, including its I2C bus.
+  /// @param channel The channel number.
+  void applyChannelSettings(size_t channel);
+
+  /// @brief Probes the sensor and the IO expander of an enabled channel, demoting them to the
+  /// standard I2C speed if they fail at the bus speed.
+  /// @param channel The channel number.
+  void probeChannelDevices(size_t channel);
+
   bool getLdgGearSwitch();
 
   bool getRudderSwitch();
 
   void processChannel(size_t channel, bool rudderSwitchState, bool ldgGearSwitchState, uint32_t time);
-  uint32_t getColorForDownState(bool isRudder, bool rudderSwitchState, bool ldgGearSwitchState, uint32_t time);
-  uint32_t getColorForUpState(bool isRudder, bool rudderSwitchState, bool ldgGearSwitchState, uint32_t time);
-  uint32_t getColorForMovingState(bool isRudder, bool rudderSwitchState, bool ldgGearSwitchState, uint32_t time);
+  LedAnimation getAnimationForDownState(bool isRudder, bool rudderSwitchState, bool ldgGearSwitchState);
+  LedAnimation getAnimationForUpState(bool isRudder, bool rudderSwitchState, bool ldgGearSwitchState);
+  LedAnimation getAnimationForMovingState(bool isRudder, bool rudderSwitchState, bool ldgGearSwitchState);
+
+  /// @brief Returns the number of the lowest set bit, used as the blink code of errors and warnings.
+  /// @param mask The bit mask.
+  /// @return The bit number, 0 for an empty mask.
+  static uint8_t getLowestBit(uint32_t mask);
+
+  /// @brief Returns a color from the user settings, or the default one if it is not configured.
+  /// @param color The configured color (0xRRGGBB).
+  /// @param defaultColor The color used when the configured one is black.
+  /// @return The color to display.
+  static uint32_t getColorOrDefault(uint32_t color, uint32_t defaultColor);
   bool relaysTest();
-  void handleUartCommunication();
+  bool handleUartCommunication();
   void setBrightness();
 
+  /// @brief Appends a record to the event log.
+  /// @param type The event type.
+  /// @param channel The channel number, 0xFF for device-wide events.
+  /// @param value0 The first event specific value.
+  /// @param value1 The second event specific value.
+  /// @param value2 The third event specific value.
+  void logEvent(EventType type, uint8_t channel, uint16_t value0 = 0, uint16_t value1 = 0, uint16_t value2 = 0);
+
+  /// @brief Logs state transitions, error and warning changes and movements of a channel.
+  /// @param channel The channel number.
+  /// @param state The current state of the channel.
+  /// @param time The current time in milliseconds.
+  void logChannelEvents(size_t channel, State state, uint32_t time);
+
+  /// @brief Records voltage and current of the moving channels once per sampling period.
+  /// @param time The current time in milliseconds.
+  void sampleChannels(uint32_t time);
+
+  /// @brief Starts sampling the next moving channel on a bus.
+  /// @param bus The index of the I2C bus.
+  /// @param next The first channel number to check, advanced past the started channel.
+  /// @param time The current time in milliseconds.
+  /// @return The number of the started channel, NO_CHANNELS if none is left on the bus.
+  size_t startNextSample(size_t bus, size_t &next, uint32_t time);
+
+  /// @brief Finishes the sample of a channel and appends it to the sample block of the channel.
+  /// @param channel The channel number.
+  /// @param time The time the sample was started in milliseconds.
+  void recordSample(size_t channel, uint32_t time);
+
+  /// @brief Starts a new sample block of a channel.
+  /// @param channel The channel number.
+  void startSampleBlock(size_t channel);
+
+  /// @brief Appends the sample block of a channel to the sample log if it holds any sample.
+  /// @param channel The channel number.
+  void flushSampleBlock(size_t channel);
+
 private:
-  static constexpr size_t NO_CHANNELS = 6;
+  static constexpr size_t NO_CHANNELS = CHANNEL_COUNT;
+  static constexpr uint32_t cUserSettingsAddress = 0x0000;     ///< External flash address of user settings (2 sectors, A/B).
+  static constexpr uint32_t cChannelsSettingsAddress = 0x2000; ///< External flash address of channels settings (2 sectors, A/B).
+  static constexpr uint32_t cSettingsCommitDelay = 2000;       ///< Quiet period [ms] after which changed settings are saved.
+  static constexpr uint32_t cEventLogAddress = 0x10000;        ///< External flash address of the event log.
+  static constexpr size_t cEventLogSectors = 48;               ///< Number of sectors occupied by the event log.
+  static constexpr uint32_t cSampleLogAddress = 0x40000;       ///< External flash address of the sample log.
+  static constexpr size_t cSampleLogSectors = 64;              ///< Number of sectors occupied by the sample log.
+  static constexpr uint32_t cSamplePeriod = 50;                ///< Time [ms] between samples of a moving channel.
+  static constexpr uint32_t cLoopDelay = 100;                  ///< Time [ms] between control loop iterations.
+  static constexpr uint32_t cLoadWindow = 1000;                ///< Time [ms] over which the idle share is measured.
+  static constexpr uint32_t cInputsRefreshPeriod = 1000;       ///< Time [ms] after which idle channels read their limit switches without an interrupt.
+  static constexpr uint32_t cDebounceTime = 20;               ///< Time [ms] a switch must be stable before its change is accepted.
+  static constexpr uint32_t cFramePeriod = 20;                 ///< Time [ms] between LED animation frames.
+  static constexpr uint16_t cBlinkPeriod = 500;                ///< LED blinking period [ms] of a moving channel.
+  static constexpr uint8_t cNoChannel = 0xFF;                  ///< Channel number of device-wide events.
+  static constexpr uint8_t cUnknownState = 0xFF;               ///< Logged state before the first transition.
+  static_assert(NO_CHANNELS > 0 && NO_CHANNELS < cNoChannel, "Channel numbers must fit the event log records");
+
+  // Settings layout of the firmware before the A/B slots, converted on the first boot
+  static constexpr uint32_t cLegacyUserSettingsAddress = 0x0000;     ///< Address of the user settings before the A/B slots.
+  static constexpr uint32_t cLegacyChannelsSettingsAddress = 0x1000; ///< Address of the channels settings before the A/B slots.
+  static constexpr size_t cLegacyChannels = 6;                       ///< Number of channels before CHANNEL_COUNT.
+
+  /// @brief Zones measured by the profiler.
+  enum ProfileZone : size_t {
+    ZONE_CHANNEL,  ///< Control of a single channel, including its I2C transfers.
+    ZONE_SAMPLE,   ///< Sampling of the moving channels.
+    ZONE_LED,      ///< Rendering and encoding of a LED frame, in the timer interrupt.
+    ZONE_PROTOCOL, ///< Processing of a protocol command.
+    ZONE_FLASH,    ///< Settings commits and processing of the external flash and the logs.
+    ZONE_SWITCH,   ///< Latency from the first edge of a switch change to the motors being commanded.
+    ZONE_LOOP,     ///< Control pass of a loop iteration: limit switches, all channels and settings commits.
+    ZONE_COUNT,
+  };
+
+  /// @brief Channel state last written to the event log.
+  struct ChannelLogState
+  {
+    uint8_t state;       ///< Last logged state, cUnknownState until the first one is logged.
+    uint32_t errors;     ///< Last logged error mask.
+    uint32_t warnings;   ///< Last logged warning mask.
+    uint32_t movements;  ///< Number of finished movements of the channel already logged.
+  };
   struct ChannelsSettings
   {
     ControlChannelSettings channelSettings[NO_CHANNELS];
   };
 
-  Protocol<InProtocolData, OutProtocolData, 10> mProtocol; ///< Protocol object for handling commands.
+  /// @brief Converts channel settings stored with an older layout, see Settings::Migration.
+  static bool migrateChannelsSettings(const uint8_t *data, size_t size, ChannelsSettings &settings);
+
+  Protocol<InProtocolData, OutProtocolData, 18> mProtocol; ///< Protocol object for handling commands.
   Bsp &mBsp;                                               ///< Reference to the Board Support Package for hardware interactions.
   Ws2812<NO_CHANNELS> mLeds;
+  LedAnimator<NO_CHANNELS> mAnimator;
   ControlChannel mChannels[NO_CHANNELS];
-  Settings<ChannelsSettings> mChannelsSettings;
+  Settings<ChannelsSettings> mChannelsSettings; ///< Loaded before mUserSettings, whose second slot holds its legacy record.
   Settings<UserSettings> mUserSettings;
+  CircularLog<EventRecord> mEventLog;
+  ChannelLogState mChannelLog[NO_CHANNELS];
+  CircularLog<SampleBlock, 1> mSampleLog;
+  bool mLogsEnabled; ///< Cleared if the external flash is too small for the logs.
+  SampleBlock mSampleBlocks[NO_CHANNELS];
+  DeltaEncoder<2> mSampleEncoders[NO_CHANNELS];
+  uint32_t mLastSampleTime;
+  StackMonitor mStackMonitor; ///< Stack high-water mark, painted in main().
+  Profiler<ZONE_COUNT> mProfiler; ///< Execution time statistics of the hot paths.
+  uint32_t mLoadWindowStart;      ///< Start time of the current load window [ms].
+  uint64_t mLoadWindowIdle;       ///< Idle time at the start of the current load window [us].
+  uint16_t mIdle;                 ///< Idle share of the last load window [permille].
+  uint16_t mMinIdle;              ///< Lowest idle share of a load window [permille].
+  DebouncedSwitch mTestSwitch;
+  DebouncedSwitch mLdgSwitch;
+  DebouncedSwitch mRudSwitch;
+  bool mSwitchChanged;            ///< Set when a switch changed and the motors were not commanded yet.
+  uint32_t mSwitchChangeTime;     ///< Time of the first edge of the earliest pending switch change [ms].
+  volatile bool mExpanderChanged; ///< Set by the /INT interrupt of the expanders.
+  uint32_t mLastInputsRefresh;    ///< Time the limit switches of all channels were last read [ms].
   
 
 
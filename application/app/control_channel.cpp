@@ -1,15 +1,34 @@
 #include "control_channel.h"
 #include "bsp.h"
 
-ControlChannel::ControlChannel(II2cMaster &i2c) : mSettings{}, mCurrentSensor(i2c), mExpanderIO(i2c)
+ControlChannel::ControlChannel(II2cMaster &i2c) : mSettings{}, mCurrentSensor(i2c), mExpanderIO(i2c), mMotorCurrent(0),
+                                                 mInputs(0), mInputsValid(false), mPollInputs(true), mMotorOutput(0), mMotorOutputValid(false),
+                                                 mMoveDir(false), mMoveDirValid(false), mMovementFault(false)
 {
 }
 
+ControlChannel::ControlChannel() : mSettings{}, mMotorCurrent(0),
+                                   mInputs(0), mInputsValid(false), mPollInputs(true), mMotorOutput(0), mMotorOutputValid(false),
+                                   mMoveDir(false), mMoveDirValid(false), mMovementFault(false)
+{
+}
+
+void ControlChannel::setBus(II2cMaster &i2c)
+{
+    mCurrentSensor.setBus(i2c);
+    mExpanderIO.setBus(i2c);
+    mInputsValid = false;
+    mMotorOutputValid = false;
+}
+
 bool ControlChannel::setSettings(const ControlChannelSettings &settings)
 {
     mSettings = settings;
     mCurrentSensor.setAddress(mSettings.ina_addr);
     mExpanderIO.setAddress(mSettings.pcf_addr);
+    // Limits in 0.1s and 0.1A, supervisor in ms and mA
+    mSupervisor.setLimits(mSettings.max_move_time * 100u, mSettings.min_move_time * 100u,
+                          mSettings.max_current_limit * 100u, mSettings.min_current_limit * 100u);
 
     if (!connectionTest())
     {
@@ -24,6 +43,8 @@ bool ControlChannel::setSettings(const ControlChannelSettings &settings)
 
 bool ControlChannel::configure()
 {
+    mInputsValid = false;
+    mMotorOutputValid = false;
     return mExpanderIO.write(cPcfCfg);
 }
 
@@ -75,6 +96,7 @@ bool ControlChannel::addressTest(bool set) {
         mask = 0;
     }
 
+    mMotorOutputValid = false;
     if(!mExpanderIO.write(mask | cPcfCfg)) {
         return false;
     }
@@ -95,6 +117,7 @@ bool ControlChannel::relaysTest() {
         mask = cMotor2RightDirMask | cMotor2LeftDirMask;
     }
 
+    mMotorOutputValid = false;
     if(!mExpanderIO.write(mask | cPcfCfg)) {
         return false;
     }
@@ -129,12 +152,11 @@ bool ControlChannel::setMotor(bool enable, uint8_t channel, bool dir)
         return true;
     }
 
-    uint8_t data = mExpanderIO.read() | cPcfCfg;
-    uint8_t mask;
-
+    uint8_t mask = 0;
+    uint8_t channelMask = 0;
     if (channel == 0)
     {
-        data &= ~(cMotor1RightDirMask | cMotor1LeftDirMask);
+        channelMask = cMotor1RightDirMask | cMotor1LeftDirMask;
         if (dir)
         {
             mask = cMotor1RightDirMask;
@@ -146,7 +168,7 @@ bool ControlChannel::setMotor(bool enable, uint8_t channel, bool dir)
     }
     else if (channel == 1)
     {
-        data &= ~(cMotor2RightDirMask | cMotor2LeftDirMask);
+        channelMask = cMotor2RightDirMask | cMotor2LeftDirMask;
         if (dir)
         {
             mask = cMotor2RightDirMask;
@@ -157,21 +179,132 @@ bool ControlChannel::setMotor(bool enable, uint8_t channel, bool dir)
         }
     }
 
+    if (!enable)
+    {
+        mask = 0;
+    }
+
+    // Skip the I2C transfers while the motor stays off, a running motor is rewritten on
+    // every call in case the shared expander was reconfigured meanwhile
+    if (mMotorOutputValid && mMotorOutput == 0 && mask == 0)
+    {
+        return true;
+    }
+
+    // The expander may be shared with another channel, keep its motor bits
+    uint8_t data = 0;
+    if (!mExpanderIO.read(data))
+    {
+        return false;
+    }
+    mInputs = data;
+    mInputsValid = true;
+
+    data = (data & ~channelMask) | mask | cPcfCfg;
+    mMotorOutputValid = mExpanderIO.write(data);
+    mMotorOutput = mask;
     if (enable)
     {
-        data |= mask;
+        mPollInputs = true;
+    }
+    return mMotorOutputValid;
+}
+
+bool ControlChannel::setMotor(bool dir, uint32_t time) {
+    if(!mSettings.enable) {
+        return true;
+    }
+
+    if(!mMoveDirValid || dir != mMoveDir) {
+        // A new command ends the current movement and retries one stopped by the supervisor
+        mSupervisor.finish(time, MovementResult::ABORTED);
+        mMoveDir = dir;
+        mMoveDirValid = true;
+        mMovementFault = false;
+        mErrors.clr(Errors::TIME_EXCEEDED);
+        mErrors.clr(Errors::SHORT_CIRCUIT);
+        mErrors.clr(Errors::OPEN_CIRCUIT);
+    }
+
+    bool arrived = getLimitSwitchState(dir ? LimitSwitch::DOWN : LimitSwitch::UP);
+    if(arrived) {
+        if(mSupervisor.isActive()) {
+            mSupervisor.finish(time, MovementResult::COMPLETED);
+            if(mSupervisor.isTooShort()) {
+                mWarnings.set(Warnings::SHORT_MOVEMENT_TIME);
+            } else {
+                mWarnings.clr(Warnings::SHORT_MOVEMENT_TIME);
+            }
+        }
+    } else if(!mMovementFault) {
+        if(!mSupervisor.isActive()) {
+            mSupervisor.start(time);
+        }
+        MovementResult result = mSupervisor.check(time);
+        if(result != MovementResult::NONE) {
+            stopMovement(time, result);
+        }
+    }
+
+    return setMotor(!arrived && !mMovementFault, mSettings.pcf_channel, dir);
+}
+
+void ControlChannel::stopMovement(uint32_t time, MovementResult result) {
+    mMovementFault = true;
+    mSupervisor.finish(time, result);
+    switch(result) {
+    case MovementResult::TIMEOUT:
+        mErrors.set(Errors::TIME_EXCEEDED);
+        break;
+    case MovementResult::OVERCURRENT:
+        mErrors.set(Errors::SHORT_CIRCUIT);
+        break;
+    case MovementResult::UNDERCURRENT:
+        mErrors.set(Errors::OPEN_CIRCUIT);
+        break;
+    default:
+        break;
+    }
+    setMotor(false, mSettings.pcf_channel, mMoveDir);
+}
+
+bool ControlChannel::startSample(uint32_t time) {
+    MovementResult result = mSupervisor.check(time);
+    if(result != MovementResult::NONE) {
+        stopMovement(time, result);
     }
 
-    return mExpanderIO.write(data);
+    // A sensor which does not respond fails the read, no separate connection test is needed
+    return mCurrentSensor.startMeasurement();
 }
 
- bool ControlChannel::setMotor(bool dir) {
-    if((dir && !getLimitSwitchState(LimitSwitch::DOWN)) || (!dir && !getLimitSwitchState(LimitSwitch::UP))) {
-        return setMotor(true, mSettings.pcf_channel, dir);
-    } else {
-        return setMotor(false, mSettings.pcf_channel, dir);
+bool ControlChannel::processSample() {
+    return mCurrentSensor.processMeasurement();
+}
+
+bool ControlChannel::finishSample(uint32_t time, uint16_t &voltage, int16_t &current) {
+    if(!mCurrentSensor.getMeasurement(voltage, current)) {
+        return false;
     }
- }
+
+    MovementResult result = mSupervisor.sample(time, static_cast<uint16_t>(abs(current)));
+    if(result != MovementResult::NONE) {
+        stopMovement(time, result);
+    }
+    return true;
+}
+
+bool ControlChannel::isMotorRunning() const {
+    return mSupervisor.isActive();
+}
+
+const MovementStats &ControlChannel::getLastMovement() const {
+    return mSupervisor.getLast();
+}
+
+uint32_t ControlChannel::getMovementCount() const {
+    return mSupervisor.getCount();
+}
 
 bool ControlChannel::getPowerSensorStatus(uint16_t &voltage, uint16_t &current)
 {
@@ -186,7 +319,15 @@ bool ControlChannel::getPowerSensorStatus(uint16_t &voltage, uint16_t &current)
 
 State ControlChannel::getChannelState()
 {
-    if(!mExpanderIO.connectionTest()) {
+    if (mPollInputs)
+    {
+        mInputsValid = false;
+    }
+    mPollInputs = true;
+    if(!readInputs()) {
+        return State::ERROR;
+    }
+    if(mMovementFault) {
         return State::ERROR;
     }
 
@@ -194,22 +335,26 @@ State ControlChannel::getChannelState()
     bool downSwitch = getLimitSwitchState(LimitSwitch::DOWN);
     if(!upSwitch && !downSwitch) { //ToDo change to motor on check
         int16_t current = mCurrentSensor.readCurrent();
-        
-        if(abs(current) > mSettings.max_current_limit) {
+        mMotorCurrent = current;
+
+        // Limits in 0.1A, current in mA
+        if(abs(current) > mSettings.max_current_limit * 100) {
             mWarnings.set(Warnings::LOW_MOTOR_IMPEDANCE);
         }
 
-        if(abs(current) < mSettings.min_current_limit) {
+        if(abs(current) < mSettings.min_current_limit * 100) {
             mWarnings.set(Warnings::HIGH_MOTOR_IMPEDANCE);
         }
     }
 
     if (upSwitch && !downSwitch)
     {
+        mPollInputs = false;
         return State::UP;
     }
     else if (!upSwitch && downSwitch)
     {
+        mPollInputs = false;
         return State::DOWN;
     }
     else if (!upSwitch && !downSwitch)
@@ -222,13 +367,29 @@ State ControlChannel::getChannelState()
     }
 }
 
+void ControlChannel::invalidateInputs() {
+    mInputsValid = false;
+}
+
+int16_t ControlChannel::getMotorCurrent() const {
+    return mMotorCurrent;
+}
+
+uint32_t ControlChannel::getErrors() const {
+    return mErrors.get();
+}
+
+uint32_t ControlChannel::getWarnings() const {
+    return mWarnings.get();
+}
+
 bool ControlChannel::isRudder() const {
     return mSettings.rudder;
 }
 
 bool ControlChannel::getLimitSwitchState(LimitSwitch limit_switch)
 {
-    uint8_t data = mExpanderIO.read();
+    uint8_t data = readInputs() ? mInputs : 0;
     bool result = false;
     uint8_t mask = 0;
 
@@ -274,4 +435,13 @@ bool ControlChannel::getLimitSwitchState(LimitSwitch limit_switch)
     }
 
     return result;
-}
\ No newline at end of file
+}
+
+bool ControlChannel::readInputs()
+{
+    if (!mInputsValid)
+    {
+        mInputsValid = mExpanderIO.read(mInputs);
+    }
+    return mInputsValid;
+}
@@ -7,6 +7,7 @@
 #include "logger.h"
 #include "ina219.h"
 #include "pcf8574.h"
+#include "movement_supervisor.h"
 
 /// @brief Enumeration representing possible warning conditions.
 enum class Warnings {
@@ -14,6 +15,7 @@ enum class Warnings {
     HIGH_MOTOR_IMPEDANCE,
     LOW_POWER_VOLTAGE,
     HIGH_POWER_VOLTAGE,
+    SHORT_MOVEMENT_TIME,
 };
 
 /// @brief Enumeration representing possible error conditions.
@@ -51,6 +53,7 @@ typedef struct {
     uint8_t inverse_down_limit_switch : 1; ///< Inverse down limit switch flag.
     uint8_t inverse_limit_switch : 1;      ///< Inverse limit switch flag.
     uint8_t rudder : 1;                    ///< Rudder control flag.
+    uint8_t bus : 1;                       ///< I2C bus of the sensor and the IO expander (0: I2C1, 1: I2C2).
     uint8_t ina_addr;                      ///< I2C address of the INA219 sensor.
     uint16_t ina_callibration;             ///< Calibration value for INA219 (0.01 Ohm).
     uint8_t pcf_addr;                      ///< I2C address of the PCF8574 expander.
@@ -59,8 +62,24 @@ typedef struct {
     uint16_t min_voltage_limit;            ///< Minimum voltage limit (0.1V).
     uint16_t max_current_limit;            ///< Maximum current limit (0.1A).
     uint16_t min_current_limit;            ///< Minimum current limit (0.1A).
+    uint16_t max_move_time;                ///< Maximum movement time (0.1s), 0 disables the check.
+    uint16_t min_move_time;                ///< Minimum movement time (0.1s), 0 disables the check.
 } ControlChannelSettings;
 
+/// @brief Layout of ControlChannelSettings before the movement time limits, kept to convert
+/// stored settings.
+typedef struct {
+    uint8_t flags;
+    uint8_t ina_addr;
+    uint16_t ina_callibration;
+    uint8_t pcf_addr;
+    uint8_t pcf_channel;
+    uint16_t max_voltage_limit;
+    uint16_t min_voltage_limit;
+    uint16_t max_current_limit;
+    uint16_t min_current_limit;
+} ControlChannelSettingsV1;
+
 /// @brief Class to control a channel with motor, current sensor and limit switches.
 class ControlChannel {
 public:
@@ -69,6 +88,14 @@ public:
     /// @param i2c Reference to an I2C master interface.
     ControlChannel(II2cMaster &i2c);
 
+    /// @brief Constructs a new ControlChannel object whose bus is set later with setBus().
+    ControlChannel();
+
+    /// @brief Sets the I2C bus of the current sensor and the IO expander.
+    ///
+    /// @param i2c Reference to an I2C master interface.
+    void setBus(II2cMaster &i2c);
+
     /// @brief Sets the settings for the control channel.
     ///
     /// @param settings The settings to apply.
@@ -84,10 +111,52 @@ public:
 
     bool relaysTest();
 
-    bool setMotor(bool dir);
+    /// @brief Drives the motor towards the commanded end stop and supervises the movement.
+    ///
+    /// The motor runs until the end stop is reached or the supervisor stops it. A stopped
+    /// movement is retried only after the command changes.
+    ///
+    /// @param dir The commanded direction (true for down, false for up).
+    /// @param time The current time [ms].
+    /// @return true if the IO expander was written successfully, false otherwise.
+    bool setMotor(bool dir, uint32_t time);
 
     bool getPowerSensorStatus(uint16_t &voltage, uint16_t &current);
 
+    /// @brief Starts reading the current sensor of a running movement without waiting for completion.
+    ///
+    /// The motor is switched off immediately if the movement takes too long. The sensor is read
+    /// with asynchronous I2C reads, so channels on different buses are sampled concurrently.
+    /// Poll processSample() until it returns false, then finish the sample with finishSample().
+    ///
+    /// @param time The current time [ms].
+    /// @return true if the read was started, false otherwise.
+    bool startSample(uint32_t time);
+
+    /// @brief Advances the sample started by startSample(), never blocks.
+    ///
+    /// @return true while the current sensor is being read, false once the read ended.
+    bool processSample();
+
+    /// @brief Checks the motor current of the sample read after startSample().
+    ///
+    /// The motor is switched off immediately if the current is out of limits.
+    ///
+    /// @param time The current time [ms].
+    /// @param voltage The bus voltage [mV].
+    /// @param current The motor current [mA].
+    /// @return true if the current sensor was read, false otherwise.
+    bool finishSample(uint32_t time, uint16_t &voltage, int16_t &current);
+
+    /// @brief Checks whether the motor is running.
+    bool isMotorRunning() const;
+
+    /// @brief Gets the statistics of the last finished movement.
+    const MovementStats &getLastMovement() const;
+
+    /// @brief Gets the number of finished movements.
+    uint32_t getMovementCount() const;
+
     /// @brief Checks if the current control channel is configured as a rudder.
     ///
     /// @return true if the channel is a rudder, false otherwise.
@@ -95,9 +164,34 @@ public:
 
     /// @brief Gets the current state of the control channel.
     ///
+    /// The limit switches are read from the IO expander once and cached. The cache is
+    /// refreshed on every call while the channel is moving or in error, otherwise only
+    /// after invalidateInputs().
+    ///
     /// @return The current state of the channel (UP, DOWN, MOVING, or ERROR).
     State getChannelState();
 
+    /// @brief Makes the next getChannelState() read the limit switches from the IO expander.
+    ///
+    /// Called when the /INT line of the expanders signals an input change, and periodically
+    /// to detect communication issues of an idle channel.
+    void invalidateInputs();
+
+    /// @brief Gets the motor current measured by the last getChannelState() call while moving.
+    ///
+    /// @return The motor current in milliamps.
+    int16_t getMotorCurrent() const;
+
+    /// @brief Gets the active errors.
+    ///
+    /// @return The bitmask of active errors, see Errors.
+    uint32_t getErrors() const;
+
+    /// @brief Gets the active warnings.
+    ///
+    /// @return The bitmask of active warnings, see Warnings.
+    uint32_t getWarnings() const;
+
 private:
     /// @brief Configures the IO expander with the necessary settings.
     ///
@@ -110,6 +204,17 @@ private:
     /// @return true if the limit switch is active, false otherwise.
     bool getLimitSwitchState(LimitSwitch limit_switch);
 
+    /// @brief Reads the inputs of the IO expander unless the cached ones are valid.
+    ///
+    /// @return true if the cached inputs are valid, false if the expander did not respond.
+    bool readInputs();
+
+    /// @brief Stops the current movement because of a fault and switches the motor off.
+    ///
+    /// @param time The current time [ms].
+    /// @param result The fault reported by the supervisor.
+    void stopMovement(uint32_t time, MovementResult result);
+
     /// @brief Sets the motor state and direction.
     ///
     /// @param enable Enable or disable the motor.
@@ -123,6 +228,16 @@ private:
     Pcf8574 mExpanderIO;              ///< The IO expander (PCF8574).
     BitMask<Errors> mErrors;          ///< Bitmask for tracking error states.
     BitMask<Warnings> mWarnings;      ///< Bitmask for tracking warning states.
+    int16_t mMotorCurrent;            ///< Motor current measured while moving [mA].
+    uint8_t mInputs;                  ///< Cached port of the IO expander.
+    bool mInputsValid;                ///< Set if mInputs is up to date.
+    bool mPollInputs;                 ///< Set if the inputs are read on every getChannelState() call.
+    uint8_t mMotorOutput;             ///< Motor bits of this channel last written to the IO expander.
+    bool mMotorOutputValid;           ///< Set if mMotorOutput matches the IO expander.
+    MovementSupervisor mSupervisor;   ///< Checks the duration and current of the movements.
+    bool mMoveDir;                    ///< Last commanded direction.
+    bool mMoveDirValid;               ///< Set once a direction was commanded.
+    bool mMovementFault;              ///< Set while the supervisor keeps the motor stopped.
 
     static constexpr uint8_t cPcfCfg = 0x0F; ///< Configuration value for the PCF8574.
 
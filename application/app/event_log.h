@@ -0,0 +1,23 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <cstdint>
+
+/// @brief Enumeration representing the types of events stored in the event log.
+enum class EventType : uint8_t {
+    BOOT,     ///< Device started, no values.
+    STATE,    ///< Channel state changed, value[0]: previous state, value[1]: new state.
+    ERRORS,   ///< Channel errors changed, value[0]: previous mask, value[1]: new mask.
+    WARNINGS, ///< Channel warnings changed, value[0]: previous mask, value[1]: new mask.
+    MOVEMENT, ///< Channel movement ended (end stop, fault or reversal), value[0]: duration [10ms], value[1]: min current [mA], value[2]: max current [mA].
+};
+
+/// @brief Structure representing a single event log record.
+typedef struct {
+    uint32_t time;      ///< Time since startup [ms].
+    uint16_t value[3];  ///< Event specific values, see EventType.
+    uint8_t type;       ///< Event type, see EventType.
+    uint8_t channel;    ///< Channel number, 0xFF for device-wide events.
+} EventRecord;
+
+#endif // EVENT_LOG_H
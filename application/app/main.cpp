@@ -3,11 +3,20 @@
 #include "protocol2.h"
 #include "application.h"
 #include "ws2812.h"
+#include "image_header.h"
+#include "version.h"
+#include "stack_monitor.h"
 
 UartStream *UartStream::mInstance = nullptr;
 
+/// @brief Header of the image checked by the bootloader, size and CRC are filled in after linking.
+__attribute__((section(".image_header"), used)) static const ImageHeader imageHeader = {cImageMagic, 0, 0, VERSION};
+
 int main()
 {
+  // First, so the measured high-water mark covers the whole run
+  StackMonitor().paint();
+
   Bsp bsp;
   UartStream logStream(*bsp.uartBus);
 
@@ -0,0 +1,120 @@
+#include "movement_supervisor.h"
+
+MovementSupervisor::MovementSupervisor() : mMaxTime(0), mMinTime(0), mMaxCurrent(0), mMinCurrent(0), mActive(false),
+                                           mLowCurrent(false), mLowCurrentStart(0), mCurrent{}, mLast{}, mCount(0)
+{
+}
+
+void MovementSupervisor::setLimits(uint32_t maxTime, uint32_t minTime, uint32_t maxCurrent, uint32_t minCurrent)
+{
+    mMaxTime = maxTime;
+    mMinTime = minTime;
+    mMaxCurrent = maxCurrent;
+    mMinCurrent = minCurrent;
+}
+
+void MovementSupervisor::start(uint32_t time)
+{
+    mActive = true;
+    mLowCurrent = false;
+    mCurrent = {};
+    mCurrent.start = time;
+    mCurrent.minCurrent = UINT16_MAX;
+}
+
+MovementResult MovementSupervisor::check(uint32_t time)
+{
+    if (mActive && mMaxTime != 0 && time - mCurrent.start > mMaxTime)
+    {
+        return MovementResult::TIMEOUT;
+    }
+    return MovementResult::NONE;
+}
+
+MovementResult MovementSupervisor::sample(uint32_t time, uint16_t current)
+{
+    if (!mActive)
+    {
+        return MovementResult::NONE;
+    }
+    MovementResult result = check(time);
+    if (result != MovementResult::NONE)
+    {
+        return result;
+    }
+
+    if (current < mCurrent.minCurrent)
+    {
+        mCurrent.minCurrent = current;
+    }
+    if (current > mCurrent.maxCurrent)
+    {
+        mCurrent.maxCurrent = current;
+    }
+
+    if (time - mCurrent.start < cInrushTime)
+    {
+        return MovementResult::NONE;
+    }
+
+    if (mMaxCurrent != 0 && current > mMaxCurrent)
+    {
+        return MovementResult::OVERCURRENT;
+    }
+
+    if (mMinCurrent != 0 && current < mMinCurrent)
+    {
+        if (!mLowCurrent)
+        {
+            mLowCurrent = true;
+            mLowCurrentStart = time;
+        }
+        else if (time - mLowCurrentStart >= cUnderCurrentTime)
+        {
+            return MovementResult::UNDERCURRENT;
+        }
+    }
+    else
+    {
+        mLowCurrent = false;
+    }
+    return MovementResult::NONE;
+}
+
+void MovementSupervisor::finish(uint32_t time, MovementResult result)
+{
+    if (!mActive)
+    {
+        return;
+    }
+    mActive = false;
+    mCurrent.duration = time - mCurrent.start;
+    mCurrent.result = result;
+    if (mCurrent.minCurrent > mCurrent.maxCurrent)
+    {
+        // No sample was taken
+        mCurrent.minCurrent = 0;
+    }
+    mLast = mCurrent;
+    mCount++;
+}
+
+bool MovementSupervisor::isActive() const
+{
+    return mActive;
+}
+
+bool MovementSupervisor::isTooShort() const
+{
+    return mLast.result == MovementResult::COMPLETED && mMinTime != 0 && mLast.duration < mMinTime;
+}
+
+const MovementStats &MovementSupervisor::getLast() const
+{
+    return mLast;
+}
+
+uint32_t MovementSupervisor::getCount() const
+{
+    return mCount;
+}
@@ -0,0 +1,92 @@
+#ifndef MOVEMENT_SUPERVISOR_H
+#define MOVEMENT_SUPERVISOR_H
+
+#include <cstdint>
+
+/// @brief Enumeration representing how a movement ended.
+enum class MovementResult : uint8_t {
+    NONE,         ///< The movement continues.
+    COMPLETED,    ///< The end stop was reached.
+    ABORTED,      ///< The movement was reversed before reaching the end stop.
+    TIMEOUT,      ///< The maximum movement time passed.
+    OVERCURRENT,  ///< The motor current exceeded the maximum.
+    UNDERCURRENT, ///< The motor current stayed below the minimum.
+};
+
+/// @brief Statistics of a single movement.
+typedef struct {
+    uint32_t start;      ///< Time the motor was switched on [ms].
+    uint32_t duration;   ///< Time from switching the motor on to the end of the movement [ms].
+    uint16_t minCurrent; ///< Minimal motor current [mA].
+    uint16_t maxCurrent; ///< Maximal motor current [mA].
+    MovementResult result;
+} MovementStats;
+
+/// @class MovementSupervisor
+/// @brief Checks the duration and the motor current of the movements of a channel.
+///
+/// The owner reports the start and the end of every movement and passes the motor current
+/// samples in between; check() and sample() return the reason to stop the motor. The current
+/// limits are ignored for cInrushTime after the start, so only a current lasting beyond the
+/// inrush peak stops the motor, after that a single sample over the maximum does. All limits
+/// disable their check when set to 0.
+class MovementSupervisor {
+public:
+    static constexpr uint32_t cInrushTime = 200;       ///< Time [ms] after the start without current checks.
+    static constexpr uint32_t cUnderCurrentTime = 500; ///< Time [ms] the current must stay below the minimum.
+
+    MovementSupervisor();
+
+    /// @brief Sets the limits of the movements.
+    /// @param maxTime Maximum movement time [ms].
+    /// @param minTime Minimum movement time [ms], a shorter completed movement is reported by isTooShort().
+    /// @param maxCurrent Maximum motor current [mA].
+    /// @param minCurrent Minimum motor current [mA].
+    void setLimits(uint32_t maxTime, uint32_t minTime, uint32_t maxCurrent, uint32_t minCurrent);
+
+    /// @brief Starts a movement.
+    /// @param time The time the motor is switched on [ms].
+    void start(uint32_t time);
+
+    /// @brief Checks the duration of the current movement.
+    /// @param time The current time [ms].
+    /// @return TIMEOUT if the maximum movement time passed, NONE otherwise.
+    MovementResult check(uint32_t time);
+
+    /// @brief Records a motor current sample of the current movement and checks it.
+    /// @param time The time of the sample [ms].
+    /// @param current The absolute motor current [mA].
+    /// @return The reason to stop the motor, NONE to continue.
+    MovementResult sample(uint32_t time, uint16_t current);
+
+    /// @brief Ends the current movement and stores its statistics.
+    /// @param time The time the motor is switched off [ms].
+    /// @param result How the movement ended.
+    void finish(uint32_t time, MovementResult result);
+
+    /// @brief Checks whether a movement is in progress.
+    bool isActive() const;
+
+    /// @brief Checks whether the last movement completed faster than the minimum movement time.
+    bool isTooShort() const;
+
+    /// @brief Returns the statistics of the last finished movement.
+    const MovementStats &getLast() const;
+
+    /// @brief Returns the number of finished movements.
+    uint32_t getCount() const;
+
+private:
+    uint32_t mMaxTime;
+    uint32_t mMinTime;
+    uint32_t mMaxCurrent;
+    uint32_t mMinCurrent;
+    bool mActive;              ///< Set while a movement is in progress.
+    bool mLowCurrent;          ///< Set while the current is below the minimum.
+    uint32_t mLowCurrentStart; ///< Time the current dropped below the minimum [ms].
+    MovementStats mCurrent;    ///< Statistics of the movement in progress.
+    MovementStats mLast;       ///< Statistics of the last finished movement.
+    uint32_t mCount;           ///< Number of finished movements.
+};
+
+#endif // MOVEMENT_SUPERVISOR_H
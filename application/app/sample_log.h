@@ -0,0 +1,21 @@
+#ifndef SAMPLE_LOG_H
+#define SAMPLE_LOG_H
+
+#include <cstdint>
+
+/// @brief Structure representing a block of voltage and current samples of a single movement.
+///
+/// The samples are compressed with DeltaEncoder<2>, each one holds the bus voltage [mV]
+/// followed by the motor current [mA]. A long movement continues in further blocks,
+/// each starting with a full sample.
+typedef struct {
+    uint32_t startTime; ///< Time of the first sample since startup [ms].
+    uint16_t period;    ///< Time between samples [ms].
+    uint8_t channel;    ///< Channel number.
+    uint8_t count;      ///< Number of samples in the block.
+    uint8_t size;       ///< Number of bytes used in data.
+    uint8_t reserved[3];
+    uint8_t data[108];  ///< Compressed samples.
+} SampleBlock;
+
+#endif // SAMPLE_LOG_H
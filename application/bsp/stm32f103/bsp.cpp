@@ -5,7 +5,43 @@
 #include "uart.h"
 #include "pwm_dma.h"
 #include "spi.h"
+#include "timer.h"
+#include "boot_request.h"
 #include "w25x_flash.h"
+#include "static_storage.h"
+
+#ifndef I2C_CLOCK_SPEED
+/// @brief Clock speed of the I2C buses [Hz], set with the I2C_CLOCK_SPEED CMake option.
+#define I2C_CLOCK_SPEED 400000
+#endif
+
+namespace {
+  // Peripheral objects, constructed by Bsp::Bsp() after the clock is configured
+  StaticStorage<Gpio> sdaPinStorage;
+  StaticStorage<Gpio> sclPinStorage;
+  StaticStorage<I2cMaster> i2cBusStorage;
+  StaticStorage<Gpio> scl2PinStorage;
+  StaticStorage<Gpio> sda2PinStorage;
+  StaticStorage<I2cMaster> i2cBus2Storage;
+  StaticStorage<Gpio> rxPinStorage;
+  StaticStorage<Gpio> txPinStorage;
+  StaticStorage<Uart> uartBusStorage;
+  StaticStorage<Gpio> ledDataPinStorage;
+  StaticStorage<Gpio> testSwitchStorage;
+  StaticStorage<Gpio> ldgSwitchStorage;
+  StaticStorage<Gpio> rudSwitchStorage;
+  StaticStorage<Gpio> expanderIntStorage;
+  StaticStorage<PwmDma> ledsStorage;
+  StaticStorage<Timer> ledTimerStorage;
+  StaticStorage<Gpio> spiCsPinStorage;
+  StaticStorage<Gpio> spiClkStorage;
+  StaticStorage<Gpio> spiMisoStorage;
+  StaticStorage<Gpio> spiMosiStorage;
+  StaticStorage<Spi> spiStorage;
+  StaticStorage<W25xFlash> extFlashStorage;
+
+  uint64_t idleCycles = 0; ///< CPU cycles spent sleeping in sleep().
+}
 
 Bsp::Bsp()
 {
@@ -13,28 +49,38 @@ Bsp::Bsp()
   __HAL_RCC_AFIO_CLK_ENABLE();
   __HAL_RCC_PWR_CLK_ENABLE();
 	initClock();
-	mSdaPin.reset(new Gpio(GPIOB, GPIO_PIN_6, GPIO_MODE_AF_OD, GPIO_PULLUP, 0));
-	mSclPin.reset(new Gpio(GPIOB, GPIO_PIN_7, GPIO_MODE_AF_OD, GPIO_PULLUP, 0));
-	i2cBus.reset(new I2cMaster(I2C1));
-	mRxPin.reset(new Gpio(GPIOA, GPIO_PIN_9, GPIO_MODE_AF_PP, GPIO_NOPULL, 0));
-	mTxPin.reset(new Gpio(GPIOA, GPIO_PIN_10, GPIO_MODE_INPUT, GPIO_NOPULL, 0));
-  uartBus.reset(new Uart(USART1, 115200));
 
-  mLedDataPin.reset(new Gpio(GPIOA, GPIO_PIN_1, GPIO_MODE_AF_PP, GPIO_NOPULL, 0));
+  // Cycle counter measuring the idle time
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 
-  testSwitch.reset(new Gpio(GPIOC, GPIO_PIN_5, GPIO_MODE_INPUT, GPIO_PULLUP, 0));
-  ldgSwitch.reset(new Gpio(GPIOC, GPIO_PIN_3, GPIO_MODE_INPUT, GPIO_PULLUP, 0));
-  rudSwitch.reset(new Gpio(GPIOC, GPIO_PIN_4, GPIO_MODE_INPUT, GPIO_PULLUP, 0));
+  sdaPinStorage.create(GPIOB, GPIO_PIN_6, GPIO_MODE_AF_OD, GPIO_PULLUP, 0);
+  sclPinStorage.create(GPIOB, GPIO_PIN_7, GPIO_MODE_AF_OD, GPIO_PULLUP, 0);
+  i2cBuses[0] = i2cBusStorage.create(I2C1, I2C_CLOCK_SPEED);
+  scl2PinStorage.create(GPIOB, GPIO_PIN_10, GPIO_MODE_AF_OD, GPIO_PULLUP, 0);
+  sda2PinStorage.create(GPIOB, GPIO_PIN_11, GPIO_MODE_AF_OD, GPIO_PULLUP, 0);
+  i2cBuses[1] = i2cBus2Storage.create(I2C2, I2C_CLOCK_SPEED);
+  rxPinStorage.create(GPIOA, GPIO_PIN_9, GPIO_MODE_AF_PP, GPIO_NOPULL, 0);
+  txPinStorage.create(GPIOA, GPIO_PIN_10, GPIO_MODE_INPUT, GPIO_NOPULL, 0);
+  uartBus = uartBusStorage.create(USART1, 115200);
 
-  leds.reset(new PwmDma(TIM2, TIM_CHANNEL_2, DMA1_Channel7, 79));
+  ledDataPinStorage.create(GPIOA, GPIO_PIN_1, GPIO_MODE_AF_PP, GPIO_NOPULL, 0);
 
-  mSpiCsPin.reset(new Gpio(GPIOA, GPIO_PIN_4, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL, 0));
-  mSpiClk.reset(new Gpio(GPIOA, GPIO_PIN_5, GPIO_MODE_AF_PP, GPIO_NOPULL, 0));
-  mSpiMiso.reset(new Gpio(GPIOA, GPIO_PIN_6, GPIO_MODE_INPUT, GPIO_NOPULL, 0));
-  mSpiMosi.reset(new Gpio(GPIOA, GPIO_PIN_7, GPIO_MODE_AF_PP, GPIO_NOPULL, 0));
-  mSpi.reset(new Spi(SPI1));
+  testSwitch = testSwitchStorage.create(GPIOC, GPIO_PIN_5, GPIO_MODE_IT_RISING_FALLING, GPIO_PULLUP, 0);
+  ldgSwitch = ldgSwitchStorage.create(GPIOC, GPIO_PIN_3, GPIO_MODE_IT_RISING_FALLING, GPIO_PULLUP, 0);
+  rudSwitch = rudSwitchStorage.create(GPIOC, GPIO_PIN_4, GPIO_MODE_IT_RISING_FALLING, GPIO_PULLUP, 0);
+  expanderInt = expanderIntStorage.create(GPIOB, GPIO_PIN_12, GPIO_MODE_IT_FALLING, GPIO_PULLUP, 0);
 
-  extFlash.reset(new W25xFlash(*mSpi, *mSpiCsPin));
+  leds = ledsStorage.create(TIM2, TIM_CHANNEL_2, DMA1_Channel7, 79);
+  ledTimer = ledTimerStorage.create(TIM3);
+
+  Gpio *spiCsPin = spiCsPinStorage.create(GPIOA, GPIO_PIN_4, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL, 0);
+  spiClkStorage.create(GPIOA, GPIO_PIN_5, GPIO_MODE_AF_PP, GPIO_NOPULL, 0);
+  spiMisoStorage.create(GPIOA, GPIO_PIN_6, GPIO_MODE_INPUT, GPIO_NOPULL, 0);
+  spiMosiStorage.create(GPIOA, GPIO_PIN_7, GPIO_MODE_AF_PP, GPIO_NOPULL, 0);
+  Spi *spi = spiStorage.create(SPI1);
+
+  extFlash = extFlashStorage.create(*spi, *spiCsPin);
 }
 	
 void Bsp::reset()
@@ -42,6 +88,12 @@ void Bsp::reset()
   NVIC_SystemReset();
 }
 
+void Bsp::resetToBootloader()
+{
+  BootRequest().set();
+  NVIC_SystemReset();
+}
+
 void Bsp::initClock()
 {
 	RCC_OscInitTypeDef RCC_OscInitStruct = {0};
@@ -70,13 +122,26 @@ void Bsp::initClock()
 }
 
 void sleep(uint32_t time_ms) {
-    HAL_Delay(time_ms);
+  uint32_t start = HAL_GetTick();
+  // The current tick is partly over, one more gives at least time_ms like HAL_Delay()
+  while (HAL_GetTick() - start <= time_ms) {
+    // With interrupts masked WFI still wakes up, the handler runs after the idle time is counted
+    __disable_irq();
+    uint32_t cycles = DWT->CYCCNT;
+    __WFI();
+    idleCycles += DWT->CYCCNT - cycles;
+    __enable_irq();
+  }
 }
 
 uint32_t getTime() {
   return HAL_GetTick();
 }
 
+uint64_t getIdleTime() {
+  return idleCycles / (SystemCoreClock / 1000000);
+}
+
 extern "C"
 {
   void defaultHandler() {
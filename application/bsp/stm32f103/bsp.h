@@ -1,18 +1,22 @@
 #ifndef BSP_H
 #define BSP_H
 
+#include <cstddef>
 #include "igpio.h"
 #include "ii2c_master.h"
 #include "iuart.h"
 #include "ipwm_dma.h"
 #include "ispi.h"
 #include "iflash.h"
-#include <memory>
+#include "itimer.h"
 
 /// @class Bsp
 /// @brief Board Support Package (BSP) class.
 ///
 /// This class provides the initialization and management of hardware resources 
+///
+/// The peripheral objects are placed in static storage (see StaticStorage) instead of the heap,
+/// the heap is not used at all. There must be only one instance.
 class Bsp {
 public:
     /// @brief Constructor for the Bsp class.
@@ -22,61 +26,51 @@ public:
 
     void reset();
 
-    /// @brief Unique pointer to an I2C master interface.
-    ///
-    /// This pointer is used to manage the I2C bus.
-    std::unique_ptr<II2cMaster> i2cBus;
-
-    /// @brief Unique pointer to a UART interface.
-    ///
-    /// This pointer is used to manage the UART bus.
-    std::unique_ptr<IUart> uartBus;
-
-    std::unique_ptr<IGpio> testSwitch;
-    std::unique_ptr<IGpio> ldgSwitch;
-    std::unique_ptr<IGpio> rudSwitch;
-    std::unique_ptr<IPwmDma> leds;
-    std::unique_ptr<IFlash> extFlash;
-
-private:
-    /// @brief Unique pointer to the GPIO pin used for SDA.
-    ///
-    /// This pointer is used to manage the SDA GPIO pin.
-    std::unique_ptr<IGpio> mSdaPin;
+    /// @brief Resets the device and requests the bootloader to stay in update mode.
+    void resetToBootloader();
 
-    /// @brief Unique pointer to the GPIO pin used for SCL.
-    ///
-    /// This pointer is used to manage the SCL GPIO pin.
-    std::unique_ptr<IGpio> mSclPin;
+    /// @brief Number of I2C buses.
+    static constexpr size_t cI2cBusCount = 2;
 
-    /// @brief Unique pointer to the GPIO pin used for RX.
+    /// @brief Pointers to the I2C master interfaces, I2C1 (PB6/PB7) and I2C2 (PB10/PB11).
     ///
-    /// This pointer is used to manage the RX GPIO pin.
-    std::unique_ptr<IGpio> mRxPin;
+    /// The channels select their bus in ControlChannelSettings::bus.
+    II2cMaster *i2cBuses[cI2cBusCount];
 
-    /// @brief Unique pointer to the GPIO pin used for TX.
+    /// @brief Pointer to a UART interface.
     ///
-    /// This pointer is used to manage the TX GPIO pin.
-    std::unique_ptr<IGpio> mTxPin;
-
-    std::unique_ptr<IGpio> mLedDataPin;
-
-    std::unique_ptr<IGpio> mSpiClk;
-
-    std::unique_ptr<IGpio> mSpiMosi;
+    /// This pointer is used to manage the UART bus.
+    IUart *uartBus;
 
-    std::unique_ptr<IGpio> mSpiMiso;
+    IGpio *testSwitch;
+    IGpio *ldgSwitch;
+    IGpio *rudSwitch;
 
-    std::unique_ptr<ISpi> mSpi;
+    /// @brief Pointer to the shared open-drain /INT line of the PCF8574 expanders (PB12).
+    IGpio *expanderInt;
+    IPwmDma *leds;
+    IFlash *extFlash;
 
-    std::unique_ptr<IGpio> mSpiCsPin;
+    /// @brief Pointer to the timer driving the LED animations.
+    ITimer *ledTimer;
 
+private:
     /// @brief Initializes the clock for the board.
     ///
     /// This method sets up the necessary clock configuration for the board.
     void initClock();
 };
 
+/// @brief Waits for the given time, the CPU sleeps with WFI until an interrupt.
+///
+/// The 1 ms SysTick wakes the CPU at the latest, other interrupts (UART, DMA, timers) are
+/// served meanwhile.
+///
+/// @param time_ms Minimal time to wait [ms].
 void sleep(uint32_t time_ms);
 uint32_t getTime();
+
+/// @brief Returns the total time the CPU slept in sleep().
+/// @return The idle time since start [us].
+uint64_t getIdleTime();
 #endif // BSP_H
\ No newline at end of file
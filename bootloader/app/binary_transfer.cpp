@@ -0,0 +1,176 @@
+#include "binary_transfer.h"
+#include "crc16.h"
+
+BinaryTransfer::BinaryTransfer(IFlash &flash): mFlash(flash), mDecoder(flash), mSlots{}, mAddress(0), mSize(0), mOffset(0),
+                                                mCompressed(false), mExpected(0),
+                                                mActive(false), mComplete(false), mCrcError(false), mOutOfWindow(false),
+                                                mRxState(RxState::SYNC), mRxSeq(0), mRxLen(0), mRxPos(0), mRxCrc(0),
+                                                mRxFrameCrc(0), mRxSlot(nullptr) {
+}
+
+bool BinaryTransfer::begin(uint32_t address, uint32_t size, bool compressed) {
+    mActive = false;
+    mComplete = false;
+
+    size_t sectorSize = mFlash.getSectorSize();
+    if (size == 0 || !mFlash.erase(address, (size + sectorSize - 1) / sectorSize)) {
+        return false;
+    }
+
+    for (Slot &slot : mSlots) {
+        slot.full = false;
+    }
+    mAddress = address;
+    mSize = size;
+    mOffset = 0;
+    mCompressed = compressed;
+    mDecoder.begin(address, size);
+    mExpected = 0;
+    mCrcError = false;
+    mOutOfWindow = false;
+    mRxState = RxState::SYNC;
+    mActive = true;
+    return true;
+}
+
+void BinaryTransfer::receive(uint8_t data) {
+    if (!mActive) {
+        return;
+    }
+
+    if (mRxState != RxState::SYNC && mRxState != RxState::CRC_LO && mRxState != RxState::CRC_HI) {
+        mRxCrc = Crc16::calculate(&data, 1, mRxCrc);
+    }
+
+    switch (mRxState) {
+    case RxState::SYNC:
+        if (data == cFrameStart) {
+            mRxCrc = Crc16::cInitValue;
+            mRxState = RxState::SEQ;
+        }
+        break;
+
+    case RxState::SEQ:
+        mRxSeq = data;
+        mRxState = RxState::LEN_LO;
+        break;
+
+    case RxState::LEN_LO:
+        mRxLen = data;
+        mRxState = RxState::LEN_HI;
+        break;
+
+    case RxState::LEN_HI: {
+        mRxLen |= static_cast<uint16_t>(data) << 8;
+        if (mRxLen > cMaxChunkSize) {
+            mRxState = RxState::SYNC;
+            break;
+        }
+        // Frames behind the window were already programmed, frames ahead of it have no buffer
+        uint8_t distance = mRxSeq - mExpected;
+        mRxSlot = &mSlots[mRxSeq % cWindow];
+        if (distance >= cWindow || mRxSlot->full) {
+            mRxSlot = nullptr;
+        }
+        mRxPos = 0;
+        mRxState = mRxLen ? RxState::DATA : RxState::CRC_LO;
+        break;
+    }
+
+    case RxState::DATA:
+        if (mRxSlot) {
+            mRxSlot->data[mRxPos] = data;
+        }
+        if (++mRxPos == mRxLen) {
+            mRxState = RxState::CRC_LO;
+        }
+        break;
+
+    case RxState::CRC_LO:
+        mRxFrameCrc = data;
+        mRxState = RxState::CRC_HI;
+        break;
+
+    case RxState::CRC_HI:
+        mRxFrameCrc |= static_cast<uint16_t>(data) << 8;
+        if (mRxFrameCrc != mRxCrc) {
+            mCrcError = true;
+        } else if (!mRxSlot) {
+            mOutOfWindow = true;
+        } else {
+            mRxSlot->len = mRxLen;
+            mRxSlot->seq = mRxSeq;
+            mRxSlot->full = true;
+        }
+        mRxState = RxState::SYNC;
+        break;
+    }
+}
+
+size_t BinaryTransfer::process(uint8_t *response) {
+    if (!mActive) {
+        return 0;
+    }
+
+    if (mCrcError) {
+        mCrcError = false;
+        response[0] = cNak;
+        response[1] = mExpected;
+        return 2;
+    }
+
+    Slot &slot = mSlots[mExpected % cWindow];
+    if (!slot.full) {
+        if (mOutOfWindow) {
+            mOutOfWindow = false;
+            response[0] = cAck;
+            response[1] = mExpected;
+            return 2;
+        }
+        return 0;
+    }
+
+    bool ok = true;
+    if (slot.len == 0) {
+        mComplete = mCompressed ? mDecoder.finish() : mOffset == mSize;
+        mActive = false;
+        ok = mComplete;
+    } else {
+        ok = program(slot);
+    }
+    slot.full = false;
+
+    if (!ok) {
+        mActive = false;
+        response[0] = cFailed;
+        response[1] = mExpected;
+        return 2;
+    }
+
+    mExpected = mExpected + 1;
+    response[0] = cAck;
+    response[1] = mExpected;
+    return 2;
+}
+
+bool BinaryTransfer::program(const Slot &slot) {
+    if (mCompressed) {
+        return mDecoder.decode(slot.data, slot.len);
+    }
+
+    // Only the last chunk may leave the flash address unaligned
+    if (slot.len > mSize - mOffset || (slot.len % sizeof(uint64_t) != 0 && mOffset + slot.len != mSize)) {
+        return false;
+    }
+    bool ok = mFlash.write(mAddress + mOffset, slot.data, slot.len);
+    mOffset += slot.len;
+    return ok;
+}
+
+bool BinaryTransfer::isActive() const {
+    return mActive;
+}
+
+bool BinaryTransfer::isComplete() const {
+    return mComplete;
+}
@@ -0,0 +1,113 @@
+#ifndef BINARY_TRANSFER_H
+#define BINARY_TRANSFER_H
+
+#include "iflash.h"
+#include "lzss_decoder.h"
+#include <cstdint>
+#include <cstddef>
+
+/// @brief Receives a firmware image as binary frames and programs it into flash.
+///
+/// Each frame is `[0xA5, seq, len (LE16), data[len], crc (LE16)]`, where the CRC-16/CCITT-FALSE
+/// covers seq, len and data. A frame with zero length ends the transfer. The frames are parsed
+/// byte by byte from the UART interrupt into one of cWindow buffers, so the host may send
+/// cWindow frames ahead while the main loop programs the oldest one.
+///
+/// Every programmed frame is answered with `[cAck, next seq]`. A frame with a wrong CRC is
+/// answered with `[cNak, next seq]` and a frame outside the window with the current ack, the
+/// host resends from the reported sequence number. `[cFailed, next seq]` aborts the transfer.
+///
+/// A compressed image is an LZSS stream (see LzssDecoder), the frames then carry the stream and
+/// the size passed to begin() is the size of the decompressed image.
+class BinaryTransfer
+{
+public:
+    static constexpr size_t cMaxChunkSize = 256; ///< Maximal data size of a frame.
+    static constexpr size_t cWindow = 4;         ///< Number of frames the host may send ahead, divides 256.
+    static constexpr uint8_t cFrameStart = 0xA5; ///< First byte of a frame.
+    static constexpr uint8_t cAck = 0x06;        ///< Frame programmed.
+    static constexpr uint8_t cNak = 0x15;        ///< Frame corrupted.
+    static constexpr uint8_t cFailed = 0x18;     ///< Transfer aborted.
+
+    /// @brief Constructs an inactive transfer.
+    /// @param flash Reference to the flash the image is programmed into.
+    BinaryTransfer(IFlash &flash);
+
+    /// @brief Erases the flash for the image and starts accepting frames.
+    ///
+    /// All pages are erased up front, as the CPU stalls during a page erase and would lose
+    /// incoming bytes.
+    ///
+    /// @param address The flash address of the image.
+    /// @param size The size of the image in bytes.
+    /// @param compressed `true` if the frames carry an LZSS stream of the image.
+    /// @return `true` if the flash was erased, `false` otherwise.
+    bool begin(uint32_t address, uint32_t size, bool compressed = false);
+
+    /// @brief Parses a received byte, called from the UART interrupt.
+    /// @param data The received byte.
+    void receive(uint8_t data);
+
+    /// @brief Programs the received frames and queues the responses, called from the main loop.
+    /// @param response Buffer for a response to send, at least 2 bytes.
+    /// @return The number of response bytes, 0 if there is nothing to send.
+    size_t process(uint8_t *response);
+
+    /// @brief Checks whether a transfer is in progress.
+    /// @return `true` from begin() until the final frame or an error.
+    bool isActive() const;
+
+    /// @brief Checks whether the last transfer received the whole image.
+    /// @return `true` if the final frame was received after the whole image was programmed.
+    bool isComplete() const;
+
+private:
+    /// @brief States of the frame parser.
+    enum class RxState : uint8_t {
+        SYNC,
+        SEQ,
+        LEN_LO,
+        LEN_HI,
+        DATA,
+        CRC_LO,
+        CRC_HI,
+    };
+
+    /// @brief Buffer for a single frame.
+    struct Slot
+    {
+        uint8_t data[cMaxChunkSize]; ///< Frame data.
+        uint16_t len;                ///< Frame data length.
+        uint8_t seq;                 ///< Frame sequence number.
+        volatile bool full;          ///< Set by the interrupt, cleared once programmed.
+    };
+
+    /// @brief Programs the data of a frame.
+    /// @param slot The frame.
+    /// @return `true` on success, `false` if the data does not fit the image or programming failed.
+    bool program(const Slot &slot);
+
+    IFlash &mFlash;
+    LzssDecoder mDecoder;         ///< Decoder of a compressed image.
+    Slot mSlots[cWindow];
+    uint32_t mAddress;            ///< Flash address of the image.
+    uint32_t mSize;               ///< Image size.
+    uint32_t mOffset;             ///< Number of programmed bytes of an uncompressed image.
+    bool mCompressed;             ///< Set if the frames carry an LZSS stream.
+    volatile uint8_t mExpected;   ///< Sequence number of the next frame to program.
+    volatile bool mActive;        ///< Set while frames are accepted.
+    bool mComplete;               ///< Set when the whole image was received.
+    volatile bool mCrcError;      ///< Set by the interrupt when a frame had a wrong CRC.
+    volatile bool mOutOfWindow;   ///< Set by the interrupt when a frame outside the window was dropped.
+
+    // Parser state, used only by the interrupt
+    RxState mRxState;
+    uint8_t mRxSeq;
+    uint16_t mRxLen;
+    uint16_t mRxPos;
+    uint16_t mRxCrc;
+    uint16_t mRxFrameCrc;
+    Slot *mRxSlot;                ///< Buffer of the frame being received, nullptr if it is dropped.
+};
+
+#endif // BINARY_TRANSFER_H
@@ -0,0 +1,93 @@
+#include "lzss_decoder.h"
+
+LzssDecoder::LzssDecoder(IFlash &flash): mFlash(flash), mAddress(0), mSize(0), mWritten(0), mFlushed(0), mBuffer{},
+                                         mState(State::FLAGS), mFlags(0), mItems(0), mMatchLo(0) {
+}
+
+void LzssDecoder::begin(uint32_t address, uint32_t size) {
+    mAddress = address;
+    mSize = size;
+    mWritten = 0;
+    mFlushed = 0;
+    mState = State::FLAGS;
+    mItems = 0;
+}
+
+bool LzssDecoder::decode(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t byte = data[i];
+
+        switch (mState) {
+        case State::FLAGS:
+            mFlags = byte;
+            mItems = 8;
+            mState = State::ITEM;
+            break;
+
+        case State::ITEM:
+            if (mFlags & 1) {
+                if (!put(byte)) {
+                    return false;
+                }
+                mFlags >>= 1;
+                mState = --mItems ? State::ITEM : State::FLAGS;
+            } else {
+                mMatchLo = byte;
+                mState = State::MATCH_HI;
+            }
+            break;
+
+        case State::MATCH_HI: {
+            size_t distance = (mMatchLo | static_cast<size_t>(byte >> 4) << 8) + 1;
+            size_t length = (byte & 0x0F) + cMinMatch;
+            if (distance > mWritten) {
+                return false;
+            }
+            for (size_t n = 0; n < length; n++) {
+                if (!put(history(distance))) {
+                    return false;
+                }
+            }
+            mFlags >>= 1;
+            mState = --mItems ? State::ITEM : State::FLAGS;
+            break;
+        }
+        }
+    }
+    return true;
+}
+
+bool LzssDecoder::finish() {
+    return mWritten == mSize && flush();
+}
+
+bool LzssDecoder::put(uint8_t data) {
+    if (mWritten >= mSize) {
+        return false;
+    }
+    mBuffer[mWritten - mFlushed] = data;
+    mWritten++;
+    return mWritten - mFlushed < cBufferSize || flush();
+}
+
+bool LzssDecoder::flush() {
+    size_t len = mWritten - mFlushed;
+    if (len == 0) {
+        return true;
+    }
+    if (!mFlash.write(mAddress + mFlushed, mBuffer, len)) {
+        return false;
+    }
+    mFlushed = mWritten;
+    return true;
+}
+
+uint8_t LzssDecoder::history(size_t distance) {
+    uint32_t position = mWritten - distance;
+    if (position >= mFlushed) {
+        return mBuffer[position - mFlushed];
+    }
+    uint8_t data = 0;
+    mFlash.read(mAddress + position, &data, 1);
+    return data;
+}
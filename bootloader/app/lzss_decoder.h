@@ -0,0 +1,78 @@
+#ifndef LZSS_DECODER_H
+#define LZSS_DECODER_H
+
+#include "iflash.h"
+#include <cstdint>
+#include <cstddef>
+
+/// @brief Streaming LZSS decoder writing the decompressed image into flash.
+///
+/// The stream consists of groups of a flag byte followed by up to 8 items, flag bit i (LSB first)
+/// describes item i: 1 is a literal byte, 0 is a match of two bytes `[offset low, offset high << 4 | length - 3]`,
+/// which copies 3 to 18 bytes starting 1 to 4096 bytes back. The stream ends when the expected size is produced.
+///
+/// The decoded data is collected in a small buffer and programmed when the buffer is full. Matches
+/// reaching behind the buffer read the already programmed bytes back from flash, so the whole
+/// window does not have to be kept in RAM. tools/lzss_pack.py creates the stream.
+class LzssDecoder
+{
+public:
+    static constexpr size_t cWindowSize = 4096; ///< Maximal match distance.
+    static constexpr size_t cMinMatch = 3;      ///< Minimal match length.
+
+    /// @brief Constructs the decoder.
+    /// @param flash Reference to the flash the data is written into.
+    LzssDecoder(IFlash &flash);
+
+    /// @brief Starts decoding an image into erased flash.
+    /// @param address The flash address of the image.
+    /// @param size The size of the decompressed image in bytes.
+    void begin(uint32_t address, uint32_t size);
+
+    /// @brief Decodes a part of the compressed stream.
+    /// @param data Pointer to the compressed data.
+    /// @param len The length of the compressed data.
+    /// @return `true` on success, `false` if the stream is corrupted or programming failed.
+    bool decode(const uint8_t *data, size_t len);
+
+    /// @brief Programs the remaining data.
+    /// @return `true` if exactly the expected size was decoded and programmed, `false` otherwise.
+    bool finish();
+
+private:
+    static constexpr size_t cBufferSize = 256; ///< Size of the output buffer, a multiple of the programming unit.
+
+    /// @brief States of the stream parser.
+    enum class State : uint8_t {
+        FLAGS,
+        ITEM,
+        MATCH_HI,
+    };
+
+    /// @brief Appends a decoded byte, programs the buffer when it is full.
+    /// @param data The decoded byte.
+    /// @return `true` on success, `false` if the image is complete or programming failed.
+    bool put(uint8_t data);
+
+    /// @brief Programs the buffered data.
+    /// @return `true` on success, `false` otherwise.
+    bool flush();
+
+    /// @brief Returns an already decoded byte.
+    /// @param distance The distance back from the next output byte (1 to cWindowSize).
+    /// @return The decoded byte.
+    uint8_t history(size_t distance);
+
+    IFlash &mFlash;
+    uint32_t mAddress;             ///< Flash address of the image.
+    uint32_t mSize;                ///< Size of the decompressed image.
+    uint32_t mWritten;             ///< Number of decoded bytes.
+    uint32_t mFlushed;             ///< Number of programmed bytes.
+    uint8_t mBuffer[cBufferSize];  ///< Decoded bytes which are not programmed yet.
+    State mState;
+    uint8_t mFlags;                ///< Flags of the current group, shifted as items are decoded.
+    uint8_t mItems;                ///< Number of items left in the current group.
+    uint8_t mMatchLo;              ///< First byte of the current match.
+};
+
+#endif // LZSS_DECODER_H
@@ -3,8 +3,18 @@
 #include "protocol2.h"
 #include "flash.h"
 #include "version.h"
+#include "binary_transfer.h"
+#include "crc32.h"
+#include "boot_request.h"
+#include "image_header.h"
+#include "stm32f1xx_hal.h"
+#include <cstddef>
 
 #define ETX_APP_START_ADDRESS 0x08005000
+#define ETX_APP_MAX_SIZE (44 * 1024)
+#define BOOT_WAIT_TIME 100
+#define SWITCH_WAIT_TIME 1000
+#define UPDATE_TIMEOUT 30000
 #define BOOTLOADER_VER "BootBS v1.0_" VERSION
 UartStream *UartStream::mInstance = nullptr;
 
@@ -19,10 +29,9 @@ public:
   {
     struct
     {
-      uint16_t ptr;
-      uint16_t len;
-      uint8_t data[64];
-    } updateFirmware;
+      uint32_t size;      ///< Size of the image in bytes.
+      uint8_t compressed; ///< 1 if the frames carry an LZSS stream of the image.
+    } beginTransfer;
     uint8_t raw[32];
   };
 
@@ -34,16 +43,24 @@ public:
     {
       char string[32]; ///< Application version string.
     } appVersion;
+    struct
+    {
+      uint8_t result;     ///< 1 if the flash was erased and binary frames are accepted.
+      uint8_t window;     ///< Number of frames which may be sent ahead.
+      uint16_t chunkSize; ///< Maximal data size of a frame.
+    } beginTransfer;
     uint8_t result;
     uint8_t raw[32];
   };
 
+  Bootloader() : mTransfer(mFlash), mAppValid(false) {}
+
   void registerCommands(Protocol<InProtocolData, OutProtocolData, 10> &protocol) {
     protocol.registerCmd('v', [&](const Bootloader::InProtocolData &in, Bootloader::OutProtocolData &out, size_t &outlen) {
         return this->sendBootloaderVersion(in, out, outlen);
     });
-    protocol.registerCmd('u', [&](const Bootloader::InProtocolData &in, Bootloader::OutProtocolData &out, size_t &outlen) {
-        return this->updateFirmware(in, out, outlen);
+    protocol.registerCmd('b', [&](const Bootloader::InProtocolData &in, Bootloader::OutProtocolData &out, size_t &outlen) {
+        return this->beginTransfer(in, out, outlen);
     });
 
   }
@@ -51,7 +68,9 @@ public:
     void gotoApplication()
     {
         LOG << "Gonna Jump to Application...";
-        sleep(100);
+        // Let the last byte leave the shift register before the application reinitializes the UART
+        UartStream::getInstance()->flush();
+        sleep(1);
         void (*app_reset_handler)(void) = (void (*)())(*((volatile uint32_t *)(ETX_APP_START_ADDRESS + 4U)));
 
         if (app_reset_handler == (void (*)())0xFFFFFFFF)
@@ -70,16 +89,95 @@ public:
         return true;
     }
 
-    bool updateFirmware(const InProtocolData &in, OutProtocolData &out, size_t &outlen)
+    /// @brief Erases the application and switches the UART to binary frames, see BinaryTransfer.
+    bool beginTransfer(const InProtocolData &in, OutProtocolData &out, size_t &outlen)
     {
-      if(in.updateFirmware.ptr == 0) {
-        mFlash.erase(ETX_APP_START_ADDRESS,4096);
+      out.beginTransfer.window = BinaryTransfer::cWindow;
+      out.beginTransfer.chunkSize = BinaryTransfer::cMaxChunkSize;
+      out.beginTransfer.result = 0;
+      outlen = sizeof(out.beginTransfer);
+
+      // The application is erased, even if the transfer fails
+      mAppValid = false;
+      if (in.beginTransfer.size > ETX_APP_MAX_SIZE || !mTransfer.begin(ETX_APP_START_ADDRESS, in.beginTransfer.size, in.beginTransfer.compressed)) {
+        return true;
       }
+      // The host sends the first frame only after the response, so no byte is lost
+      UartStream::getInstance()->setRawReceiver([this](uint8_t data) { this->mTransfer.receive(data); });
+      out.beginTransfer.result = 1;
       return true;
     }
 
+    /// @brief Programs received frames and answers them, returns to text commands when the transfer ends.
+    void process()
+    {
+      uint8_t response[2];
+      size_t len = mTransfer.process(response);
+      if (len == 0) {
+        return;
+      }
+      if (!mTransfer.isActive()) {
+        UartStream::getInstance()->setRawReceiver(nullptr);
+      }
+      UartStream::getInstance()->write(response, len);
+      if (mTransfer.isComplete()) {
+        checkApplication();
+      }
+    }
+
+    /// @brief Verifies the image header and CRC of the application and logs the verification time.
+    void checkApplication()
+    {
+      const ImageHeader *header = reinterpret_cast<const ImageHeader *>(ETX_APP_START_ADDRESS + cImageHeaderOffset);
+      mAppValid = false;
+
+      if (header->magic != cImageMagic || header->size % sizeof(uint32_t) != 0 ||
+          header->size < cImageHeaderOffset + sizeof(ImageHeader) || header->size > ETX_APP_MAX_SIZE) {
+        LOG << "No valid application header";
+        return;
+      }
+
+      CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+      DWT->CYCCNT = 0;
+      DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+      // The CRC is calculated with the crc field set to zero
+      const uint32_t *image = reinterpret_cast<const uint32_t *>(ETX_APP_START_ADDRESS);
+      const size_t crcWord = (cImageHeaderOffset + offsetof(ImageHeader, crc)) / sizeof(uint32_t);
+      const uint32_t zero = 0;
+      mCrc.reset();
+      mCrc.accumulate(image, crcWord);
+      mCrc.accumulate(&zero, 1);
+      uint32_t crc = mCrc.accumulate(image + crcWord + 1, header->size / sizeof(uint32_t) - crcWord - 1);
+
+      uint32_t time_us = DWT->CYCCNT / (SystemCoreClock / 1000000);
+      mAppValid = crc == header->crc;
+
+      char version[sizeof(header->version) + 1] = {};
+      memcpy(version, header->version, sizeof(header->version));
+      LOG << "Application " << version << (mAppValid ? " valid" : " corrupted") << ", verified in " << time_us << " us";
+    }
+
+    bool isApplicationValid() const
+    {
+      return mAppValid;
+    }
+
+    bool isUpdating() const
+    {
+      return mTransfer.isActive();
+    }
+
+    bool isTransferComplete() const
+    {
+      return mTransfer.isComplete();
+    }
+
     private:
     Flash mFlash;
+    BinaryTransfer mTransfer;
+    Crc32 mCrc;
+    bool mAppValid; ///< Set when the application image passed the CRC check.
 };
 
 int main()
@@ -95,7 +193,28 @@ int main()
     char inBuff[128] = {};
     char outBuff[128] = {};
 
-    for (size_t i = 0; i < 100; i++)
+    bootloader.registerCommands(protocol);
+    bootloader.checkApplication();
+
+    // Start the application right away unless the update mode is requested by the application
+    // or by holding the test switch, or there is no valid application
+    BootRequest bootRequest;
+    bool updateRequested = bootRequest.take();
+    bool switchHeld = !bsp.testSwitch->get();
+    if (!updateRequested && !switchHeld && bootloader.isApplicationValid())
+    {
+        bootloader.gotoApplication();
+    }
+    LOG << "Update mode";
+
+    // The application uses the held test switch for the brightness setting, so the switch only
+    // opens a short window, extended by the first command
+    uint32_t timeout = updateRequested ? UPDATE_TIMEOUT : SWITCH_WAIT_TIME;
+
+    // Leave the update mode shortly after a completed transfer or after a period without commands
+    uint32_t lastActivity = getTime();
+    while (bootloader.isUpdating() || !bootloader.isApplicationValid() ||
+           getTime() - lastActivity < (bootloader.isTransferComplete() ? BOOT_WAIT_TIME : timeout))
     {
         if (UartStream::getInstance()->readLine(inBuff, sizeof(inBuff), 0))
         {
@@ -103,8 +222,19 @@ int main()
             {
                 Logger() << outBuff;
             }
+            lastActivity = getTime();
+            timeout = UPDATE_TIMEOUT;
+        }
+
+        if (bootloader.isUpdating())
+        {
+            bootloader.process();
+            lastActivity = getTime();
+        }
+        else
+        {
+            sleep(10);
         }
-        sleep(10);
     }
 
     bootloader.gotoApplication();
@@ -1,8 +1,17 @@
 #include "bsp.h"
 #include "stm32f1xx_hal.h"
 #include "gpio.h"
-#include "i2c_master.h"
 #include "uart.h"
+#include "static_storage.h"
+
+namespace {
+  // Peripheral objects, constructed by Bsp::Bsp() after the clock is configured
+  StaticStorage<Gpio> rxPinStorage;
+  StaticStorage<Gpio> txPinStorage;
+  StaticStorage<Uart> uartBusStorage;
+  StaticStorage<Gpio> ledPinStorage;
+  StaticStorage<Gpio> testSwitchStorage;
+}
 
 Bsp::Bsp()
 {
@@ -10,12 +19,14 @@ Bsp::Bsp()
   __HAL_RCC_AFIO_CLK_ENABLE();
   __HAL_RCC_PWR_CLK_ENABLE();
 	initClock();
-	mRxPin.reset(new Gpio(GPIOA, GPIO_PIN_9, GPIO_MODE_AF_PP, GPIO_NOPULL, 0));
-	mTxPin.reset(new Gpio(GPIOA, GPIO_PIN_10, GPIO_MODE_INPUT, GPIO_NOPULL, 0));
-  uartBus.reset(new Uart(USART1, 115200));
+  rxPinStorage.create(GPIOA, GPIO_PIN_9, GPIO_MODE_AF_PP, GPIO_NOPULL, 0);
+  txPinStorage.create(GPIOA, GPIO_PIN_10, GPIO_MODE_INPUT, GPIO_NOPULL, 0);
+  uartBus = uartBusStorage.create(USART1, 115200);
 
-  ledPin.reset(new Gpio(GPIOC, GPIO_PIN_13, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL, 0));
+  ledPin = ledPinStorage.create(GPIOC, GPIO_PIN_13, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL, 0);
   ledPin->reset();
+
+  testSwitch = testSwitchStorage.create(GPIOC, GPIO_PIN_5, GPIO_MODE_INPUT, GPIO_PULLUP, 0);
 }
 
 void Bsp::reset()
@@ -30,22 +41,25 @@ void Bsp::initClock()
 
   /** Initializes the RCC Oscillators according to the specified parameters
   * in the RCC_OscInitTypeDef structure.
+  * Same 64 MHz clock as the application, SystemInit() of the application resets it before reconfiguring.
   */
   RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI;
   RCC_OscInitStruct.HSIState = RCC_HSI_ON;
   RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
-  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
+  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
+  RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSI_DIV2;
+  RCC_OscInitStruct.PLL.PLLMUL = RCC_PLL_MUL16;
   HAL_RCC_OscConfig(&RCC_OscInitStruct);
 
   /** Initializes the CPU, AHB and APB buses clocks
   */
   RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
                               |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
-  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
+  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
   RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
-  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
+  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV2;
   RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
-  HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_0);
+  HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_2);
 }
 
 extern "C"
@@ -112,7 +126,11 @@ extern "C"
 }
 
 void sleep(uint32_t time_ms) {
-    HAL_Delay(time_ms);
+  uint32_t start = HAL_GetTick();
+  // The current tick is partly over, one more gives at least time_ms like HAL_Delay()
+  while (HAL_GetTick() - start <= time_ms) {
+    __WFI();
+  }
 }
 
 uint32_t getTime() {
@@ -3,13 +3,14 @@
 
 #include "igpio.h"
 #include "iuart.h"
-#include "iflash.h"
-#include <memory>
 
 /// @class Bsp
 /// @brief Board Support Package (BSP) class.
 ///
 /// This class provides the initialization and management of hardware resources 
+///
+/// The peripheral objects are placed in static storage (see StaticStorage) instead of the heap,
+/// the heap is not used at all. There must be only one instance.
 class Bsp {
 public:
     /// @brief Constructor for the Bsp class.
@@ -19,31 +20,25 @@ public:
 
     void reset();
     
-    /// @brief Unique pointer to a UART interface.
+    /// @brief Pointer to a UART interface.
     ///
     /// This pointer is used to manage the UART bus.
-    std::unique_ptr<IUart> uartBus;
-
-    std::unique_ptr<IGpio> ledPin;
+    IUart *uartBus;
 
-    std::unique_ptr<IFlash> intFlash;
-private:
-    /// @brief Unique pointer to the GPIO pin used for RX.
-    ///
-    /// This pointer is used to manage the RX GPIO pin.
-    std::unique_ptr<IGpio> mRxPin;
+    IGpio *ledPin;
 
-    /// @brief Unique pointer to the GPIO pin used for TX.
-    ///
-    /// This pointer is used to manage the TX GPIO pin.
-    std::unique_ptr<IGpio> mTxPin;
+    /// @brief Test switch, held at power-up to stay in update mode.
+    IGpio *testSwitch;
 
+private:
     /// @brief Initializes the clock for the board.
     ///
     /// This method sets up the necessary clock configuration for the board.
     void initClock();
 };
 
+/// @brief Waits for the given time, the CPU sleeps with WFI until an interrupt.
+/// @param time_ms Minimal time to wait [ms].
 void sleep(uint32_t time_ms);
 uint32_t getTime();
 
@@ -0,0 +1,21 @@
+#include "boot_request.h"
+#include "stm32f1xx_hal.h"
+
+BootRequest::BootRequest()
+{
+    __HAL_RCC_PWR_CLK_ENABLE();
+    __HAL_RCC_BKP_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+}
+
+void BootRequest::set()
+{
+    BKP->DR1 = cMagic;
+}
+
+bool BootRequest::take()
+{
+    bool requested = (BKP->DR1 & 0xFFFF) == cMagic;
+    BKP->DR1 = 0;
+    return requested;
+}
@@ -0,0 +1,27 @@
+#ifndef BOOT_REQUEST_H
+#define BOOT_REQUEST_H
+
+#include <cstdint>
+
+/// @brief Request for the bootloader to stay in update mode, kept in a backup register.
+///
+/// The backup registers keep their value across a system reset, so the application sets the
+/// request right before resetting and the bootloader takes it on start.
+class BootRequest
+{
+public:
+    /// @brief Enables access to the backup registers.
+    BootRequest();
+
+    /// @brief Requests the update mode for the next start of the bootloader.
+    void set();
+
+    /// @brief Checks and clears the request.
+    /// @return `true` if the update mode was requested, `false` otherwise.
+    bool take();
+
+private:
+    static constexpr uint16_t cMagic = 0xB007; ///< Value of the backup register requesting the update mode.
+};
+
+#endif // BOOT_REQUEST_H
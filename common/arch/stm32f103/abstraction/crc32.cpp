@@ -0,0 +1,32 @@
+#include "crc32.h"
+#include "stm32f1xx_hal.h"
+
+Crc32::Crc32()
+{
+    __HAL_RCC_CRC_CLK_ENABLE();
+    reset();
+}
+
+void Crc32::reset()
+{
+    CRC->CR = CRC_CR_RESET;
+}
+
+uint32_t Crc32::accumulate(const uint32_t *data, size_t words)
+{
+    // Each write takes a single cycle of the unit, so the loop is limited by the flash reads
+    while (words >= 4)
+    {
+        CRC->DR = data[0];
+        CRC->DR = data[1];
+        CRC->DR = data[2];
+        CRC->DR = data[3];
+        data += 4;
+        words -= 4;
+    }
+    while (words--)
+    {
+        CRC->DR = *data++;
+    }
+    return CRC->DR;
+}
@@ -0,0 +1,27 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <cstdint>
+#include <cstddef>
+
+/// @brief CRC-32 calculation with the hardware CRC unit of STM32F1.
+///
+/// The unit calculates the CRC-32 (polynomial 0x04C11DB7) of 32-bit words, starting from
+/// 0xFFFFFFFF, without reflection and final XOR.
+class Crc32
+{
+public:
+    /// @brief Enables the CRC unit and resets the calculation.
+    Crc32();
+
+    /// @brief Starts a new calculation.
+    void reset();
+
+    /// @brief Adds words to the calculation.
+    /// @param data Pointer to the words.
+    /// @param words The number of words.
+    /// @return The CRC of all words added since the last reset.
+    uint32_t accumulate(const uint32_t *data, size_t words);
+};
+
+#endif // CRC32_H
@@ -64,7 +64,7 @@ bool Flash::write(uint32_t address, const uint8_t *data, size_t size)
     // Lock the Flash to disable the flash control register access
     HAL_FLASH_Lock();
 
-    return true;
+    return status == HAL_OK;
 }
 
 bool Flash::read(uint32_t address, uint8_t *data, size_t size)
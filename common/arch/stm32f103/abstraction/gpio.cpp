@@ -1,5 +1,7 @@
 #include "gpio.h"
 
+Delegate<void()> edgeCallbacks[16] = {};
+
 Gpio::Gpio(GPIO_TypeDef *port, uint16_t pin, uint32_t mode, uint8_t pull, uint8_t alternative) : mPort(port), mPin(pin)
 {
     if (port == GPIOA)
@@ -37,4 +39,81 @@ void Gpio::set(bool state)
 bool Gpio::get() const
 {
     return HAL_GPIO_ReadPin(mPort, mPin) == GPIO_PIN_SET;
-}
\ No newline at end of file
+}
+
+bool Gpio::registerEdgeCallback(Delegate<void()> callback)
+{
+    size_t line = __builtin_ctz(mPin);
+    IRQn_Type irq;
+    if (line <= 4)
+    {
+        irq = static_cast<IRQn_Type>(EXTI0_IRQn + line);
+    }
+    else if (line <= 9)
+    {
+        irq = EXTI9_5_IRQn;
+    }
+    else
+    {
+        irq = EXTI15_10_IRQn;
+    }
+
+    edgeCallbacks[line] = callback;
+    __HAL_GPIO_EXTI_CLEAR_IT(mPin);
+    HAL_NVIC_SetPriority(irq, cExtiPriority, 0);
+    HAL_NVIC_EnableIRQ(irq);
+    return true;
+}
+
+extern "C"
+{
+    void HAL_GPIO_EXTI_Callback(uint16_t pin)
+    {
+        size_t line = __builtin_ctz(pin);
+        if (edgeCallbacks[line])
+        {
+            edgeCallbacks[line]();
+        }
+    }
+
+    void EXTI0_IRQHandler(void)
+    {
+        HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_0);
+    }
+
+    void EXTI1_IRQHandler(void)
+    {
+        HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_1);
+    }
+
+    void EXTI2_IRQHandler(void)
+    {
+        HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_2);
+    }
+
+    void EXTI3_IRQHandler(void)
+    {
+        HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_3);
+    }
+
+    void EXTI4_IRQHandler(void)
+    {
+        HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_4);
+    }
+
+    void EXTI9_5_IRQHandler(void)
+    {
+        for (uint16_t pin = GPIO_PIN_5; pin <= GPIO_PIN_9; pin <<= 1)
+        {
+            HAL_GPIO_EXTI_IRQHandler(pin);
+        }
+    }
+
+    void EXTI15_10_IRQHandler(void)
+    {
+        for (uint32_t pin = GPIO_PIN_10; pin <= GPIO_PIN_15; pin <<= 1)
+        {
+            HAL_GPIO_EXTI_IRQHandler(pin);
+        }
+    }
+}
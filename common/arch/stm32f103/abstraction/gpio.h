@@ -31,14 +31,25 @@ public:
     /// @brief Sets the state of the GPIO pin.
     ///
     /// @param state The desired state of the GPIO pin (true for high, false for low).
-    virtual void set(bool state);
+    virtual void set(bool state) override;
 
     /// @brief Gets the current state of the GPIO pin.
     ///
     /// @return true if the GPIO pin is high, false if it is low.
-    virtual bool get() const;
+    virtual bool get() const override;
+
+    /// @brief Registers a callback function to be called on every edge of the pin.
+    ///
+    /// The pin must be configured with an interrupt mode (e.g. GPIO_MODE_IT_RISING_FALLING). Only
+    /// one pin per pin number can use the interrupt, as the EXTI lines are shared by the ports.
+    ///
+    /// @param callback The callback function, called from the EXTI interrupt.
+    /// @return true if the interrupt was enabled.
+    virtual bool registerEdgeCallback(Delegate<void()> callback) override;
 
 private:
+    static constexpr uint32_t cExtiPriority = 5; ///< Priority of the EXTI interrupts.
+
     GPIO_TypeDef* mPort; ///< The GPIO port associated with this pin.
     uint16_t mPin;       ///< The GPIO pin number.
 };
@@ -1,23 +1,41 @@
 #include "i2c_master.h"
 #include "cassert"
 
-I2cMaster::I2cMaster(I2C_TypeDef *instance)
+I2cMaster *i2cMasters[2] = {};           ///< Objects of I2C1 and I2C2, served by the interrupt handlers.
+I2C_HandleTypeDef *i2cHandles[2] = {};   ///< HAL handles of I2C1 and I2C2.
+
+I2cMaster::I2cMaster(I2C_TypeDef *instance, uint32_t speed)
+    : mSpeed(cStandardSpeed), mActiveSpeed(cStandardSpeed), mDemoted{}, mFailures{}, mAsyncState(AsyncState::IDLE),
+      mAsyncResult(true), mAsyncRetry(false), mAsyncStart(0), mAsyncAddr(0), mAsyncReg(0), mAsyncLen(0), mAsyncData(nullptr)
 {
     if (instance == I2C1)
     {
         __I2C1_CLK_ENABLE();
+        i2cMasters[0] = this;
+        i2cHandles[0] = &mI2cHandler;
+        HAL_NVIC_SetPriority(I2C1_EV_IRQn, cIrqPriority, 0);
+        HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+        HAL_NVIC_SetPriority(I2C1_ER_IRQn, cIrqPriority, 0);
+        HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
     }
     else if (instance == I2C2)
     {
         __I2C2_CLK_ENABLE();
+        i2cMasters[1] = this;
+        i2cHandles[1] = &mI2cHandler;
+        HAL_NVIC_SetPriority(I2C2_EV_IRQn, cIrqPriority, 0);
+        HAL_NVIC_EnableIRQ(I2C2_EV_IRQn);
+        HAL_NVIC_SetPriority(I2C2_ER_IRQn, cIrqPriority, 0);
+        HAL_NVIC_EnableIRQ(I2C2_ER_IRQn);
     }
     else
     {
         assert("Unsuported I2C instance");
     }
 
+    setSpeed(speed);
     mI2cHandler.Instance = instance;
-    mI2cHandler.Init.ClockSpeed = 100000;
+    mI2cHandler.Init.ClockSpeed = mSpeed;
     mI2cHandler.Init.DutyCycle = I2C_DUTYCYCLE_2;
     mI2cHandler.Init.OwnAddress1 = 0;
     mI2cHandler.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
@@ -25,17 +43,25 @@ I2cMaster::I2cMaster(I2C_TypeDef *instance)
     mI2cHandler.Init.OwnAddress2 = 0;
     mI2cHandler.Init.GeneralCallMode = I2C_GENERALCALL_DISABLED;
     mI2cHandler.Init.NoStretchMode = I2C_NOSTRETCH_DISABLED;
-    HAL_I2C_Init(&mI2cHandler);
+    configure(mSpeed);
 }
 
 I2cMaster::~I2cMaster()
 {
     if (mI2cHandler.Instance == I2C1)
     {
+        HAL_NVIC_DisableIRQ(I2C1_EV_IRQn);
+        HAL_NVIC_DisableIRQ(I2C1_ER_IRQn);
+        i2cMasters[0] = nullptr;
+        i2cHandles[0] = nullptr;
         __I2C1_CLK_DISABLE();
     }
     else if (mI2cHandler.Instance == I2C2)
     {
+        HAL_NVIC_DisableIRQ(I2C2_EV_IRQn);
+        HAL_NVIC_DisableIRQ(I2C2_ER_IRQn);
+        i2cMasters[1] = nullptr;
+        i2cHandles[1] = nullptr;
         __I2C2_CLK_DISABLE();
     }
     else
@@ -44,43 +70,287 @@ I2cMaster::~I2cMaster()
     }
 }
 
+template <typename F>
+bool I2cMaster::transfer(uint8_t addr, bool repeatable, F operation) const {
+    if (addr >= cAddressCount) {
+        return false;
+    }
+    // The HAL rejects a transfer while the asynchronous read is in progress
+    while (pollAsync()) {
+    }
+    selectSpeed(addr);
+    HAL_StatusTypeDef result = operation();
+    if (result == HAL_OK) {
+        setFailures(addr, 0);
+        return true;
+    }
+    if (isNack(result)) {
+        return false;
+    }
+
+    // The peripheral may be left busy, e.g. after a lost arbitration, so it is initialized
+    // again, directly at the standard speed if the transfer is retried
+    bool retry = repeatable && mActiveSpeed != cStandardSpeed;
+    configure(retry ? cStandardSpeed : mActiveSpeed);
+    if (!retry) {
+        return false;
+    }
+    result = operation();
+    if (result != HAL_OK) {
+        if (!isNack(result)) {
+            configure(cStandardSpeed);
+        }
+        return false;
+    }
+    recordFailure(addr);
+    return true;
+}
+
 bool I2cMaster::isDeviceReady(uint8_t addr) const
 {
     if(addr == 0) {
         return false;
     }
-    HAL_StatusTypeDef result;
-    result = HAL_I2C_IsDeviceReady(&mI2cHandler, (uint16_t)(addr << 1), 1, 1);
-    return result == HAL_OK;
+    return transfer(addr, true, [this, addr]() {
+        return HAL_I2C_IsDeviceReady(&mI2cHandler, (uint16_t)(addr << 1), 1, 1);
+    });
 }
 
 bool I2cMaster::write(uint8_t addr, const uint8_t *data, uint8_t len) {
-    HAL_StatusTypeDef result;
-    result = HAL_I2C_Master_Transmit(&mI2cHandler, addr<<1, const_cast<uint8_t*>(data), len, 100);
-    return result == HAL_OK;
+    return transfer(addr, false, [this, addr, data, len]() {
+        return HAL_I2C_Master_Transmit(&mI2cHandler, addr<<1, const_cast<uint8_t*>(data), len, 100);
+    });
 }
 
 bool I2cMaster::read(uint8_t addr, uint8_t *data, uint8_t len) {
-    HAL_StatusTypeDef result;
-    result = HAL_I2C_Master_Receive(&mI2cHandler, addr<<1, data, len, 100);
-    if(result != HAL_OK) {
-        reinit();
-    }
-    return result == HAL_OK;
+    return transfer(addr, true, [this, addr, data, len]() {
+        return HAL_I2C_Master_Receive(&mI2cHandler, addr<<1, data, len, 100);
+    });
 }
 
 bool I2cMaster::writeRegister(uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len) {
-    HAL_StatusTypeDef result;
-    result = HAL_I2C_Mem_Write(&mI2cHandler, addr<<1, reg, sizeof(reg), const_cast<uint8_t*>(data), len, 100);
-    return result == HAL_OK;
+    return transfer(addr, false, [this, addr, reg, data, len]() {
+        return HAL_I2C_Mem_Write(&mI2cHandler, addr<<1, reg, sizeof(reg), const_cast<uint8_t*>(data), len, 100);
+    });
 }
 
 bool I2cMaster::readRegister(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len) {
-    HAL_StatusTypeDef result;
-    result = HAL_I2C_Mem_Read(&mI2cHandler, addr<<1, reg, sizeof(reg), data, len, 100);
-    return result == HAL_OK;
+    return transfer(addr, true, [this, addr, reg, data, len]() {
+        return HAL_I2C_Mem_Read(&mI2cHandler, addr<<1, reg, sizeof(reg), data, len, 100);
+    });
+}
+
+bool I2cMaster::readRegisterAsync(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len) {
+    if (addr >= cAddressCount || pollAsync()) {
+        return false;
+    }
+    mAsyncAddr = addr;
+    mAsyncReg = reg;
+    mAsyncData = data;
+    mAsyncLen = len;
+    mAsyncRetry = false;
+    selectSpeed(addr);
+    return startAsync();
+}
+
+bool I2cMaster::isBusy() {
+    return pollAsync();
+}
+
+bool I2cMaster::getAsyncResult() const {
+    return mAsyncResult;
+}
+
+void I2cMaster::finishAsync(bool success) {
+    mAsyncState = success ? AsyncState::COMPLETE : AsyncState::FAILED;
+}
+
+bool I2cMaster::startAsync() const {
+    mAsyncStart = HAL_GetTick();
+    mAsyncState = AsyncState::BUSY;
+    if (HAL_I2C_Mem_Read_IT(&mI2cHandler, mAsyncAddr << 1, mAsyncReg, sizeof(mAsyncReg), mAsyncData, mAsyncLen) == HAL_OK) {
+        return true;
+    }
+    // E.g. the bus stayed busy, recover the peripheral like after a failed blocking transfer
+    mAsyncState = AsyncState::IDLE;
+    mAsyncResult = false;
+    configure(mActiveSpeed);
+    return false;
+}
+
+bool I2cMaster::pollAsync() const {
+    switch (mAsyncState) {
+    case AsyncState::BUSY:
+        if (HAL_GetTick() - mAsyncStart <= cTimeout) {
+            return true;
+        }
+        // No interrupt ends a transfer whose clock is held low
+        __HAL_I2C_DISABLE_IT(&mI2cHandler, I2C_IT_EVT | I2C_IT_BUF | I2C_IT_ERR);
+        mAsyncState = AsyncState::IDLE;
+        mAsyncResult = false;
+        configure(mActiveSpeed);
+        return false;
+
+    case AsyncState::COMPLETE:
+        mAsyncState = AsyncState::IDLE;
+        mAsyncResult = true;
+        if (mAsyncRetry) {
+            recordFailure(mAsyncAddr);
+        } else {
+            setFailures(mAsyncAddr, 0);
+        }
+        return false;
+
+    case AsyncState::FAILED: {
+        mAsyncState = AsyncState::IDLE;
+        mAsyncResult = false;
+        if (isNack(HAL_ERROR)) {
+            return false;
+        }
+        // Same recovery as transfer(), a read is always repeatable
+        bool retry = !mAsyncRetry && mActiveSpeed != cStandardSpeed;
+        configure(retry ? cStandardSpeed : mActiveSpeed);
+        if (!retry) {
+            return false;
+        }
+        mAsyncRetry = true;
+        return startAsync();
+    }
+
+    default:
+        return false;
+    }
+}
+
+void I2cMaster::setSpeed(uint32_t speed) {
+    if (speed < cStandardSpeed) {
+        speed = cStandardSpeed;
+    } else if (speed > cFastSpeed) {
+        speed = cFastSpeed;
+    }
+    mSpeed = speed;
+}
+
+uint32_t I2cMaster::probe(uint8_t addr) {
+    if (addr == 0 || addr >= cAddressCount) {
+        return 0;
+    }
+    // Give the device another chance at the bus speed
+    setDemoted(addr, false);
+    setFailures(addr, 0);
+    uint8_t ready = 0;
+    for (uint8_t i = 0; i < cProbeTrials; i++) {
+        ready += checkReady(addr, mSpeed) ? 1 : 0;
+    }
+    if (ready == cProbeTrials) {
+        return mSpeed;
+    }
+    // Unlike transfers, the probe also demotes a device which does not acknowledge its
+    // address reliably at the bus speed
+    if (mSpeed != cStandardSpeed && checkReady(addr, cStandardSpeed)) {
+        setDemoted(addr, true);
+        return cStandardSpeed;
+    }
+    return ready != 0 ? mSpeed : 0;
 }
 
-void I2cMaster::reinit() {
+uint32_t I2cMaster::getSpeed(uint8_t addr) const {
+    return isDemoted(addr) ? cStandardSpeed : mSpeed;
+}
+
+void I2cMaster::selectSpeed(uint8_t addr) const {
+    uint32_t speed = getSpeed(addr);
+    if (speed != mActiveSpeed) {
+        configure(speed);
+    }
+}
+
+void I2cMaster::configure(uint32_t speed) const {
+    mActiveSpeed = speed;
+    mI2cHandler.Init.ClockSpeed = speed;
     HAL_I2C_Init(&mI2cHandler);
-}
\ No newline at end of file
+}
+
+bool I2cMaster::checkReady(uint8_t addr, uint32_t speed) const {
+    if (speed != mActiveSpeed) {
+        configure(speed);
+    }
+    HAL_StatusTypeDef result = HAL_I2C_IsDeviceReady(&mI2cHandler, (uint16_t)(addr << 1), 1, 1);
+    if (result != HAL_OK && !isNack(result)) {
+        configure(speed);
+    }
+    return result == HAL_OK;
+}
+
+bool I2cMaster::isNack(HAL_StatusTypeDef result) const {
+    // HAL_I2C_IsDeviceReady() clears the acknowledge failure without reporting it
+    return result == HAL_ERROR && (HAL_I2C_GetError(&mI2cHandler) & ~HAL_I2C_ERROR_AF) == 0;
+}
+
+bool I2cMaster::isDemoted(uint8_t addr) const {
+    return addr < cAddressCount && (mDemoted[addr / 32] & (1u << (addr % 32))) != 0;
+}
+
+void I2cMaster::setDemoted(uint8_t addr, bool demoted) const {
+    if (addr >= cAddressCount) {
+        return;
+    }
+    if (demoted) {
+        mDemoted[addr / 32] |= 1u << (addr % 32);
+    } else {
+        mDemoted[addr / 32] &= ~(1u << (addr % 32));
+    }
+}
+
+void I2cMaster::recordFailure(uint8_t addr) const {
+    size_t bit = addr * cFailureBits;
+    uint8_t failures = ((mFailures[bit / 32] >> (bit % 32)) & ((1u << cFailureBits) - 1)) + 1;
+    if (failures < cDemoteFailures) {
+        setFailures(addr, failures);
+        return;
+    }
+    setFailures(addr, 0);
+    setDemoted(addr, true);
+}
+
+void I2cMaster::setFailures(uint8_t addr, uint8_t failures) const {
+    if (addr >= cAddressCount) {
+        return;
+    }
+    size_t bit = addr * cFailureBits;
+    uint32_t mask = ((1u << cFailureBits) - 1) << (bit % 32);
+    mFailures[bit / 32] = (mFailures[bit / 32] & ~mask) | ((static_cast<uint32_t>(failures) << (bit % 32)) & mask);
+}
+
+extern "C"
+{
+    void I2C1_EV_IRQHandler(void)
+    {
+        HAL_I2C_EV_IRQHandler(i2cHandles[0]);
+    }
+
+    void I2C1_ER_IRQHandler(void)
+    {
+        HAL_I2C_ER_IRQHandler(i2cHandles[0]);
+    }
+
+    void I2C2_EV_IRQHandler(void)
+    {
+        HAL_I2C_EV_IRQHandler(i2cHandles[1]);
+    }
+
+    void I2C2_ER_IRQHandler(void)
+    {
+        HAL_I2C_ER_IRQHandler(i2cHandles[1]);
+    }
+
+    void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+    {
+        i2cMasters[hi2c->Instance == I2C1 ? 0 : 1]->finishAsync(true);
+    }
+
+    void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+    {
+        i2cMasters[hi2c->Instance == I2C1 ? 0 : 1]->finishAsync(false);
+    }
+}
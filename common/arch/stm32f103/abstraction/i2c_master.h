@@ -16,7 +16,8 @@ public:
     /// Initializes the I2C peripheral with the specified instance.
     /// 
     /// @param instance A pointer to the I2C peripheral instance (e.g., I2C1, I2C2).
-    I2cMaster(I2C_TypeDef *instance);
+    /// @param speed The clock speed of the bus [Hz], at most cFastSpeed.
+    I2cMaster(I2C_TypeDef *instance, uint32_t speed = cStandardSpeed);
 
     /// @brief Destroys the I2cMaster object.
     /// 
@@ -73,8 +74,117 @@ public:
     /// @return True if the data was successfully received, false otherwise.
     virtual bool readRegister(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len) override;
 
+    /// @brief Starts reading a register in interrupt mode.
+    ///
+    /// The read runs from the I2C interrupts, so the two buses transfer concurrently. It is
+    /// retried at the standard speed and demotes the device like a blocking read, see transfer().
+    ///
+    /// @param addr The 7-bit I2C address of the device.
+    /// @param reg The register address to read from.
+    /// @param data Pointer to the buffer for the received data, it must stay valid until isBusy() returns false.
+    /// @param len The number of bytes to read.
+    /// @return True if the read was started, false otherwise.
+    virtual bool readRegisterAsync(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len) override;
+
+    virtual bool isBusy() override;
+
+    virtual bool getAsyncResult() const override;
+
+    /// @brief Ends the pending asynchronous read, called by the I2C interrupt handlers.
+    ///
+    /// @param success Set if the data was received, cleared on an error.
+    void finishAsync(bool success);
+
+    virtual void setSpeed(uint32_t speed) override;
+
+    virtual uint32_t probe(uint8_t addr) override;
+
+    virtual uint32_t getSpeed(uint8_t addr) const override;
+
+    static constexpr uint32_t cStandardSpeed = 100000; ///< Standard-mode clock speed [Hz].
+    static constexpr uint32_t cFastSpeed = 400000;     ///< Fast-mode clock speed [Hz].
+
 private:
-void reinit();
+    static constexpr uint8_t cAddressCount = 128; ///< Number of 7-bit I2C addresses.
+    static constexpr uint8_t cProbeTrials = 3;    ///< Number of checks of a probed device.
+    static constexpr uint8_t cDemoteFailures = 3; ///< Consecutive failures above the standard speed which demote a device.
+    static constexpr uint8_t cFailureBits = 2;    ///< Width of a failure counter, holds up to cDemoteFailures.
+    static_assert(cDemoteFailures <= (1u << cFailureBits), "The failure counter is too narrow");
+    static constexpr uint32_t cTimeout = 100;     ///< Timeout of a transfer [ms].
+    static constexpr uint32_t cIrqPriority = 5;   ///< Priority of the I2C interrupts, the reception of the last bytes is time critical.
+
+    /// @brief State of the asynchronous read.
+    enum class AsyncState : uint8_t {
+        IDLE,     ///< No read is pending.
+        BUSY,     ///< The read is in progress.
+        COMPLETE, ///< The read succeeded, not yet finished by isBusy().
+        FAILED,   ///< The read failed, not yet finished by isBusy().
+    };
+
+    /// @brief Performs a transfer at the speed of the device.
+    ///
+    /// A plain NACK only fails the transfer, the device is absent or busy. Other errors, e.g.
+    /// a bus error or a timeout, initialize the peripheral again. A repeatable transfer which
+    /// fails with such an error above the standard speed is retried at the standard speed, and
+    /// the device is demoted once cDemoteFailures retries in a row succeeded. Writes are not
+    /// retried, the device may have latched a part of the data.
+    ///
+    /// @param addr The 7-bit I2C address of the device.
+    /// @param repeatable Set if the transfer has no side effect on the device, i.e. for reads.
+    /// @param operation Function performing the transfer with the HAL.
+    /// @return True if the transfer succeeded, false otherwise.
+    template <typename F>
+    bool transfer(uint8_t addr, bool repeatable, F operation) const;
+
+    /// @brief Checks whether a device acknowledges its address at a clock speed.
+    /// @param addr The 7-bit I2C address of the device.
+    /// @param speed The clock speed [Hz].
+    /// @return True if the device is ready, false otherwise.
+    bool checkReady(uint8_t addr, uint32_t speed) const;
+
+    /// @brief Checks whether a failed transfer was only not acknowledged by the device.
+    /// @param result The result of the HAL function.
+    bool isNack(HAL_StatusTypeDef result) const;
+
+    /// @brief Configures the peripheral for the clock speed of a device.
+    /// @param addr The 7-bit I2C address of the device.
+    void selectSpeed(uint8_t addr) const;
+
+    /// @brief Initializes the peripheral, also recovering it after a failed transfer.
+    /// @param speed The clock speed [Hz].
+    void configure(uint32_t speed) const;
+
+    bool isDemoted(uint8_t addr) const;
+
+    void setDemoted(uint8_t addr, bool demoted) const;
+
+    /// @brief Records a transfer of a device which failed above the standard speed, but not at it.
+    /// @param addr The 7-bit I2C address of the device.
+    void recordFailure(uint8_t addr) const;
+
+    void setFailures(uint8_t addr, uint8_t failures) const;
+
+    /// @brief Starts the asynchronous read at the active speed.
+    /// @return True if the read was started, false otherwise.
+    bool startAsync() const;
+
+    /// @brief Finishes the asynchronous read once it ended, see isBusy().
+    /// @return True if the read is in progress, false otherwise.
+    bool pollAsync() const;
+
+    uint32_t mSpeed;                                               ///< Clock speed of the bus [Hz].
+    mutable uint32_t mActiveSpeed;                                 ///< Clock speed the peripheral is configured for [Hz].
+    mutable uint32_t mDemoted[cAddressCount / 32];                 ///< Bit mask of the devices demoted to the standard speed.
+    mutable uint32_t mFailures[cAddressCount * cFailureBits / 32]; ///< Failure counters of the devices, see recordFailure().
+    mutable volatile AsyncState mAsyncState;                       ///< State of the asynchronous read, set by the interrupts.
+    mutable bool mAsyncResult;                                     ///< Result of the last asynchronous read.
+    mutable bool mAsyncRetry;                                      ///< Set while the asynchronous read is retried at the standard speed.
+    mutable uint32_t mAsyncStart;                                  ///< Start time of the asynchronous read [ms].
+    uint8_t mAsyncAddr;                                            ///< I2C address of the asynchronous read.
+    uint8_t mAsyncReg;                                             ///< Register of the asynchronous read.
+    uint8_t mAsyncLen;                                             ///< Number of bytes of the asynchronous read.
+    uint8_t *mAsyncData;                                           ///< Buffer of the asynchronous read.
+
     /// @brief I2C handler structure used by the HAL library.
     /// 
     /// This structure holds the configuration and status information for the I2C peripheral.
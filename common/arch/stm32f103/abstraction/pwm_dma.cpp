@@ -2,6 +2,7 @@
 
 TIM_HandleTypeDef htim;
 DMA_HandleTypeDef hdma;
+volatile bool pwmDmaBusy = false;
 
 PwmDma::PwmDma(TIM_TypeDef *timer, uint32_t channel, DMA_Channel_TypeDef *dma_channel, uint32_t period) : mChannel(channel)
 {
@@ -40,7 +41,7 @@ PwmDma::PwmDma(TIM_TypeDef *timer, uint32_t channel, DMA_Channel_TypeDef *dma_ch
     hdma.Init.PeriphInc = DMA_PINC_DISABLE;
     hdma.Init.MemInc = DMA_MINC_ENABLE;
     hdma.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
-    hdma.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    hdma.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
     hdma.Init.Mode = DMA_NORMAL;
     hdma.Init.Priority = DMA_PRIORITY_HIGH;
     HAL_DMA_Init(&hdma);
@@ -62,12 +63,26 @@ PwmDma::PwmDma(TIM_TypeDef *timer, uint32_t channel, DMA_Channel_TypeDef *dma_ch
     }
 }
 
-bool PwmDma::start(uint16_t *data, size_t len)
+bool PwmDma::start(const uint8_t *data, size_t len)
 {
-    HAL_StatusTypeDef result = HAL_TIM_PWM_Start_DMA(&htim, mChannel, (uint32_t *)data, len);
+    if (pwmDmaBusy)
+    {
+        return false;
+    }
+    pwmDmaBusy = true;
+    HAL_StatusTypeDef result = HAL_TIM_PWM_Start_DMA(&htim, mChannel, reinterpret_cast<const uint32_t *>(data), len);
+    if (result != HAL_OK)
+    {
+        pwmDmaBusy = false;
+    }
     return result == HAL_OK;
 }
 
+bool PwmDma::isBusy()
+{
+    return pwmDmaBusy;
+}
+
 extern "C"
 {
     void DMA1_Channel7_IRQHandler(void)
@@ -80,6 +95,7 @@ extern "C"
         if (htim->Instance == TIM2)
         {
             HAL_TIM_PWM_Stop_DMA(htim, TIM_CHANNEL_2);
+            pwmDmaBusy = false;
         }
     }
 };
\ No newline at end of file
@@ -7,6 +7,8 @@
 /// @brief PwmDma class is responsible for handling PWM with DMA functionality.
 /// This class inherits from the IPwmDma interface and provides an implementation
 /// for initializing and starting PWM with DMA.
+/// The DMA reads bytes from memory and writes them as halfwords to the compare register,
+/// so the buffer takes one byte per PWM period.
 class PwmDma : public IPwmDma
 {
 public:
@@ -21,7 +23,11 @@ public:
     /// @param data Pointer to the data buffer to be transferred via DMA.
     /// @param len Length of the data buffer.
     /// @return Returns true if the PWM with DMA starts successfully, otherwise false.
-    virtual bool start(uint16_t *data, size_t len) override;
+    virtual bool start(const uint8_t *data, size_t len) override;
+
+    /// @brief Checks whether a transfer started by start() is still in progress.
+    /// @return Returns true if the DMA is still reading the data buffer, otherwise false.
+    virtual bool isBusy() override;
 
 private:
     uint32_t mChannel; ///< Timer channel used for PWM.
@@ -1,8 +1,19 @@
 #include "spi.h"
 SPI_HandleTypeDef spiHandle = {};
+DMA_HandleTypeDef spiDmaRx = {};
+DMA_HandleTypeDef spiDmaTx = {};
+
+enum class SpiDmaState {
+    IDLE,
+    BUSY,
+    ERROR
+};
+volatile SpiDmaState spiDmaState = SpiDmaState::IDLE;
 
 Spi::Spi(SPI_TypeDef *spi) {
     __SPI1_CLK_ENABLE();
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
     spiHandle.Instance = spi;
     spiHandle.Init.Mode = SPI_MODE_MASTER;
     spiHandle.Init.Direction = SPI_DIRECTION_2LINES;
@@ -10,47 +21,123 @@ Spi::Spi(SPI_TypeDef *spi) {
     spiHandle.Init.CLKPolarity = SPI_POLARITY_LOW;
     spiHandle.Init.CLKPhase = SPI_PHASE_1EDGE;
     spiHandle.Init.NSS = SPI_NSS_SOFT;
-    spiHandle.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_256;
+    spiHandle.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_4;
     spiHandle.Init.FirstBit = SPI_FIRSTBIT_MSB;
     spiHandle.Init.TIMode = SPI_TIMODE_DISABLE;
     spiHandle.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
     spiHandle.Init.CRCPolynomial = 7;
 
-    //HAL_SPI_Init(&spiHandle);
-    uint8_t data = 0;
-    transmit(&data, sizeof(data));
+    spiDmaRx.Instance = DMA1_Channel2;
+    spiDmaRx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    spiDmaRx.Init.PeriphInc = DMA_PINC_DISABLE;
+    spiDmaRx.Init.MemInc = DMA_MINC_ENABLE;
+    spiDmaRx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    spiDmaRx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    spiDmaRx.Init.Mode = DMA_NORMAL;
+    spiDmaRx.Init.Priority = DMA_PRIORITY_MEDIUM;
+    HAL_DMA_Init(&spiDmaRx);
+    __HAL_LINKDMA(&spiHandle, hdmarx, spiDmaRx);
+
+    spiDmaTx.Instance = DMA1_Channel3;
+    spiDmaTx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    spiDmaTx.Init.PeriphInc = DMA_PINC_DISABLE;
+    spiDmaTx.Init.MemInc = DMA_MINC_ENABLE;
+    spiDmaTx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    spiDmaTx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    spiDmaTx.Init.Mode = DMA_NORMAL;
+    spiDmaTx.Init.Priority = DMA_PRIORITY_MEDIUM;
+    HAL_DMA_Init(&spiDmaTx);
+    __HAL_LINKDMA(&spiHandle, hdmatx, spiDmaTx);
+
+    HAL_NVIC_SetPriority(DMA1_Channel2_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel2_IRQn);
+    HAL_NVIC_SetPriority(DMA1_Channel3_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel3_IRQn);
+    HAL_NVIC_SetPriority(SPI1_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(SPI1_IRQn);
+
+    HAL_SPI_Init(&spiHandle);
 }
 
 bool Spi::transmit(const uint8_t *data, size_t len) {
+    if (len < cDmaThreshold) {
+        return HAL_SPI_Transmit(&spiHandle, const_cast<uint8_t *>(data), len, cTimeout) == HAL_OK;
+    }
 
-    if (HAL_SPI_Transmit(&spiHandle, const_cast<uint8_t *>(data), len, 100) != HAL_OK) {
+    spiDmaState = SpiDmaState::BUSY;
+    if (HAL_SPI_Transmit_DMA(&spiHandle, const_cast<uint8_t *>(data), len) != HAL_OK) {
+        spiDmaState = SpiDmaState::IDLE;
         return false;
     }
-
-    return true;
+    return waitForDma();
 }
 
 bool Spi::receive(uint8_t *data, size_t len) {
+    if (len < cDmaThreshold) {
+        return HAL_SPI_Receive(&spiHandle, data, len, cTimeout) == HAL_OK;
+    }
 
-    if (HAL_SPI_Receive(&spiHandle, data, len, 100) != HAL_OK) {
+    spiDmaState = SpiDmaState::BUSY;
+    if (HAL_SPI_Receive_DMA(&spiHandle, data, len) != HAL_OK) {
+        spiDmaState = SpiDmaState::IDLE;
         return false;
     }
-
-    return true;
+    return waitForDma();
 }
 
-bool Spi::start() {
-    HAL_SPI_Init(&spiHandle);
-    return true;
+bool Spi::transmitReceive(const uint8_t *txData, uint8_t *rxData, size_t len) {
+    if (len < cDmaThreshold) {
+        return HAL_SPI_TransmitReceive(&spiHandle, const_cast<uint8_t *>(txData), rxData, len, cTimeout) == HAL_OK;
+    }
+
+    spiDmaState = SpiDmaState::BUSY;
+    if (HAL_SPI_TransmitReceive_DMA(&spiHandle, const_cast<uint8_t *>(txData), rxData, len) != HAL_OK) {
+        spiDmaState = SpiDmaState::IDLE;
+        return false;
+    }
+    return waitForDma();
 }
 
-bool Spi::stop() {
-HAL_SPI_DeInit(&spiHandle);
-return true;
+bool Spi::waitForDma() {
+    uint32_t start = HAL_GetTick();
+    while (spiDmaState == SpiDmaState::BUSY) {
+        if (HAL_GetTick() - start > cTimeout) {
+            HAL_SPI_Abort(&spiHandle);
+            spiDmaState = SpiDmaState::IDLE;
+            return false;
+        }
+    }
+    bool result = spiDmaState == SpiDmaState::IDLE;
+    spiDmaState = SpiDmaState::IDLE;
+    return result;
 }
 
 extern "C" {
 void SPI1_IRQHandler(void) {
     HAL_SPI_IRQHandler(&spiHandle);
 }
-}
\ No newline at end of file
+
+void DMA1_Channel2_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&spiDmaRx);
+}
+
+void DMA1_Channel3_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&spiDmaTx);
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) {
+    spiDmaState = SpiDmaState::IDLE;
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi) {
+    spiDmaState = SpiDmaState::IDLE;
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) {
+    spiDmaState = SpiDmaState::IDLE;
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+    spiDmaState = SpiDmaState::ERROR;
+}
+}
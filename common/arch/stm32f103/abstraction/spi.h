@@ -4,14 +4,27 @@
 #include "ispi.h"
 #include "stm32f1xx_hal.h"
 
+/// @brief SPI master implementation for the SPI1 peripheral of STM32F1.
+///
+/// The peripheral is initialized once in the constructor and runs at PCLK2/4.
+/// Transfers longer than cDmaThreshold bytes use DMA1 channels 2 (RX) and 3 (TX),
+/// shorter ones are done in polling mode where the DMA setup would cost more than it saves.
 class Spi : public ISpi {
     public:
+    /// @brief Constructs the SPI master and initializes the peripheral and its DMA channels.
+    /// @param spi Pointer to the SPI peripheral instance (only SPI1 is supported).
     Spi(SPI_TypeDef *spi);
     virtual bool transmit(const uint8_t *data, size_t len) override;
     virtual bool receive(uint8_t *data, size_t len) override;
-    virtual bool start() override;
-    virtual bool stop() override;
+    virtual bool transmitReceive(const uint8_t *txData, uint8_t *rxData, size_t len) override;
 
+    private:
+    /// @brief Waits until the running DMA transfer completes.
+    /// @return True if the transfer completed without error, false otherwise.
+    bool waitForDma();
+
+    static constexpr size_t cDmaThreshold = 16; ///< Minimal transfer length handled by DMA.
+    static constexpr uint32_t cTimeout = 100;   ///< Transfer timeout [ms].
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,36 @@
+#include "stack_monitor.h"
+#include "stm32f1xx_hal.h"
+
+// Symbols of the linker script
+extern "C" uint32_t _sdata;  ///< Start of RAM and of the static data.
+extern "C" uint32_t _end;    ///< End of the static data, the stack may grow down to it.
+extern "C" uint32_t _estack; ///< End of RAM, initial stack pointer.
+
+void StackMonitor::paint()
+{
+    uint32_t *limit = reinterpret_cast<uint32_t *>(__get_MSP()) - cMargin;
+    for (uint32_t *word = &_end; word < limit; word++)
+    {
+        *word = cPattern;
+    }
+}
+
+size_t StackMonitor::getStaticSize() const
+{
+    return reinterpret_cast<uintptr_t>(&_end) - reinterpret_cast<uintptr_t>(&_sdata);
+}
+
+size_t StackMonitor::getStackSize() const
+{
+    return reinterpret_cast<uintptr_t>(&_estack) - reinterpret_cast<uintptr_t>(&_end);
+}
+
+size_t StackMonitor::getPeak() const
+{
+    const volatile uint32_t *word = &_end;
+    while (word < &_estack && *word == cPattern)
+    {
+        word++;
+    }
+    return reinterpret_cast<uintptr_t>(&_estack) - reinterpret_cast<uintptr_t>(word);
+}
@@ -0,0 +1,35 @@
+#ifndef STACK_MONITOR_H
+#define STACK_MONITOR_H
+
+#include <cstdint>
+#include <cstddef>
+
+/// @brief Measures the stack high-water mark by painting the free stack with a pattern.
+///
+/// The stack grows down from the end of RAM towards the end of the static data (.data and .bss,
+/// the heap is not used). paint() fills this region below the current stack pointer with a
+/// pattern, getPeak() later finds the lowest word which was overwritten.
+class StackMonitor
+{
+public:
+    /// @brief Paints the free stack, called once at the start of main().
+    void paint();
+
+    /// @brief Returns the size of the static data.
+    /// @return The size of .data and .bss [B].
+    size_t getStaticSize() const;
+
+    /// @brief Returns the size of the RAM available to the stack.
+    /// @return The size between the end of the static data and the end of RAM [B].
+    size_t getStackSize() const;
+
+    /// @brief Returns the maximal stack usage since paint().
+    /// @return The used stack size [B].
+    size_t getPeak() const;
+
+private:
+    static constexpr uint32_t cPattern = 0xDEADBEEF; ///< Value of unused stack words.
+    static constexpr size_t cMargin = 16;            ///< Words below the stack pointer left unpainted for paint() itself.
+};
+
+#endif // STACK_MONITOR_H
@@ -0,0 +1,60 @@
+#include "timer.h"
+
+TIM_HandleTypeDef timerHandle = {};
+Delegate<void()> timerCallback;
+
+Timer::Timer(TIM_TypeDef *timer)
+{
+    __HAL_RCC_TIM3_CLK_ENABLE();
+    timerHandle.Instance = timer;
+
+    HAL_NVIC_SetPriority(TIM3_IRQn, 10, 0);
+    HAL_NVIC_EnableIRQ(TIM3_IRQn);
+}
+
+bool Timer::start(uint32_t frequency)
+{
+    // APB1 timers run at twice the bus clock when the bus is divided
+    uint32_t clock = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1)
+    {
+        clock *= 2;
+    }
+
+    timerHandle.Init.Prescaler = clock / cTickFrequency - 1;
+    timerHandle.Init.CounterMode = TIM_COUNTERMODE_UP;
+    timerHandle.Init.Period = cTickFrequency / frequency - 1;
+    timerHandle.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    timerHandle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    if (HAL_TIM_Base_Init(&timerHandle) != HAL_OK)
+    {
+        return false;
+    }
+    return HAL_TIM_Base_Start_IT(&timerHandle) == HAL_OK;
+}
+
+void Timer::stop()
+{
+    HAL_TIM_Base_Stop_IT(&timerHandle);
+}
+
+void Timer::registerCallback(Delegate<void()> callback)
+{
+    timerCallback = callback;
+}
+
+extern "C"
+{
+    void TIM3_IRQHandler(void)
+    {
+        HAL_TIM_IRQHandler(&timerHandle);
+    }
+
+    void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+    {
+        if (htim->Instance == TIM3 && timerCallback)
+        {
+            timerCallback();
+        }
+    }
+}
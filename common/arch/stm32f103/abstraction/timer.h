@@ -0,0 +1,25 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "itimer.h"
+#include "stm32f1xx_hal.h"
+
+/// @brief Periodic timer implementation for the TIM3 peripheral of STM32F1.
+///
+/// The callback is called from the update interrupt, which has a lower priority than
+/// the communication peripherals.
+class Timer : public ITimer
+{
+public:
+    /// @brief Constructs the timer, the timer is stopped until start() is called.
+    /// @param timer Pointer to the timer instance (only TIM3 is supported).
+    Timer(TIM_TypeDef *timer);
+    virtual bool start(uint32_t frequency) override;
+    virtual void stop() override;
+    virtual void registerCallback(Delegate<void()> callback) override;
+
+private:
+    static constexpr uint32_t cTickFrequency = 10000; ///< Counter frequency [Hz].
+};
+
+#endif
@@ -1,8 +1,8 @@
 #include "uart.h"
 #include <cassert>
 
-std::function<void()> txCallbacks[4] = {};
-std::function<void(uint8_t)> rxCallbacks[4] = {};
+Delegate<void()> txCallbacks[4] = {};
+Delegate<void(uint8_t)> rxCallbacks[4] = {};
 UART_HandleTypeDef *uartHandlers[4] = {};
 uint8_t mRxData;
 
@@ -58,13 +58,13 @@ bool Uart::isSending() const
     return ! (mHandle.Instance->SR & USART_SR_TXE);
 }
 
-void Uart::registerTxCallback(std::function<void()> callback)
+void Uart::registerTxCallback(Delegate<void()> callback)
 {
     size_t idx = Uart::uartInstanceToIndex(mHandle.Instance);
     txCallbacks[idx] = callback;
 }
 
-void Uart::registerRxCallback(std::function<void(uint8_t)> callback)
+void Uart::registerRxCallback(Delegate<void(uint8_t)> callback)
 {
     size_t idx = Uart::uartInstanceToIndex(mHandle.Instance);
     rxCallbacks[idx] = callback;
@@ -106,10 +106,11 @@ extern "C"
     void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
     {
         //size_t idx = Uart::uartInstanceToIndex(huart->Instance);
-        //if (rxCallbacks[idx])
-        //{
+        // An empty delegate has no function to call, a byte may arrive before the callback is registered
+        if (rxCallbacks[0])
+        {
             rxCallbacks[0](mRxData);
-        //}
+        }
         HAL_UART_Receive_IT(huart, &mRxData, sizeof(mRxData));
 
     }
@@ -10,8 +10,8 @@ class Uart: public IUart {
     ~Uart();
     virtual bool send(const uint8_t*, std::size_t);
     virtual bool isSending() const;
-    virtual void registerTxCallback(std::function<void()> callback);
-    virtual void registerRxCallback(std::function<void(uint8_t)> callback);
+    virtual void registerTxCallback(Delegate<void()> callback);
+    virtual void registerRxCallback(Delegate<void(uint8_t)> callback);
     static size_t uartInstanceToIndex(USART_TypeDef *instance);
     private:
     UART_HandleTypeDef mHandle;
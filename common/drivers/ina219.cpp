@@ -1,10 +1,19 @@
 #include "ina219.h"
 #include "logger.h"
 
-Ina219::Ina219(II2cMaster &i2c) : mI2c(i2c), mAddr(0)
+Ina219::Ina219(II2cMaster &i2c) : mI2c(&i2c), mAddr(0), mStep(Step::IDLE), mRaw{}, mVoltage(0), mCurrent(0)
 {
 }
 
+Ina219::Ina219() : mI2c(nullptr), mAddr(0), mStep(Step::IDLE), mRaw{}, mVoltage(0), mCurrent(0)
+{
+}
+
+void Ina219::setBus(II2cMaster &i2c)
+{
+    mI2c = &i2c;
+}
+
 void Ina219::setAddress(uint8_t address)
 {
     mAddr = address;
@@ -12,29 +21,85 @@ void Ina219::setAddress(uint8_t address)
 
 bool Ina219::connectionTest() const
 {
-    return mI2c.isDeviceReady(mAddr);
+    return mI2c->isDeviceReady(mAddr);
 }
 
 uint16_t Ina219::readBusVoltage()
 {
-    int16_t rawData = 0, tmp;
-    mI2c.readRegister(mAddr, cBusVoltageRegister, reinterpret_cast<uint8_t *>(&rawData), sizeof(rawData));
-    tmp = rawData;
-    rawData = (tmp >> 8) & 0xFF;
-    rawData |= ((tmp & 0xFF) << 8);
-    return (rawData >> 3) * 4;
+    uint8_t raw[2] = {};
+    mI2c->readRegister(mAddr, cBusVoltageRegister, raw, sizeof(raw));
+    return toBusVoltage(raw);
 }
 
 int16_t Ina219::readCurrent() {
-    int16_t shuntVoltage = 0;
-    int16_t tmp = 0;
-    float voltage = 0;
-    float current = 0;
-    mI2c.readRegister(mAddr, cShuntVoltageRegister, reinterpret_cast<uint8_t *>(&shuntVoltage), sizeof(shuntVoltage));
-    tmp = shuntVoltage;
-    shuntVoltage = (tmp >> 8) & 0xFF;
-    shuntVoltage |= (tmp & 0xFF) << 8;
-    voltage = shuntVoltage * 10.0; // 1mV per LSB
-    current = voltage / 50.0;       // 50mOhm shunt resistor
+    uint8_t raw[2] = {};
+    mI2c->readRegister(mAddr, cShuntVoltageRegister, raw, sizeof(raw));
+    return toCurrent(raw);
+}
+
+bool Ina219::startMeasurement()
+{
+    if (!mI2c->readRegisterAsync(mAddr, cBusVoltageRegister, mRaw, sizeof(mRaw)))
+    {
+        mStep = Step::FAILED;
+        return false;
+    }
+    mStep = Step::VOLTAGE;
+    return true;
+}
+
+bool Ina219::processMeasurement()
+{
+    if (mStep != Step::VOLTAGE && mStep != Step::CURRENT)
+    {
+        return false;
+    }
+    if (mI2c->isBusy())
+    {
+        return true;
+    }
+    if (!mI2c->getAsyncResult())
+    {
+        mStep = Step::FAILED;
+        return false;
+    }
+    if (mStep == Step::CURRENT)
+    {
+        mCurrent = toCurrent(mRaw);
+        mStep = Step::DONE;
+        return false;
+    }
+    mVoltage = toBusVoltage(mRaw);
+    if (!mI2c->readRegisterAsync(mAddr, cShuntVoltageRegister, mRaw, sizeof(mRaw)))
+    {
+        mStep = Step::FAILED;
+        return false;
+    }
+    mStep = Step::CURRENT;
+    return true;
+}
+
+bool Ina219::getMeasurement(uint16_t &voltage, int16_t &current) const
+{
+    if (mStep != Step::DONE)
+    {
+        return false;
+    }
+    voltage = mVoltage;
+    current = mCurrent;
+    return true;
+}
+
+uint16_t Ina219::toBusVoltage(const uint8_t raw[2])
+{
+    uint16_t rawData = (raw[0] << 8) | raw[1];
+    return (rawData >> 3) * 4;
+}
+
+int16_t Ina219::toCurrent(const uint8_t raw[2])
+{
+    int16_t shuntVoltage = static_cast<int16_t>((raw[0] << 8) | raw[1]);
+    float voltage = shuntVoltage * 10.0; // 1mV per LSB
+    float current = voltage / 50.0;      // 50mOhm shunt resistor
     return current;
 }
@@ -13,6 +13,13 @@ public:
     /// @param addr The I2C address of the INA219 device.
     Ina219(II2cMaster &i2c);
 
+    /// @brief Constructor for a device whose bus is set later with setBus().
+    Ina219();
+
+    /// @brief Sets the I2C bus of the device.
+    /// @param i2c Reference to an I2C master interface.
+    void setBus(II2cMaster &i2c);
+
     void setAddress(uint8_t address);
     
     /// @brief Tests the connection to the INA219 device.
@@ -27,12 +34,53 @@ public:
     /// @return The current in milliamps.
     int16_t readCurrent();
 
+    /// @brief Starts reading the bus voltage and the current without waiting for completion.
+    ///
+    /// The registers are read with II2cMaster::readRegisterAsync(), the bus must not have
+    /// another asynchronous read pending.
+    ///
+    /// @return True if the measurement was started, false otherwise.
+    bool startMeasurement();
+
+    /// @brief Advances the measurement started by startMeasurement(), never blocks.
+    /// @return True while the measurement is in progress, false once it ended.
+    bool processMeasurement();
+
+    /// @brief Gets the result of the last measurement.
+    /// @param voltage The bus voltage in millivolts.
+    /// @param current The current in milliamps.
+    /// @return True if the measurement succeeded, false otherwise.
+    bool getMeasurement(uint16_t &voltage, int16_t &current) const;
+
 private:
     static constexpr uint8_t cShuntVoltageRegister = 0x01; ///< Register address for the shunt voltage.
     static constexpr uint8_t cBusVoltageRegister = 0x02;   ///< Register address for the bus voltage.
 
-    II2cMaster &mI2c; ///< Reference to the I2C master interface.
-    uint8_t mAddr;    ///< I2C address of the INA219 device.
+    /// @brief Step of the asynchronous measurement.
+    enum class Step : uint8_t {
+        IDLE,    ///< No measurement was started.
+        VOLTAGE, ///< Reading the bus voltage.
+        CURRENT, ///< Reading the shunt voltage.
+        DONE,    ///< The measurement succeeded.
+        FAILED,  ///< A read failed.
+    };
+
+    /// @brief Converts the bus voltage register.
+    /// @param raw The register in the byte order of the bus.
+    /// @return The bus voltage in millivolts.
+    static uint16_t toBusVoltage(const uint8_t raw[2]);
+
+    /// @brief Converts the shunt voltage register to the current.
+    /// @param raw The register in the byte order of the bus.
+    /// @return The current in milliamps.
+    static int16_t toCurrent(const uint8_t raw[2]);
+
+    II2cMaster *mI2c;  ///< The I2C master interface, nullptr until set.
+    uint8_t mAddr;     ///< I2C address of the INA219 device.
+    Step mStep;        ///< Step of the asynchronous measurement.
+    uint8_t mRaw[2];   ///< Register read by the asynchronous measurement.
+    uint16_t mVoltage; ///< Bus voltage of the last measurement [mV].
+    int16_t mCurrent;  ///< Current of the last measurement [mA].
 };
 
 #endif
\ No newline at end of file
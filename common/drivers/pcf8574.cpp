@@ -1,27 +1,34 @@
 #include "pcf8574.h"
 #include "logger.h"
 
-Pcf8574::Pcf8574(II2cMaster &i2c) : mI2c(i2c), mAddr(0)
+Pcf8574::Pcf8574(II2cMaster &i2c) : mI2c(&i2c), mAddr(0)
 {
 }
 
+Pcf8574::Pcf8574() : mI2c(nullptr), mAddr(0)
+{
+}
+
+void Pcf8574::setBus(II2cMaster &i2c)
+{
+    mI2c = &i2c;
+}
+
 void Pcf8574::setAddress(uint8_t address) {
     mAddr = address;
 }
 
 bool Pcf8574::connectionTest() const
 {
-    return mI2c.isDeviceReady(mAddr);
+    return mI2c->isDeviceReady(mAddr);
 }
 
-uint8_t Pcf8574::read()
+bool Pcf8574::read(uint8_t &data)
 {
-    uint8_t data = 0;
-    mI2c.read(mAddr, &data, sizeof(data));
-    return data;
+    return mI2c->read(mAddr, &data, sizeof(data));
 }
 
 bool Pcf8574::write(uint8_t data)
 {
-    return mI2c.write(mAddr, &data, sizeof(data));
+    return mI2c->write(mAddr, &data, sizeof(data));
 }
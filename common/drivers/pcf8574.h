@@ -12,6 +12,13 @@ public:
     /// @param i2c Reference to an I2C master interface.
     Pcf8574(II2cMaster &i2c);
 
+    /// @brief Constructor for a device whose bus is set later with setBus().
+    Pcf8574();
+
+    /// @brief Sets the I2C bus of the device.
+    /// @param i2c Reference to an I2C master interface.
+    void setBus(II2cMaster &i2c);
+
     void setAddress(uint8_t address);
 
     /// @brief Tests the connection to the PCF8574 device.
@@ -19,8 +26,12 @@ public:
     bool connectionTest() const;
 
     /// @brief Reads data from the PCF8574 device.
-    /// @return The data read from the device.
-    uint8_t read();
+    ///
+    /// Reading the port also releases the /INT output of the device.
+    ///
+    /// @param data The data read from the device.
+    /// @return True if the read operation was successful, false otherwise.
+    bool read(uint8_t &data);
 
     /// @brief Writes data to the PCF8574 device.
     /// @param data The data to write to the device.
@@ -28,7 +39,7 @@ public:
     bool write(uint8_t data);
 
 private:
-    II2cMaster &mI2c; ///< Reference to the I2C master interface.
+    II2cMaster *mI2c; ///< The I2C master interface, nullptr until set.
     uint8_t mAddr;    ///< I2C address of the PCF8574 device.
 };
 
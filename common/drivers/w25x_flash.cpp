@@ -1,8 +1,11 @@
 #include "w25x_flash.h"
+#include "bsp.h"
+#include <algorithm>
 #include <cstring>
 
 W25xFlash::W25xFlash(ISpi &spi, IGpio &csPin)
-    : mCsPin(csPin), mSpi(spi) {
+    : mCsPin(csPin), mSpi(spi), mJob{}, mJobActive(false), mStepPending(false),
+      mStepStart(0), mStepTimeout(0), mStepTimedOut(false), mErrorCount(0) {
 }
 
 bool W25xFlash::writeEnable() {
@@ -28,29 +31,92 @@ bool W25xFlash::writeStatus(uint8_t status) {
     return transmit(data);
 }
 
-bool W25xFlash::waitForWrite() {
-    for (size_t i = 0; i < 10000; i++) {
+bool W25xFlash::waitForWrite(uint32_t timeout_ms) {
+    uint32_t start = getTime();
+    do {
         uint8_t status = readStatus();
-        if (!(status & 0x01)) {
+        if (!(status & cStatusBusy)) {
             return true;
         }
+    } while (getTime() - start <= timeout_ms);
+    return false;
+}
+
+bool W25xFlash::finishStep(uint32_t timeout_ms) {
+    if (waitForWrite(timeout_ms)) {
+        return true;
     }
+    // Treat it like a timed out asynchronous step, so no command is issued to the busy device
+    mStepPending = true;
+    mStepTimedOut = true;
     return false;
 }
 
 bool W25xFlash::read(uint32_t addr, uint8_t *data, size_t len) {
     uint8_t cmd[] = {
-        cReadData,
+        cFastRead,
         static_cast<uint8_t>(addr >> 16), // Address MSB
         static_cast<uint8_t>(addr >> 8),  // Address
-        static_cast<uint8_t>(addr)        // Address LSB
+        static_cast<uint8_t>(addr),       // Address LSB
+        0x00                              // Dummy byte
     };
     memset(data, 0xFF, len);
 
-    return transmitReceive(cmd, data, len);
+    // Reads are urgent, so do not wait for a pending erase or program. Without suspend
+    // support the read fails and the caller retries it once the operation finished.
+    bool suspended = false;
+    if (mStepPending && (readStatus() & cStatusBusy)) {
+        if (!suspend()) {
+            resume();
+            return false;
+        }
+        suspended = true;
+    }
+
+    bool result = transmitReceive(cmd, data, len);
+
+    if (suspended) {
+        result = resume() && result;
+    }
+    return result;
+}
+
+bool W25xFlash::suspend() {
+    uint8_t data[] = {cSuspend};
+    if (!transmit(data)) {
+        return false;
+    }
+    // The busy flag clears within tSUS if the device supports suspend
+    return waitForWrite(cSuspendTimeout);
+}
+
+bool W25xFlash::resume() {
+    uint8_t data[] = {cResume};
+    return transmit(data);
 }
 
 bool W25xFlash::write(uint32_t addr, const uint8_t *data, size_t len) {
+    // Page Program wraps around within a page, so split the data at page boundaries
+    while (len > 0) {
+        size_t chunk = std::min(len, static_cast<size_t>(cPageSize - addr % cPageSize));
+        if (!programPage(addr, data, chunk)) {
+            return false;
+        }
+        addr += chunk;
+        data += chunk;
+        len -= chunk;
+    }
+    return true;
+}
+
+bool W25xFlash::programPage(uint32_t addr, const uint8_t *data, size_t len) {
+    if (!flush() || !startProgram(addr, data, len)) {
+        return false;
+    }
+    return finishStep(cPageProgramTimeout);
+}
+
+bool W25xFlash::startProgram(uint32_t addr, const uint8_t *data, size_t len) {
     uint8_t cmd[] = {
         cPageProgram,
         static_cast<uint8_t>(addr >> 16), // Address MSB
@@ -62,19 +128,35 @@ bool W25xFlash::write(uint32_t addr, const uint8_t *data, size_t len) {
         return false;
     }
 
-    mSpi.start();
     mCsPin.reset();
-    mSpi.transmit(cmd, sizeof(cmd)); // Send Page Program command followed by address
-    mSpi.transmit(data, len);        // Transmit data to be programmed
+    bool result = mSpi.transmit(cmd, sizeof(cmd)) && // Send Page Program command followed by address
+                  mSpi.transmit(data, len);          // Transmit data to be programmed
     mCsPin.set();
-    mSpi.stop();
-
-    return waitForWrite();
+    return result;
 }
 
 bool W25xFlash::sectorErase(uint32_t addr) {
+    return eraseBlock(cSectorErase, addr, cSectorEraseTimeout);
+}
+
+bool W25xFlash::blockErase32K(uint32_t addr) {
+    return eraseBlock(cBlockErase32K, addr, cBlock32KEraseTimeout);
+}
+
+bool W25xFlash::blockErase64K(uint32_t addr) {
+    return eraseBlock(cBlockErase64K, addr, cBlock64KEraseTimeout);
+}
+
+bool W25xFlash::eraseBlock(uint8_t opcode, uint32_t addr, uint32_t timeout_ms) {
+    if (!flush() || !startErase(opcode, addr)) {
+        return false;
+    }
+    return finishStep(timeout_ms);
+}
+
+bool W25xFlash::startErase(uint8_t opcode, uint32_t addr) {
     uint8_t cmd[] = {
-        cSectorErase,
+        opcode,
         static_cast<uint8_t>(addr >> 16), // Address MSB
         static_cast<uint8_t>(addr >> 8),  // Address
         static_cast<uint8_t>(addr)        // Address LSB
@@ -83,22 +165,18 @@ bool W25xFlash::sectorErase(uint32_t addr) {
         return false;
     }
 
-    if (!transmit(cmd)) {
-        return false;
-    }
-
-    return waitForWrite();
+    return transmit(cmd);
 }
 
 bool W25xFlash::chipErase() {
     uint8_t data[] = {cChipErase};
-    if (!writeEnable()) {
+    if (!flush() || !writeEnable()) {
         return false;
     }
     if (!transmit(data)) {
         return false;
     }
-    return waitForWrite();
+    return finishStep(cChipEraseTimeout);
 }
 
 bool W25xFlash::powerDown() {
@@ -119,17 +197,155 @@ uint16_t W25xFlash::readID() {
 }
 
 uint32_t W25xFlash::readJEDECID() {
-    uint32_t id = 0;
+    uint8_t id[3] = {};
     uint8_t data[] = {cReadJEDECID};
-    transmitReceive(data, id);
-    return id;
+    transmitReceive(data, id, sizeof(id));
+    return (static_cast<uint32_t>(id[0]) << 16) | (static_cast<uint32_t>(id[1]) << 8) | id[2];
+}
+
+uint32_t W25xFlash::getCapacity() {
+    uint32_t id = readJEDECID();
+    uint8_t manufacturer = id >> 16;
+    uint8_t capacity = id & 0xFF;
+    // A missing device reads as all zeros or all ones, the capacity is 2^code bytes
+    if (manufacturer == 0x00 || manufacturer == 0xFF || capacity < cMinCapacityCode || capacity > cMaxCapacityCode) {
+        return 0;
+    }
+    return 1u << capacity;
 }
 
 bool W25xFlash::erase(uint32_t address, size_t no_sectors) {
-    sectorErase(address);
+    address -= address % cSectorSize;
+    uint32_t end = address + no_sectors * cSectorSize;
+
+    while (address < end) {
+        uint8_t opcode;
+        uint32_t timeout;
+        size_t size = selectEraseUnit(address, end - address, opcode, timeout);
+        if (!eraseBlock(opcode, address, timeout)) {
+            return false;
+        }
+        address += size;
+    }
     return true;
 }
 
+size_t W25xFlash::selectEraseUnit(uint32_t addr, size_t remaining, uint8_t &opcode, uint32_t &timeout_ms) {
+    if (addr % cBlock64KSize == 0 && remaining >= cBlock64KSize) {
+        opcode = cBlockErase64K;
+        timeout_ms = cBlock64KEraseTimeout;
+        return cBlock64KSize;
+    }
+    if (addr % cBlock32KSize == 0 && remaining >= cBlock32KSize) {
+        opcode = cBlockErase32K;
+        timeout_ms = cBlock32KEraseTimeout;
+        return cBlock32KSize;
+    }
+    opcode = cSectorErase;
+    timeout_ms = cSectorEraseTimeout;
+    return cSectorSize;
+}
+
+bool W25xFlash::eraseAsync(uint32_t address, size_t no_sectors) {
+    if (!isReady()) {
+        return false;
+    }
+    address -= address % cSectorSize;
+    Job job = {Job::Type::ERASE, address, static_cast<uint32_t>(address + no_sectors * cSectorSize), nullptr};
+    return mJobs.push(job);
+}
+
+bool W25xFlash::writeAsync(uint32_t address, const uint8_t *data, size_t size) {
+    if (!isReady()) {
+        return false;
+    }
+    Job job = {Job::Type::WRITE, address, static_cast<uint32_t>(address + size), data};
+    return mJobs.push(job);
+}
+
+size_t W25xFlash::getQueueSpace() {
+    return cMaxJobs - mJobs.size();
+}
+
+bool W25xFlash::isBusy() {
+    return (mStepPending && !mStepTimedOut) || mJobActive || !mJobs.empty();
+}
+
+void W25xFlash::process() {
+    while (isBusy()) {
+        if (mStepPending) {
+            if (readStatus() & cStatusBusy) {
+                if (getTime() - mStepStart > mStepTimeout) {
+                    // The queued operations depend on the failed one, so fail them as well.
+                    // The step stays pending, no command is issued until the device is idle.
+                    mStepTimedOut = true;
+                    mErrorCount += (mJobActive ? 1 : 0) + mJobs.size();
+                    mJobActive = false;
+                    while (!mJobs.empty()) {
+                        mJobs.pop();
+                    }
+                }
+                return;
+            }
+            mStepPending = false;
+        }
+
+        if (!mJobActive) {
+            mJob = mJobs.pop();
+            mJobActive = true;
+        }
+
+        if (mJob.address >= mJob.end) {
+            mJobActive = false;
+        } else if (!startStep()) {
+            mJobActive = false;
+            mErrorCount++;
+        }
+    }
+}
+
+bool W25xFlash::startStep() {
+    bool result;
+    if (mJob.type == Job::Type::ERASE) {
+        uint8_t opcode;
+        size_t size = selectEraseUnit(mJob.address, mJob.end - mJob.address, opcode, mStepTimeout);
+        result = startErase(opcode, mJob.address);
+        mJob.address += size;
+    } else {
+        size_t chunk = std::min(static_cast<size_t>(mJob.end - mJob.address),
+                                static_cast<size_t>(cPageSize - mJob.address % cPageSize));
+        mStepTimeout = cPageProgramTimeout;
+        result = startProgram(mJob.address, mJob.data, chunk);
+        mJob.address += chunk;
+        mJob.data += chunk;
+    }
+    mStepPending = result;
+    mStepStart = getTime();
+    return result;
+}
+
+bool W25xFlash::flush() {
+    while (isBusy()) {
+        process();
+    }
+    return isReady();
+}
+
+bool W25xFlash::isReady() {
+    if (mStepTimedOut) {
+        if (readStatus() & cStatusBusy) {
+            return false;
+        }
+        mStepTimedOut = false;
+        mStepPending = false;
+    }
+    return true;
+}
+
+uint32_t W25xFlash::getErrorCount() const {
+    return mErrorCount;
+}
+
 size_t W25xFlash::getSectorSize() {
-    return 4092;
+    return cSectorSize;
 }
@@ -4,28 +4,90 @@
 #include "ispi.h"
 #include "igpio.h"
 #include "iflash.h"
+#include "ring_buffer.h"
 #include <cstdint>
 
+/// @brief Driver for the Winbond W25X/W25Q serial NOR flash.
+///
+/// Reads use the Fast Read command, writes are split at 256-byte page boundaries
+/// and erases use the largest block size (64K, 32K or 4K) which fits the range.
+///
+/// eraseAsync() and writeAsync() only queue the operation. process() checks the busy
+/// flag once and, when the device is idle, issues the next erase block or page program,
+/// so the caller is never blocked for the duration of an erase. A read issued while
+/// an operation is in progress suspends it (Erase/Program Suspend) and resumes it
+/// afterwards. Devices without suspend support (W25X) fail the read instead, the caller
+/// retries it once isBusy() returns `false`. Blocking operations first complete all
+/// queued ones.
+///
+/// No command is issued while the device is busy. An operation which exceeds its
+/// timeout fails together with all queued ones, new operations are rejected until the
+/// device finishes it.
 class W25xFlash: public IFlash {
   public:
     W25xFlash(ISpi &spi, IGpio &csPin);
     bool read(uint32_t addr, uint8_t *data, size_t len) override;
     bool sectorErase(uint32_t addr);
+    bool blockErase32K(uint32_t addr);
+    bool blockErase64K(uint32_t addr);
     bool chipErase();
     bool powerDown();
     bool releasePowerDown();
     uint16_t readID();
+    /// @brief Reads the JEDEC ID.
+    /// @return The manufacturer ID, memory type and capacity as 0x00MMTTCC.
     uint32_t readJEDECID();
 
     bool erase(uint32_t address, size_t no_sectors) override;
     bool write(uint32_t address, const uint8_t* data, size_t size) override;
     size_t getSectorSize() override;
 
+    /// @brief Returns the size of the device from the capacity byte of its JEDEC ID.
+    /// @return The size in bytes, 0 if the device does not answer with a valid ID.
+    uint32_t getCapacity() override;
+
+    bool eraseAsync(uint32_t address, size_t no_sectors) override;
+    bool writeAsync(uint32_t address, const uint8_t* data, size_t size) override;
+    bool isBusy() override;
+    size_t getQueueSpace() override;
+    void process() override;
+
+    /// @brief Returns the number of asynchronous operations which failed or timed out.
+    /// @return The number of failed operations since startup.
+    uint32_t getErrorCount() const;
+
 private:
+    /// @brief Queued asynchronous operation, the range shrinks as the steps are issued.
+    struct Job {
+        enum class Type : uint8_t {
+            ERASE,
+            WRITE
+        };
+        Type type;
+        uint32_t address;    ///< Address of the next step.
+        uint32_t end;        ///< End address of the operation.
+        const uint8_t *data; ///< Data of the next step, used by WRITE only.
+    };
+
     bool writeEnable();
     bool writeDisable();
     uint8_t readStatus();
-    bool waitForWrite();
+    bool waitForWrite(uint32_t timeout_ms);
+    bool finishStep(uint32_t timeout_ms);
+    bool eraseBlock(uint8_t opcode, uint32_t addr, uint32_t timeout_ms);
+    bool programPage(uint32_t addr, const uint8_t *data, size_t len);
+    bool startErase(uint8_t opcode, uint32_t addr);
+    bool startProgram(uint32_t addr, const uint8_t *data, size_t len);
+    bool startStep();
+    /// @brief Completes the queued operations.
+    /// @return `true` if the device is idle, `false` if it still executes an operation which timed out.
+    bool flush();
+    /// @brief Clears an operation which timed out once the device finished it.
+    /// @return `true` if new commands can be issued, `false` if the device is still busy.
+    bool isReady();
+    bool suspend();
+    bool resume();
+    static size_t selectEraseUnit(uint32_t addr, size_t remaining, uint8_t &opcode, uint32_t &timeout_ms);
     bool writeStatus(uint8_t status);
     template<typename T>
     bool transmit(const T &data);
@@ -50,62 +112,58 @@ private:
     static constexpr uint8_t cReleasePowerDown = 0xAB;
     static constexpr uint8_t cReadID = 0x90;
     static constexpr uint8_t cReadJEDECID = 0x9F;
+    static constexpr uint8_t cSuspend = 0x75;
+    static constexpr uint8_t cResume = 0x7A;
+
+    static constexpr uint8_t cStatusBusy = 0x01;
+    static constexpr size_t cPageSize = 256;
+    static constexpr size_t cSectorSize = 4096;
+    static constexpr size_t cBlock32KSize = 32 * 1024;
+    static constexpr size_t cBlock64KSize = 64 * 1024;
+
+    // Maximum operation times from the datasheet [ms]
+    static constexpr uint32_t cPageProgramTimeout = 5;
+    static constexpr uint32_t cSectorEraseTimeout = 400;
+    static constexpr uint32_t cBlock32KEraseTimeout = 1600;
+    static constexpr uint32_t cBlock64KEraseTimeout = 2000;
+    static constexpr uint32_t cChipEraseTimeout = 100000;
+    static constexpr uint32_t cSuspendTimeout = 1;
+
+    static constexpr size_t cMaxJobs = 8;
+    static constexpr uint8_t cMinCapacityCode = 0x10; ///< Capacity code of a 64 KB device.
+    static constexpr uint8_t cMaxCapacityCode = 0x1F; ///< Largest capacity code whose size fits 32 bits.
 
     IGpio &mCsPin;
     ISpi &mSpi;
+    RingBuffer<Job, cMaxJobs + 1> mJobs; ///< Queued operations.
+    Job mJob;                            ///< Operation being carried out.
+    bool mJobActive;                     ///< Set when mJob holds an unfinished operation.
+    bool mStepPending;                   ///< Set when the device executes an issued step.
+    uint32_t mStepStart;                 ///< Time the pending step was issued.
+    uint32_t mStepTimeout;               ///< Maximum time of the pending step.
+    bool mStepTimedOut;                  ///< Set when the pending step exceeded its timeout.
+    uint32_t mErrorCount;                ///< Number of failed asynchronous operations.
 };
 
 template<typename T>
 bool W25xFlash::transmit(const T &data) {
- if(!mSpi.start()) {
-        return false;
-    }
     mCsPin.reset();
-    if(!mSpi.transmit(reinterpret_cast<const uint8_t*>(&data), sizeof(data))){
-        return false;
-    }
+    bool result = mSpi.transmit(reinterpret_cast<const uint8_t*>(&data), sizeof(data));
     mCsPin.set();
-    if(!mSpi.stop()){
-        return false;
-    }
-    return true;
+    return result;
 }
 
 template<typename T_tx, typename T_rx>
 bool W25xFlash::transmitReceive(const T_tx &tx_data, T_rx &rx_data) {
- if(!mSpi.start()) {
-        return false;
-    }
-    mCsPin.reset();
-    if(!mSpi.transmit(reinterpret_cast<const uint8_t*>(&tx_data), sizeof(tx_data))){
-        return false;
-    }
-    if(!mSpi.receive(reinterpret_cast<uint8_t*>(&rx_data), sizeof(rx_data))){
-        return false;
-    }
-    mCsPin.set();
-    if(!mSpi.stop()){
-        return false;
-    }
-    return true;
+    return transmitReceive(tx_data, reinterpret_cast<uint8_t*>(&rx_data), sizeof(rx_data));
 }
 
 template<typename T_tx>
 bool W25xFlash::transmitReceive(const T_tx &tx_data, uint8_t *rx_data, size_t len) {
- if(!mSpi.start()) {
-        return false;
-    }
     mCsPin.reset();
-    if(!mSpi.transmit(reinterpret_cast<const uint8_t*>(&tx_data), sizeof(tx_data))){
-        return false;
-    }
-    if(!mSpi.receive(rx_data, len)){
-        return false;
-    }
+    bool result = mSpi.transmit(reinterpret_cast<const uint8_t*>(&tx_data), sizeof(tx_data)) &&
+                  mSpi.receive(rx_data, len);
     mCsPin.set();
-    if(!mSpi.stop()){
-        return false;
-    }
-    return true;
+    return result;
 }
 #endif
\ No newline at end of file
@@ -2,12 +2,23 @@
 #define WS2812_H
 
 #include <cstddef>
+#include <cstring>
 #include "ipwm_dma.h"
 
 /// @brief A template class to control a WS2812 LED strip.
 ///
 /// This class provides methods to set the color of individual LEDs on a WS2812 LED strip
-/// and to send the updated color data to the strip using bit-banging through a GPIO interface.
+/// and to send the updated color data to the strip using a PWM timer fed by DMA.
+///
+/// Each bit is sent as one PWM period with a short or long pulse. The pulse widths of a whole
+/// color byte are taken from a lookup table and copied as a single 64-bit word, one byte per pulse.
+///
+/// The color bytes pass through a brightness and gamma lookup table, which is rebuilt only
+/// when the brightness changes, so no division is needed while encoding.
+///
+/// Only the LEDs whose color changed are encoded, and nothing is sent when no color changed.
+/// The data is encoded into one of two buffers while the DMA may still read the other one,
+/// a frame which cannot be sent yet because the previous one is in progress is sent by a later update().
 ///
 /// @tparam S Number of LEDs in the strip.
 template <size_t S = 1>
@@ -21,8 +32,9 @@ public:
 
     /// @brief Sends the current color data to the WS2812 LED strip.
     ///
-    /// This method iterates through the color array and sends each LED's color data
-    /// (in GRB format) to the LED strip, followed by a reset signal to latch the data.
+    /// This method encodes the color data of the changed LEDs (in GRB format) and sends
+    /// the whole strip, followed by a reset signal to latch the data. It returns immediately
+    /// if no color changed since the last frame or the previous frame is still being sent.
     void update();
 
     /// @brief Sets the color of a specific LED on the strip.
@@ -44,12 +56,48 @@ public:
     /// @param color A 24-bit color value in the format 0xRRGGBB.
     void setColor(uint32_t color);
 
+    /// @brief Sets the brightness of the whole strip.
+    ///
+    /// The brightness is applied before the gamma correction, so equal steps look equally large.
+    /// All LEDs are sent again with the next update() if the brightness changed.
+    ///
+    /// @param brightness The brightness level (0-255).
+    void setBrightness(uint8_t brightness);
+
 private:
     /// @brief Short pulse duration for the WS2812 protocol.
-    static constexpr uint16_t cShortPulse = 18;
+    static constexpr uint8_t cShortPulse = 18;
 
     /// @brief Long pulse duration for the WS2812 protocol.
-    static constexpr uint16_t cLongPulse = 59;
+    static constexpr uint8_t cLongPulse = 59;
+
+    /// @brief Number of zero periods sent after the data to latch it.
+    static constexpr size_t cResetPeriods = 50;
+
+    /// @brief Returns the pulse width for a single bit of a color byte.
+    ///
+    /// @param value The color byte.
+    /// @param bit The bit position (0-7).
+    /// @param shift The position of the pulse within the expanded word.
+    static constexpr uint64_t pulse(uint8_t value, unsigned bit, unsigned shift)
+    {
+        return static_cast<uint64_t>((value >> bit) & 1 ? cLongPulse : cShortPulse) << shift;
+    }
+
+    /// @brief Expands a color byte to 8 pulse widths, the most significant bit in the lowest byte.
+    ///
+    /// @param value The color byte.
+    static constexpr uint64_t expand(uint8_t value)
+    {
+        return pulse(value, 7, 0) | pulse(value, 6, 8) | pulse(value, 5, 16) | pulse(value, 4, 24) |
+               pulse(value, 3, 32) | pulse(value, 2, 40) | pulse(value, 1, 48) | pulse(value, 0, 56);
+    }
+
+    /// @brief Lookup table with the expanded pulse widths of every color byte.
+    static const uint64_t cExpansion[256];
+
+    /// @brief Gamma correction table (gamma 2.2), non-zero inputs stay visible.
+    static const uint8_t cGamma[256];
 
     /// @brief Structure to represent the color of an LED.
     struct Color
@@ -59,57 +107,134 @@ private:
         uint8_t blue;  ///< Blue component (0-255).
     };
 
+    static_assert(S <= 32, "Dirty masks hold up to 32 LEDs");
+
     Color mColors[S]; ///< Array to store the colors for all LEDs in the strip.
+    uint8_t mLevels[256]; ///< Color byte after brightness and gamma correction for every color byte.
+    uint8_t mBrightness;  ///< Brightness the levels are computed for.
     IPwmDma &mPwm;    ///< Reference to the PwmDma interface used to control the WS2812 strip.
-    uint16_t mPwmData[24 * S + 50]; ///< Array to store the PWM data to be sent to the strip.
+    uint8_t mPwmData[2][24 * S + cResetPeriods]; ///< Double buffer for the PWM data to be sent to the strip.
+    uint32_t mDirty[2]; ///< LEDs whose data in the corresponding buffer is out of date.
+    size_t mFront;      ///< Buffer last passed to the DMA.
+    bool mChanged;      ///< Set when a color changed since the last encoding.
+    bool mReady;        ///< Set when the back buffer holds a frame which has not been sent yet.
+
+    /// @brief Marks the LED as changed in both buffers.
+    ///
+    /// @param led_id The index of the LED (0-based).
+    void markDirty(size_t led_id);
 
     /// @brief Helper function to set the PWM data for a single LED color channel.
     ///
     /// @param color_channel The color channel value (0-255).
+    /// @param buffer The PWM data buffer.
     /// @param start_index The starting index in the PWM data array.
-    void setPwmData(uint8_t color_channel, size_t start_index);
+    void setPwmData(uint8_t color_channel, uint8_t *buffer, size_t start_index);
+};
+
+#define WS2812_EXPAND_4(n) expand(n), expand(n + 1), expand(n + 2), expand(n + 3)
+#define WS2812_EXPAND_16(n) WS2812_EXPAND_4(n), WS2812_EXPAND_4(n + 4), WS2812_EXPAND_4(n + 8), WS2812_EXPAND_4(n + 12)
+#define WS2812_EXPAND_64(n) WS2812_EXPAND_16(n), WS2812_EXPAND_16(n + 16), WS2812_EXPAND_16(n + 32), WS2812_EXPAND_16(n + 48)
+
+template <size_t S>
+const uint64_t Ws2812<S>::cExpansion[256] = {
+    WS2812_EXPAND_64(0), WS2812_EXPAND_64(64), WS2812_EXPAND_64(128), WS2812_EXPAND_64(192)
+};
+
+#undef WS2812_EXPAND_64
+#undef WS2812_EXPAND_16
+#undef WS2812_EXPAND_4
+
+template <size_t S>
+const uint8_t Ws2812<S>::cGamma[256] = {
+      0,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+      6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+     12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+     20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+     30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+     42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+     56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+     73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+     91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255
 };
 
 template <size_t S>
-Ws2812<S>::Ws2812(IPwmDma &pwm) : mColors{}, mPwm(pwm), mPwmData{}
+Ws2812<S>::Ws2812(IPwmDma &pwm) : mColors{}, mBrightness(0xFF), mPwm(pwm), mPwmData{}, mFront(0), mChanged(true), mReady(false)
 {
+    memcpy(mLevels, cGamma, sizeof(mLevels));
+
+    // The buffers do not hold any LED data yet
+    mDirty[0] = mDirty[1] = (S == 32) ? 0xFFFFFFFFu : (1u << S) - 1;
 }
 
 template <size_t S>
 void Ws2812<S>::update()
 {
-    for (size_t i = 0; i < S; i++)
+    size_t back = mFront ^ 1;
+
+    if (mChanged)
+    {
+        uint8_t *buffer = mPwmData[back];
+        for (size_t i = 0; i < S; i++)
+        {
+            if (mDirty[back] & (1u << i))
+            {
+                setPwmData(mLevels[mColors[i].green], buffer, i * 24);
+                setPwmData(mLevels[mColors[i].red], buffer, i * 24 + 8);
+                setPwmData(mLevels[mColors[i].blue], buffer, i * 24 + 16);
+            }
+        }
+        mDirty[back] = 0;
+        mChanged = false;
+        mReady = true;
+    }
+
+    if (mReady && !mPwm.isBusy() && mPwm.start(mPwmData[back], sizeof(mPwmData[back])))
     {
-        setPwmData(mColors[i].green, i * 24);
-        setPwmData(mColors[i].blue, i * 24 + 8);
-        setPwmData(mColors[i].red, i * 24 + 16);
+        mFront = back;
+        mReady = false;
     }
-    mPwm.start(mPwmData, sizeof(mPwmData) / sizeof(mPwmData[0]));
 }
 
 template <size_t S>
-void Ws2812<S>::setPwmData(uint8_t color_channel, size_t start_index)
+void Ws2812<S>::setPwmData(uint8_t color_channel, uint8_t *buffer, size_t start_index)
 {
-    for (size_t bit = 0; bit < 8; bit++)
-    {
-        mPwmData[start_index + bit] = (color_channel & (1 << (7 - bit))) ? cLongPulse : cShortPulse;
-    }
+    memcpy(&buffer[start_index], &cExpansion[color_channel], sizeof(cExpansion[0]));
+}
+
+template <size_t S>
+void Ws2812<S>::markDirty(size_t led_id)
+{
+    mDirty[0] |= 1u << led_id;
+    mDirty[1] |= 1u << led_id;
+    mChanged = true;
 }
 
 template <size_t S>
 void Ws2812<S>::setColor(size_t led_id, uint8_t red, uint8_t green, uint8_t blue)
 {
-    mColors[led_id].red = red;
-    mColors[led_id].green = green;
-    mColors[led_id].blue = blue;
+    Color &led = mColors[led_id];
+    if (led.red == red && led.green == green && led.blue == blue)
+    {
+        return;
+    }
+    led.red = red;
+    led.green = green;
+    led.blue = blue;
+    markDirty(led_id);
 }
 
 template <size_t S>
 void Ws2812<S>::setColor(size_t led_id, uint32_t color)
 {
-    mColors[led_id].red = color & 0xFF;
-    mColors[led_id].green = (color >> 8) & 0xFF;
-    mColors[led_id].blue = (color >> 16) & 0xFF;
+    setColor(led_id, (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF);
 }
 
 template <size_t S>
@@ -121,4 +246,23 @@ void Ws2812<S>::setColor(uint32_t color)
     }
 }
 
+template <size_t S>
+void Ws2812<S>::setBrightness(uint8_t brightness)
+{
+    if (brightness == mBrightness)
+    {
+        return;
+    }
+    mBrightness = brightness;
+
+    for (size_t i = 0; i < 256; i++)
+    {
+        mLevels[i] = cGamma[(i * brightness + 127) / 255];
+    }
+    for (size_t i = 0; i < S; i++)
+    {
+        markDirty(i);
+    }
+}
+
 #endif
@@ -23,13 +23,55 @@ class IFlash {
     /// @param address The starting address in flash memory from where data will be read.
     /// @param data Pointer to the buffer where the read data will be stored.
     /// @param size The size of the data to be read in bytes.
-    /// @return `true` if the data was successfully read, `false` otherwise.
+    /// @return `true` if the data was successfully read, `false` otherwise. A device which cannot
+    ///         interrupt a pending asynchronous operation also fails, retry once isBusy() returns `false`.
     virtual bool read(uint32_t address, uint8_t* data, size_t size) = 0;
 
     /// @brief Returns the size of a flash memory sector.
     /// @return The size of a flash memory sector in bytes.
     virtual size_t getSectorSize() = 0;
 
+    /// @brief Returns the size of the flash memory.
+    /// @return The size of the flash memory in bytes, 0 if it is unknown.
+    virtual uint32_t getCapacity() { return 0; }
+
+    /// @brief Starts erasing the specified number of sectors without waiting for completion.
+    ///
+    /// Queued operations are carried out in order by process(). The default implementation
+    /// erases synchronously.
+    ///
+    /// @param address The starting address of the flash memory to erase.
+    /// @param no_sectors The number of sectors to erase.
+    /// @return `true` if the operation was accepted, `false` otherwise.
+    virtual bool eraseAsync(uint32_t address, size_t no_sectors) { return erase(address, no_sectors); }
+
+    /// @brief Starts writing data without waiting for completion.
+    ///
+    /// The data is not copied, the buffer must stay valid until isBusy() returns `false`.
+    /// The default implementation writes synchronously.
+    ///
+    /// @param address The starting address in flash memory where data will be written.
+    /// @param data Pointer to the data to be written to flash memory.
+    /// @param size The size of the data to be written in bytes.
+    /// @return `true` if the operation was accepted, `false` otherwise.
+    virtual bool writeAsync(uint32_t address, const uint8_t* data, size_t size) { return write(address, data, size); }
+
+    /// @brief Checks whether asynchronous operations are still pending.
+    /// @return `true` if an operation is queued or in progress, `false` otherwise.
+    virtual bool isBusy() { return false; }
+
+    /// @brief Returns the number of asynchronous operations which can still be queued.
+    ///
+    /// A caller queuing several dependent operations checks this first, so it never has
+    /// to leave a sequence half queued. The default implementation has no queue.
+    ///
+    /// @return The number of free queue entries.
+    virtual size_t getQueueSpace() { return SIZE_MAX; }
+
+    /// @brief Advances pending asynchronous operations, never blocks.
+    ///
+    /// Has to be called periodically by the main loop while isBusy() returns `true`.
+    virtual void process() {}
 };
 
 #endif
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef IGPIO_H
 #define IGPIO_H
 
+#include "delegate.h"
+
 /// @class IGpio
 /// @brief Interface class for General Purpose Input/Output (GPIO) operations.
 /// 
@@ -44,7 +46,14 @@ public:
     /// @return The current state of the GPIO pin. True for high, false for low.
     virtual bool get() const = 0;
 
-
+    /// @brief Registers a callback function to be called on every edge of the pin.
+    ///
+    /// The callback is called from the interrupt. Pins without edge interrupts keep this
+    /// default implementation.
+    ///
+    /// @param callback The callback function.
+    /// @return True if the edge interrupt is enabled, false if the pin does not support it.
+    virtual bool registerEdgeCallback(Delegate<void()> callback) { return false; }
 };
 
 #endif // IGPIO_H
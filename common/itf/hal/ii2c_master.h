@@ -52,6 +52,32 @@ public:
     /// @return True if the data was successfully received, false otherwise.
     virtual bool readRegister(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len) = 0;
 
+    /// @brief Starts reading data from a specific register of an I2C device without waiting for completion.
+    ///
+    /// Only one read can be pending. It is finished by polling isBusy() until it returns `false`,
+    /// getAsyncResult() then reports whether it succeeded. Blocking transfers wait for a pending
+    /// read. The default implementation reads synchronously and reports a failed read as not started.
+    ///
+    /// @param addr The 7-bit I2C address of the device.
+    /// @param reg The register address to read from.
+    /// @param data Pointer to the buffer for the received data, it must stay valid until isBusy() returns `false`.
+    /// @param len The number of bytes to read.
+    /// @return True if the read was started, false otherwise.
+    virtual bool readRegisterAsync(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len) { return readRegister(addr, reg, data, len); }
+
+    /// @brief Checks whether an asynchronous read is still pending, never blocks.
+    ///
+    /// Also finishes a read which ended, e.g. by retrying it after an error, so it has to be
+    /// polled until it returns `false`.
+    ///
+    /// @return True if a read is in progress, false otherwise.
+    virtual bool isBusy() { return false; }
+
+    /// @brief Returns the result of the last asynchronous read, valid once isBusy() returned `false`.
+    ///
+    /// @return True if the data was successfully received, false otherwise.
+    virtual bool getAsyncResult() const { return true; }
+
     /// @brief Checks if an I2C device is ready for communication.
     ///
     /// This method checks whether the device with the specified address is responding.
@@ -59,6 +85,26 @@ public:
     /// @param addr The 7-bit I2C address of the device.
     /// @return True if the device is ready, false otherwise.
     virtual bool isDeviceReady(uint8_t addr) const = 0;
+
+    /// @brief Sets the clock speed of the bus.
+    ///
+    /// Devices which do not communicate at this speed are demoted to the standard speed
+    /// (100 kHz) individually, see probe().
+    ///
+    /// @param speed The clock speed [Hz].
+    virtual void setSpeed(uint32_t speed) = 0;
+
+    /// @brief Checks a device at the bus speed and demotes it if it only responds at the standard speed.
+    ///
+    /// @param addr The 7-bit I2C address of the device.
+    /// @return The clock speed used for the device [Hz], 0 if it does not respond.
+    virtual uint32_t probe(uint8_t addr) = 0;
+
+    /// @brief Returns the clock speed used for a device.
+    ///
+    /// @param addr The 7-bit I2C address of the device, 0 for the bus speed.
+    /// @return The clock speed [Hz].
+    virtual uint32_t getSpeed(uint8_t addr) const = 0;
 };
 
 #endif // II2CMASTER_H
@@ -6,13 +6,18 @@
 
 /// @brief Interface for PWM with DMA functionality.
 /// This interface provides a contract for starting a PWM signal using DMA transfer.
+/// Each byte of the data buffer sets the compare value of a single PWM period.
 class IPwmDma {
 public:
     /// @brief Starts the PWM signal with DMA using the provided data buffer.
-    /// @param data Pointer to the data buffer to be transferred via DMA.
+    /// @param data Pointer to the data buffer to be transferred via DMA, one compare value per byte.
     /// @param len Length of the data buffer.
     /// @return Returns true if the PWM with DMA starts successfully, otherwise false.
-    virtual bool start(uint16_t *data, size_t len) = 0;
+    virtual bool start(const uint8_t *data, size_t len) = 0;
+
+    /// @brief Checks whether a transfer started by start() is still in progress.
+    /// @return Returns true if the DMA is still reading the data buffer, otherwise false.
+    virtual bool isBusy() = 0;
 };
 
 #endif
\ No newline at end of file
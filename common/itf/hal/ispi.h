@@ -4,12 +4,34 @@
 #include <cstdint>
 #include <cstdlib>
 
+/// @class ISpi
+/// @brief Interface class for SPI master operations.
+///
+/// The peripheral is configured once when the implementation is created, the chip
+/// select line is driven by the device driver.
 class ISpi {
     public:
+    /// @brief Sends data via SPI, the received bytes are discarded.
+    /// @param data Pointer to the data to be sent.
+    /// @param len The number of bytes to send.
+    /// @return True if the data was sent successfully, false otherwise.
     virtual bool transmit(const uint8_t *data, size_t len) = 0;
+
+    /// @brief Receives data via SPI.
+    ///
+    /// The content of the buffer is clocked out while receiving.
+    ///
+    /// @param data Pointer to the buffer where the received data will be stored.
+    /// @param len The number of bytes to receive.
+    /// @return True if the data was received successfully, false otherwise.
     virtual bool receive(uint8_t *data, size_t len) = 0;
-    virtual bool start() = 0;
-    virtual bool stop() = 0;
+
+    /// @brief Sends and receives data simultaneously via SPI.
+    /// @param txData Pointer to the data to be sent.
+    /// @param rxData Pointer to the buffer where the received data will be stored.
+    /// @param len The number of bytes to transfer.
+    /// @return True if the transfer was successful, false otherwise.
+    virtual bool transmitReceive(const uint8_t *txData, uint8_t *rxData, size_t len) = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,28 @@
+#ifndef ITIMER_H
+#define ITIMER_H
+
+#include <cstdint>
+#include "delegate.h"
+
+/// @class ITimer
+/// @brief Interface class for a periodic hardware timer.
+///
+/// The registered callback is called from the timer interrupt, so it has to be short
+/// and must not block.
+class ITimer
+{
+public:
+    /// @brief Starts calling the callback periodically.
+    /// @param frequency The callback frequency [Hz].
+    /// @return True if the timer was started, false otherwise.
+    virtual bool start(uint32_t frequency) = 0;
+
+    /// @brief Stops the timer.
+    virtual void stop() = 0;
+
+    /// @brief Registers a callback function to be called on every timer period.
+    /// @param callback The callback function, called from the interrupt.
+    virtual void registerCallback(Delegate<void()> callback) = 0;
+};
+
+#endif // ITIMER_H
@@ -2,7 +2,7 @@
 #define IUART_H
 
 #include <cstdint>
-#include <functional>
+#include "delegate.h"
 
 /// @class IUart
 /// @brief Interface class for UART (Universal Asynchronous Receiver/Transmitter) operations.
@@ -37,8 +37,8 @@ public:
     /// register a callback function that will be called when the data transmission
     /// is complete.
     ///
-    /// @param callback A std::function object representing the callback function.
-    virtual void registerTxCallback(std::function<void()> callback) = 0;
+    /// @param callback The callback function, called from the interrupt.
+    virtual void registerTxCallback(Delegate<void()> callback) = 0;
 
     /// @brief Registers a callback function to be called when data is received via UART.
     ///
@@ -46,8 +46,8 @@ public:
     /// register a callback function that will be called when data is received
     /// via UART.
     ///
-    /// @param callback A std::function object representing the callback function.
-    virtual void registerRxCallback(std::function<void(uint8_t)> callback) = 0;
+    /// @param callback The callback function, called from the interrupt with the received byte.
+    virtual void registerRxCallback(Delegate<void(uint8_t)> callback) = 0;
 };
 
 #endif // IUART_H
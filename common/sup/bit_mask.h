@@ -1,7 +1,13 @@
+#ifndef BIT_MASK_H
+#define BIT_MASK_H
+
+#include <cstdint>
+
 /// @brief A template class for managing a bitmask of flags.
 ///
 /// This class provides methods to set, clear, and check individual bits in a bitmask
-/// using a generic enumeration or integer type.
+/// using a generic enumeration or integer type. Each value selects the bit at its position,
+/// so enumerations may use consecutive values starting from 0.
 ///
 /// @tparam T The type used to specify individual bits (typically an enumeration).
 template <typename T>
@@ -16,7 +22,7 @@ public:
     ///
     /// @param data The bits to set (typically an enumeration value).
     void set(const T& data) {
-        mData |= static_cast<uint32_t>(data);
+        mData |= toMask(data);
     }
 
     /// @brief Clear the specified bits in the bitmask.
@@ -25,7 +31,7 @@ public:
     ///
     /// @param data The bits to clear (typically an enumeration value).
     void clr(const T& data) {
-        mData &= ~static_cast<uint32_t>(data);
+        mData &= ~toMask(data);
     }
 
     /// @brief Check if the specified bits are set in the bitmask.
@@ -35,9 +41,26 @@ public:
     /// @param data The bits to check (typically an enumeration value).
     /// @return true if the specified bits are set, false otherwise.
     bool isSet(const T& data) const {
-        return mData & static_cast<uint32_t>(data);
+        return mData & toMask(data);
+    }
+
+    /// @brief Get the raw bitmask.
+    ///
+    /// @return The bitmask with the bit at the position of each set value.
+    uint32_t get() const {
+        return mData;
     }
 
 private:
+    /// @brief Convert a value to the mask of its bit.
+    ///
+    /// @param data The value to convert.
+    /// @return The mask with the bit at the position of the value set.
+    static uint32_t toMask(const T& data) {
+        return 1u << static_cast<uint32_t>(data);
+    }
+
     uint32_t mData; ///< The bitmask data.
-};
\ No newline at end of file
+};
+
+#endif // BIT_MASK_H
\ No newline at end of file
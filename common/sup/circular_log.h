@@ -0,0 +1,275 @@
+#ifndef CIRCULAR_LOG_H
+#define CIRCULAR_LOG_H
+
+#include "iflash.h"
+#include "crc16.h"
+#include "ring_buffer.h"
+#include <cstring>
+
+/// @brief A template class for a circular log of fixed-size records stored in flash memory.
+///
+/// Every record gets a sequence number which also determines its location: records fill
+/// the sectors of the region one after another and wrap around at its end. The sector is
+/// erased when its first record is written, so the log always keeps the records of the
+/// other `noSectors - 1` sectors and no separate index has to be maintained. At boot only
+/// the first record of each sector and then the newest sector are read to find the end
+/// of the log.
+///
+/// Appended records are queued in RAM and written by process() when the flash has no
+/// pending operations, consecutive records of a sector with a single write. read() serves
+/// queued records from RAM, so every record up to getNext() can be read.
+///
+/// @tparam T The type of the record, copied to flash as is.
+/// @tparam N The number of records which can wait in RAM for being written.
+template <typename T, size_t N = 8>
+class CircularLog
+{
+public:
+    /// @brief Constructor that initializes the CircularLog class and finds the end of the log.
+    /// @param flash Reference to the Flash object used for reading and writing to flash memory.
+    /// @param address The address in flash memory where the log starts, aligned to a sector.
+    /// @param noSectors The number of sectors occupied by the log, at least 2.
+    CircularLog(IFlash &flash, uint32_t address, size_t noSectors);
+
+    /// @brief Finds the end of the log stored in flash memory.
+    /// @return `true` if the log holds any record, `false` if it is empty.
+    bool init();
+
+    /// @brief Appends a record to the log.
+    /// @param record The record to append.
+    /// @return `true` if the record was queued, `false` if the queue is full and the record was dropped.
+    bool append(const T &record);
+
+    /// @brief Writes queued records, never blocks.
+    ///
+    /// Has to be called periodically together with IFlash::process().
+    void process();
+
+    /// @brief Reads a record from the log.
+    /// @param seq The sequence number of the record.
+    /// @param record The read record.
+    /// @return `true` if the record was read and is valid, `false` if it is not available or corrupted.
+    bool read(uint32_t seq, T &record);
+
+    /// @brief Returns the sequence number of the oldest record kept in the log.
+    /// @return The sequence number of the oldest record.
+    uint32_t getFirst() const;
+
+    /// @brief Returns the sequence number which will be assigned to the next appended record.
+    /// @return The sequence number of the next record.
+    uint32_t getNext() const;
+
+    /// @brief Returns the number of records dropped because the queue was full.
+    /// @return The number of dropped records since startup.
+    uint32_t getDropped() const;
+
+private:
+    /// @brief A record as stored in flash memory.
+    struct Entry {
+        uint32_t seq; ///< Sequence number of the record.
+        T data;       ///< The record.
+        uint16_t crc; ///< CRC of the sequence number and the record.
+    };
+
+    /// @brief Calculates the CRC of an entry.
+    /// @param entry The entry.
+    /// @return The calculated CRC.
+    static uint16_t calculateCrc(const Entry &entry);
+
+    /// @brief Checks whether an entry has not been programmed.
+    /// @param entry The entry.
+    /// @return `true` if all bytes of the entry are erased, `false` otherwise.
+    static bool isErased(const Entry &entry);
+
+    /// @brief Returns the number of entries stored in a single sector.
+    /// @return The number of entries in a sector.
+    size_t getEntriesPerSector() const;
+
+    /// @brief Returns the flash address of an entry.
+    /// @param seq The sequence number of the entry.
+    /// @return The address of the entry.
+    uint32_t getEntryAddress(uint32_t seq) const;
+
+    /// @brief Reads the entry with the given sequence number and verifies it.
+    /// @param seq The sequence number of the entry.
+    /// @param entry The read entry.
+    /// @return `true` if the entry is valid and holds the given sequence number, `false` otherwise.
+    bool readEntry(uint32_t seq, Entry &entry);
+
+    IFlash &mFlash;                 ///< Reference to the Flash object for flash memory operations.
+    uint32_t mAddress;              ///< The address in flash memory where the log starts.
+    size_t mNoSectors;              ///< The number of sectors occupied by the log.
+    uint32_t mNext;                 ///< Sequence number of the next record.
+    size_t mInFlight;               ///< Number of queued entries being written.
+    uint32_t mDropped;              ///< Number of records dropped because the queue was full.
+    RingBuffer<Entry, N + 1> mQueue; ///< Entries waiting for being written.
+};
+
+template <typename T, size_t N>
+CircularLog<T, N>::CircularLog(IFlash &flash, uint32_t address, size_t noSectors): mFlash(flash), mAddress(address), mNoSectors(noSectors), mNext(0), mInFlight(0), mDropped(0) {
+    init();
+}
+
+template <typename T, size_t N>
+bool CircularLog<T, N>::init() {
+    size_t perSector = getEntriesPerSector();
+    bool found = false;
+    uint32_t newest = 0;
+    Entry entry;
+
+    // The sector holding the newest first entry is the one being filled
+    for (size_t sector = 0; sector < mNoSectors; sector++) {
+        uint32_t address = mAddress + sector * mFlash.getSectorSize();
+        if (!mFlash.read(address, reinterpret_cast<uint8_t*>(&entry), sizeof(Entry)) ||
+            calculateCrc(entry) != entry.crc || getEntryAddress(entry.seq) != address) {
+            continue;
+        }
+        if (!found || static_cast<int32_t>(entry.seq - newest) > 0) {
+            newest = entry.seq;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        mNext = 0;
+        return false;
+    }
+
+    // Continue after the last programmed entry, even a corrupted one must not be overwritten
+    mNext = newest + 1;
+    for (size_t i = perSector - 1; i > 0; i--) {
+        if (mFlash.read(getEntryAddress(newest + i), reinterpret_cast<uint8_t*>(&entry), sizeof(Entry)) &&
+            !isErased(entry)) {
+            mNext = newest + i + 1;
+            break;
+        }
+    }
+    return true;
+}
+
+template <typename T, size_t N>
+bool CircularLog<T, N>::append(const T &record) {
+    Entry entry;
+    memset(&entry, 0, sizeof(Entry));
+    entry.seq = mNext;
+    entry.data = record;
+    entry.crc = calculateCrc(entry);
+
+    if (!mQueue.push(entry)) {
+        mDropped++;
+        return false;
+    }
+    mNext++;
+    return true;
+}
+
+template <typename T, size_t N>
+void CircularLog<T, N>::process() {
+    if (mFlash.isBusy()) {
+        return;
+    }
+    if (mInFlight) {
+        mQueue.remove(mInFlight);
+        mInFlight = 0;
+    }
+    if (mQueue.empty()) {
+        return;
+    }
+
+    // Write the entries which are contiguous both in the queue and in the sector
+    const Entry *entries = mQueue.front();
+    size_t perSector = getEntriesPerSector();
+    size_t offset = entries->seq % perSector;
+    size_t count = mQueue.chunkSize();
+    if (count > perSector - offset) {
+        count = perSector - offset;
+    }
+
+    uint32_t address = getEntryAddress(entries->seq);
+    if (offset == 0 && !mFlash.eraseAsync(address, 1)) {
+        return;
+    }
+    if (!mFlash.writeAsync(address, reinterpret_cast<const uint8_t*>(entries), count * sizeof(Entry))) {
+        return;
+    }
+    mInFlight = count;
+}
+
+template <typename T, size_t N>
+bool CircularLog<T, N>::read(uint32_t seq, T &record) {
+    uint32_t first = getFirst();
+    if (seq - first >= mNext - first) {
+        return false;
+    }
+
+    // Records still waiting in the queue are not in flash yet
+    const Entry *queued = mQueue.at(seq - (mNext - mQueue.size()));
+    if (queued != nullptr) {
+        record = queued->data;
+        return true;
+    }
+
+    Entry entry;
+    if (!readEntry(seq, entry)) {
+        return false;
+    }
+    record = entry.data;
+    return true;
+}
+
+template <typename T, size_t N>
+uint32_t CircularLog<T, N>::getFirst() const {
+    size_t perSector = getEntriesPerSector();
+    uint32_t sectorStart = mNext - mNext % perSector;
+    uint32_t span = (mNoSectors - 1) * perSector;
+    return sectorStart > span ? sectorStart - span : 0;
+}
+
+template <typename T, size_t N>
+uint32_t CircularLog<T, N>::getNext() const {
+    return mNext;
+}
+
+template <typename T, size_t N>
+uint32_t CircularLog<T, N>::getDropped() const {
+    return mDropped;
+}
+
+template <typename T, size_t N>
+uint16_t CircularLog<T, N>::calculateCrc(const Entry &entry) {
+    uint16_t crc = Crc16::calculate(reinterpret_cast<const uint8_t*>(&entry.seq), sizeof(entry.seq));
+    return Crc16::calculate(reinterpret_cast<const uint8_t*>(&entry.data), sizeof(T), crc);
+}
+
+template <typename T, size_t N>
+bool CircularLog<T, N>::isErased(const Entry &entry) {
+    const uint8_t *data = reinterpret_cast<const uint8_t*>(&entry);
+    for (size_t i = 0; i < sizeof(Entry); i++) {
+        if (data[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T, size_t N>
+size_t CircularLog<T, N>::getEntriesPerSector() const {
+    return mFlash.getSectorSize() / sizeof(Entry);
+}
+
+template <typename T, size_t N>
+uint32_t CircularLog<T, N>::getEntryAddress(uint32_t seq) const {
+    size_t perSector = getEntriesPerSector();
+    size_t sector = (seq / perSector) % mNoSectors;
+    return mAddress + sector * mFlash.getSectorSize() + (seq % perSector) * sizeof(Entry);
+}
+
+template <typename T, size_t N>
+bool CircularLog<T, N>::readEntry(uint32_t seq, Entry &entry) {
+    if (!mFlash.read(getEntryAddress(seq), reinterpret_cast<uint8_t*>(&entry), sizeof(Entry))) {
+        return false;
+    }
+    return entry.seq == seq && calculateCrc(entry) == entry.crc;
+}
+
+#endif // CIRCULAR_LOG_H
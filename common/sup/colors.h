@@ -1,3 +1,6 @@
+#ifndef COLORS_H
+#define COLORS_H
+
 #include <cstdint>
 
 /// @brief A utility class for working with colors.
@@ -37,15 +40,25 @@ public:
     /// @return The color with adjusted brightness.
     static uint32_t setBrightness(uint32_t color, uint8_t brightness)
     {
-        uint8_t r = (color >> 16) & 0xFF;
-        uint8_t g = (color >> 8) & 0xFF;
-        uint8_t b = color & 0xFF;
-
-        r = r * brightness / 0xFF;
-        g = g * brightness / 0xFF;
-        b = b * brightness / 0xFF;
+        return mix(0, color, brightness);
+    }
 
-        return (r << 16) | (g << 8) | b;
+    /// @brief Blend two colors.
+    ///
+    /// @param color1 The first color (0xRRGGBB), returned for ratio 0.
+    /// @param color2 The second color (0xRRGGBB), returned for ratio 255.
+    /// @param ratio The share of the second color (0-255).
+    /// @return The blended color.
+    static uint32_t mix(uint32_t color1, uint32_t color2, uint8_t ratio)
+    {
+        uint32_t result = 0;
+        for (unsigned shift = 0; shift < 24; shift += 8)
+        {
+            uint32_t c1 = (color1 >> shift) & 0xFF;
+            uint32_t c2 = (color2 >> shift) & 0xFF;
+            result |= div255(c1 * (0xFF - ratio) + c2 * ratio) << shift;
+        }
+        return result;
     }
 
     /// @brief Create a blinking effect between two colors.
@@ -61,4 +74,16 @@ public:
     {
         return ((time % period) < (period / 2)) ? color1 : color2;
     }
-};
\ No newline at end of file
+
+private:
+    /// @brief Divides by 255 without a division instruction.
+    ///
+    /// @param value The dividend, at most 0xFF * 0xFF.
+    /// @return The quotient rounded down.
+    static uint32_t div255(uint32_t value)
+    {
+        return (value + 1 + (value >> 8)) >> 8;
+    }
+};
+
+#endif // COLORS_H
@@ -0,0 +1,29 @@
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <cstdint>
+#include <cstddef>
+
+/// @class Crc16
+/// @brief A utility class for calculating CRC-16/CCITT-FALSE checksums (polynomial 0x1021).
+class Crc16 {
+public:
+    /// @brief Initial value of the checksum.
+    static constexpr uint16_t cInitValue = 0xFFFF;
+
+    /// @brief Calculates the CRC of a data block.
+    ///
+    /// The calculation may be split across multiple calls by passing the result of
+    /// the previous call as the @p crc argument.
+    ///
+    /// @param data Pointer to the data block.
+    /// @param len The length of the data block in bytes.
+    /// @param crc The initial or intermediate CRC value.
+    /// @return The updated CRC value.
+    static uint16_t calculate(const uint8_t *data, size_t len, uint16_t crc = cInitValue);
+
+private:
+    static const uint16_t crc_table[16]; ///< Nibble lookup table.
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include "debounced_switch.h"
+
+DebouncedSwitch::DebouncedSwitch(IGpio &pin, uint32_t (*clock)(), uint32_t debounceTime)
+    : mPin(pin), mClock(clock), mDebounceTime(debounceTime), mInterrupt(false), mState(pin.get()),
+      mPending(false), mSeenEdges(0), mBurstStart(0), mChangeTime(0), mEdges(0), mLastEdge(0)
+{
+}
+
+bool DebouncedSwitch::attach()
+{
+    mInterrupt = mPin.registerEdgeCallback([this]() { this->onEdge(this->mClock()); });
+    return mInterrupt;
+}
+
+bool DebouncedSwitch::process(uint32_t time)
+{
+    if (!mInterrupt && !mPending && mPin.get() != mState)
+    {
+        onEdge(time);
+    }
+
+    uint32_t edges = mEdges;
+    if (edges != mSeenEdges)
+    {
+        // The loop is woken by the interrupt, so the first edge seen starts the burst
+        if (!mPending)
+        {
+            mPending = true;
+            mBurstStart = mLastEdge;
+        }
+        mSeenEdges = edges;
+        return false;
+    }
+
+    if (!mPending || time - mLastEdge < mDebounceTime)
+    {
+        return false;
+    }
+    mPending = false;
+
+    bool state = mPin.get();
+    if (state == mState)
+    {
+        return false;
+    }
+    mState = state;
+    mChangeTime = mBurstStart;
+    return true;
+}
+
+bool DebouncedSwitch::get() const
+{
+    return mState;
+}
+
+uint32_t DebouncedSwitch::getChangeTime() const
+{
+    return mChangeTime;
+}
+
+bool DebouncedSwitch::isPending() const
+{
+    return mPending || mEdges != mSeenEdges;
+}
+
+void DebouncedSwitch::onEdge(uint32_t time)
+{
+    mLastEdge = time;
+    mEdges = mEdges + 1;
+}
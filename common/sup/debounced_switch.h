@@ -0,0 +1,59 @@
+#ifndef DEBOUNCED_SWITCH_H
+#define DEBOUNCED_SWITCH_H
+
+#include <cstdint>
+#include "igpio.h"
+
+/// @class DebouncedSwitch
+/// @brief A switch input debounced from its edge interrupts.
+///
+/// The interrupt only counts the edges and stores the time of the last one, process() called
+/// from the main loop accepts the level of the pin once no edge came for the debounce time. A
+/// burst of contact bounce thus results in a single change, reported with the time of its first
+/// edge, and a glitch returning to the previous level results in none. Pins without edge
+/// interrupts are polled by process() instead.
+class DebouncedSwitch {
+public:
+    /// @brief Constructs the switch, the initial state is the current level of the pin.
+    /// @param pin The switch input.
+    /// @param clock Function returning the current time [ms], called from the interrupt.
+    /// @param debounceTime Time [ms] without an edge after which the level is accepted.
+    DebouncedSwitch(IGpio &pin, uint32_t (*clock)(), uint32_t debounceTime);
+
+    /// @brief Registers the edge interrupt of the pin.
+    /// @return true if the pin has an edge interrupt, false if it is polled.
+    bool attach();
+
+    /// @brief Debounces the edges received since the last call.
+    /// @param time The current time [ms].
+    /// @return true if the debounced state changed.
+    bool process(uint32_t time);
+
+    /// @brief Returns the debounced state of the switch.
+    bool get() const;
+
+    /// @brief Returns the time of the first edge of the last change of the state [ms].
+    uint32_t getChangeTime() const;
+
+    /// @brief Checks whether edges are waiting for the debounce time to pass.
+    bool isPending() const;
+
+private:
+    /// @brief Records an edge, called from the interrupt.
+    /// @param time The current time [ms].
+    void onEdge(uint32_t time);
+
+    IGpio &mPin;
+    uint32_t (*mClock)();
+    uint32_t mDebounceTime;
+    bool mInterrupt;             ///< Set if the edges are reported by the interrupt.
+    bool mState;                 ///< Debounced state.
+    bool mPending;               ///< Set while a burst of edges is being debounced.
+    uint32_t mSeenEdges;         ///< Edge count last seen by process().
+    uint32_t mBurstStart;        ///< Time of the first edge of the current burst [ms].
+    uint32_t mChangeTime;        ///< Time of the first edge of the last change [ms].
+    volatile uint32_t mEdges;    ///< Number of edges, incremented by the interrupt.
+    volatile uint32_t mLastEdge; ///< Time of the last edge [ms].
+};
+
+#endif // DEBOUNCED_SWITCH_H
@@ -0,0 +1,95 @@
+#ifndef DELEGATE_H
+#define DELEGATE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature>
+class Delegate;
+
+/// @brief A non-allocating replacement of std::function for callbacks.
+///
+/// The callable (usually a lambda capturing `this`, or a function pointer) is copied into a fixed
+/// buffer of cStorageSize bytes next to a pointer to a function invoking it, so a call is a
+/// single indirect call. The callable must fit the buffer and be trivially copyable, which is
+/// checked at compile time. Delegates are therefore trivially copyable and destructible
+/// themselves: they never touch the heap and global arrays of them need neither static
+/// constructors nor exit-time destructors.
+///
+/// @tparam R Return type of the callable.
+/// @tparam Args Argument types of the callable.
+template <typename R, typename... Args>
+class Delegate<R(Args...)>
+{
+public:
+    static constexpr size_t cStorageSize = 2 * sizeof(void *); ///< Maximal size of the callable.
+
+    /// @brief Constructs an empty delegate, constant-initialized in global arrays.
+    constexpr Delegate();
+
+    /// @brief Constructs an empty delegate.
+    constexpr Delegate(std::nullptr_t);
+
+    /// @brief Constructs a delegate holding a copy of the callable.
+    /// @param callable A lambda, function object or function pointer with a matching signature.
+    template <typename F, typename = typename std::enable_if<!std::is_same<F, Delegate>::value>::type>
+    Delegate(F callable);
+
+    /// @brief Calls the callable, the delegate must not be empty.
+    R operator()(Args... args) const;
+
+    /// @brief Checks whether the delegate holds a callable.
+    explicit operator bool() const;
+
+private:
+    /// @brief Calls a callable of type F stored in the buffer.
+    template <typename F>
+    static R invoke(const void *storage, Args... args);
+
+    alignas(void *) uint8_t mStorage[cStorageSize]; ///< Copy of the callable.
+    R (*mInvoke)(const void *storage, Args... args); ///< Function invoking the callable, nullptr if empty.
+};
+
+template <typename R, typename... Args>
+constexpr Delegate<R(Args...)>::Delegate() : mStorage{}, mInvoke(nullptr)
+{
+}
+
+template <typename R, typename... Args>
+constexpr Delegate<R(Args...)>::Delegate(std::nullptr_t) : mStorage{}, mInvoke(nullptr)
+{
+}
+
+template <typename R, typename... Args>
+template <typename F, typename>
+Delegate<R(Args...)>::Delegate(F callable) : mStorage{}, mInvoke(&invoke<F>)
+{
+    static_assert(sizeof(F) <= cStorageSize, "Callable does not fit the delegate");
+    static_assert(alignof(F) <= alignof(void *), "Callable is over-aligned for the delegate");
+    static_assert(std::is_trivially_copyable<F>::value, "Callable must be trivially copyable");
+    new (mStorage) F(callable);
+}
+
+template <typename R, typename... Args>
+R Delegate<R(Args...)>::operator()(Args... args) const
+{
+    return mInvoke(mStorage, std::forward<Args>(args)...);
+}
+
+template <typename R, typename... Args>
+Delegate<R(Args...)>::operator bool() const
+{
+    return mInvoke != nullptr;
+}
+
+template <typename R, typename... Args>
+template <typename F>
+R Delegate<R(Args...)>::invoke(const void *storage, Args... args)
+{
+    return (*static_cast<const F *>(storage))(std::forward<Args>(args)...);
+}
+
+#endif // DELEGATE_H
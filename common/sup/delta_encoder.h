@@ -0,0 +1,122 @@
+#ifndef DELTA_ENCODER_H
+#define DELTA_ENCODER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+/// @brief A template class for compressing a stream of multi-channel integer samples.
+///
+/// Each value is stored as the difference to the previous value of the same channel,
+/// zig-zag mapped to an unsigned number (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...) and written
+/// as a LEB128 varint: 7 bits per byte, the most significant bit set on all but the last byte.
+/// Slowly changing signals such as bus voltage or motor current mostly need a single
+/// byte per value instead of two. The previous values start at 0 for every buffer, so the
+/// first sample is stored in full and each buffer can be decoded on its own.
+///
+/// @tparam C The number of channels of a sample.
+template <size_t C>
+class DeltaEncoder
+{
+public:
+    /// @brief Constructs the encoder without a buffer, reset() has to be called before appending.
+    DeltaEncoder();
+
+    /// @brief Starts encoding into a new buffer.
+    /// @param buffer Pointer to the buffer for the encoded data.
+    /// @param size The size of the buffer in bytes.
+    void reset(uint8_t *buffer, size_t size);
+
+    /// @brief Appends a sample to the buffer.
+    /// @param sample The values of all channels.
+    /// @return `true` if the sample was appended, `false` if it does not fit and the buffer is left unchanged.
+    bool append(const int32_t (&sample)[C]);
+
+    /// @brief Returns the number of encoded bytes.
+    /// @return The number of bytes used in the buffer.
+    size_t getSize() const;
+
+    /// @brief Returns the number of appended samples.
+    /// @return The number of samples in the buffer.
+    size_t getCount() const;
+
+    /// @brief Maps a signed value to an unsigned one, small magnitudes to small numbers.
+    /// @param value The signed value.
+    /// @return The zig-zag mapped value.
+    static uint32_t zigZag(int32_t value);
+
+    /// @brief Writes an unsigned value as a LEB128 varint.
+    /// @param value The value to write.
+    /// @param out Pointer to the output, at least cMaxVarintSize bytes.
+    /// @return The number of bytes written.
+    static size_t writeVarint(uint32_t value, uint8_t *out);
+
+    static constexpr size_t cMaxVarintSize = 5; ///< Maximal size of a 32-bit varint.
+
+private:
+    uint8_t *mBuffer;     ///< Buffer for the encoded data.
+    size_t mCapacity;     ///< Size of the buffer.
+    size_t mSize;         ///< Number of bytes used in the buffer.
+    size_t mCount;        ///< Number of samples in the buffer.
+    int32_t mPrevious[C]; ///< Values of the previous sample.
+};
+
+template <size_t C>
+DeltaEncoder<C>::DeltaEncoder(): mBuffer(nullptr), mCapacity(0), mSize(0), mCount(0), mPrevious{} {
+}
+
+template <size_t C>
+void DeltaEncoder<C>::reset(uint8_t *buffer, size_t size) {
+    mBuffer = buffer;
+    mCapacity = size;
+    mSize = 0;
+    mCount = 0;
+    memset(mPrevious, 0, sizeof(mPrevious));
+}
+
+template <size_t C>
+bool DeltaEncoder<C>::append(const int32_t (&sample)[C]) {
+    uint8_t encoded[C * cMaxVarintSize];
+    size_t len = 0;
+
+    for (size_t i = 0; i < C; i++) {
+        len += writeVarint(zigZag(sample[i] - mPrevious[i]), encoded + len);
+    }
+    if (len > mCapacity - mSize) {
+        return false;
+    }
+
+    memcpy(mBuffer + mSize, encoded, len);
+    memcpy(mPrevious, sample, sizeof(mPrevious));
+    mSize += len;
+    mCount++;
+    return true;
+}
+
+template <size_t C>
+size_t DeltaEncoder<C>::getSize() const {
+    return mSize;
+}
+
+template <size_t C>
+size_t DeltaEncoder<C>::getCount() const {
+    return mCount;
+}
+
+template <size_t C>
+uint32_t DeltaEncoder<C>::zigZag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+template <size_t C>
+size_t DeltaEncoder<C>::writeVarint(uint32_t value, uint8_t *out) {
+    size_t len = 0;
+    while (value >= 0x80) {
+        out[len++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = static_cast<uint8_t>(value);
+    return len;
+}
+
+#endif // DELTA_ENCODER_H
@@ -0,0 +1,23 @@
+#ifndef IMAGE_HEADER_H
+#define IMAGE_HEADER_H
+
+#include <cstdint>
+
+/// @brief Header placed at a fixed offset in the application image.
+///
+/// The application defines the header with the magic and version, size and CRC are filled in
+/// after linking by tools/image_header.py. The CRC is the STM32 CRC-32 (polynomial 0x04C11DB7,
+/// initial value 0xFFFFFFFF, 32-bit words, no reflection) of the whole image, calculated with
+/// the crc field set to zero.
+struct ImageHeader
+{
+    uint32_t magic;   ///< cImageMagic.
+    uint32_t size;    ///< Image size in bytes, a multiple of 4.
+    uint32_t crc;     ///< CRC of the image.
+    char version[32]; ///< Application version string.
+};
+
+static constexpr uint32_t cImageMagic = 0x46424948;  ///< "HIBF" in little endian.
+static constexpr uint32_t cImageHeaderOffset = 0x200; ///< Offset of the header from the image start, after the vector table.
+
+#endif // IMAGE_HEADER_H
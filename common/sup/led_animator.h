@@ -0,0 +1,236 @@
+#ifndef LED_ANIMATOR_H
+#define LED_ANIMATOR_H
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include "colors.h"
+#include "ws2812.h"
+
+/// @brief Structure describing the animation of a single LED.
+///
+/// All times are in milliseconds and counted from the moment the animation is applied.
+struct LedAnimation
+{
+    /// @brief Enumeration of the supported animation types.
+    enum class Type : uint8_t {
+        SOLID,      ///< Constant color.
+        BLINK,      ///< Color for the first half of the period, background for the second half.
+        BLINK_CODE, ///< Group of count short blinks followed by a pause, repeated.
+        BREATHE,    ///< Brightness ramps up and down with the period.
+        FADE,       ///< Transition from the background color to the color, held at the end.
+    };
+
+    Type type;           ///< Animation type.
+    uint8_t count;       ///< Number of blinks of a BLINK_CODE.
+    uint16_t period;     ///< Period of BLINK and BREATHE, duration of FADE [ms].
+    uint32_t color;      ///< Main color (0xRRGGBB).
+    uint32_t background; ///< Color between blinks and the start color of FADE (0xRRGGBB).
+
+    /// @brief Creates a constant color.
+    /// @param color The color (0xRRGGBB).
+    static LedAnimation solid(uint32_t color);
+
+    /// @brief Creates a blinking color.
+    /// @param color The color (0xRRGGBB).
+    /// @param period The blinking period [ms].
+    /// @param background The color in the second half of the period (0xRRGGBB).
+    static LedAnimation blink(uint32_t color, uint16_t period, uint32_t background = 0);
+
+    /// @brief Creates a blink code, count blinks followed by a pause.
+    /// @param color The color of the blinks (0xRRGGBB).
+    /// @param count The number of blinks.
+    /// @param background The color between the blinks (0xRRGGBB).
+    static LedAnimation blinkCode(uint32_t color, uint8_t count, uint32_t background = 0);
+
+    /// @brief Creates a color which smoothly brightens and dims.
+    /// @param color The color at full brightness (0xRRGGBB).
+    /// @param period The breathing period [ms].
+    static LedAnimation breathe(uint32_t color, uint16_t period);
+
+    /// @brief Creates a smooth transition between two colors.
+    /// @param from The start color (0xRRGGBB).
+    /// @param to The final color (0xRRGGBB).
+    /// @param duration The duration of the transition [ms].
+    static LedAnimation fade(uint32_t from, uint32_t to, uint16_t duration);
+
+    bool operator==(const LedAnimation &other) const;
+    bool operator!=(const LedAnimation &other) const;
+};
+
+/// @brief A template class rendering per-LED animations on a WS2812 strip at a fixed frame rate.
+///
+/// Animations are declared by setAnimation() from the main loop and rendered by tick(), which
+/// is meant to be called from a periodic timer interrupt. Blink timing therefore does not depend
+/// on how long the control loop takes. An animation equal to the current one is ignored, so it
+/// can be declared on every loop iteration without restarting it.
+///
+/// Each LED has a single pending slot guarded by a flag: the main loop clears the flag, writes the
+/// slot and sets the flag again, and tick() takes the slot only when the flag is set. As the
+/// interrupt always completes before the main loop continues, it never sees a half-written slot.
+///
+/// @tparam S Number of LEDs in the strip.
+template <size_t S>
+class LedAnimator
+{
+public:
+    /// @brief Constructs the animator, all LEDs are off until an animation is set.
+    /// @param leds Reference to the LED strip, which must not be accessed directly afterwards.
+    /// @param framePeriod Time between tick() calls [ms].
+    LedAnimator(Ws2812<S> &leds, uint32_t framePeriod);
+
+    /// @brief Sets the animation of a LED.
+    /// @param led The index of the LED (0-based).
+    /// @param animation The animation, restarted only if it differs from the current one.
+    void setAnimation(size_t led, const LedAnimation &animation);
+
+    /// @brief Sets the same animation for all LEDs.
+    /// @param animation The animation, restarted only if it differs from the current one.
+    void setAnimation(const LedAnimation &animation);
+
+    /// @brief Sets the brightness of the strip, applied by the next tick().
+    /// @param brightness The brightness level (0-255).
+    void setBrightness(uint8_t brightness);
+
+    /// @brief Renders one frame and sends it to the strip, called every frame period.
+    void tick();
+
+private:
+    static constexpr uint32_t cCodeBlinkOn = 200;   ///< Time a LED is lit during a blink code [ms].
+    static constexpr uint32_t cCodeBlinkStep = 500; ///< Time between blinks of a blink code [ms].
+    static constexpr uint32_t cCodePause = 1500;    ///< Pause after a group of blinks [ms].
+
+    /// @brief Returns the color of an animation at the given time.
+    /// @param animation The animation.
+    /// @param elapsed Time since the animation was applied [ms].
+    /// @return The color (0xRRGGBB).
+    static uint32_t render(const LedAnimation &animation, uint32_t elapsed);
+
+    Ws2812<S> &mLeds;               ///< LED strip.
+    uint32_t mFramePeriod;          ///< Time between frames [ms].
+    uint32_t mFrame;                ///< Number of rendered frames.
+    LedAnimation mRequested[S];     ///< Last animation requested by the main loop.
+    LedAnimation mPending[S];       ///< Animation waiting to be applied by tick().
+    volatile bool mPendingValid[S]; ///< Set when the pending slot holds a complete animation.
+    LedAnimation mActive[S];        ///< Animation being rendered.
+    uint32_t mStart[S];             ///< Frame at which the active animation was applied.
+    volatile uint8_t mBrightness;   ///< Requested brightness of the strip.
+};
+
+inline LedAnimation LedAnimation::solid(uint32_t color) {
+    return {Type::SOLID, 0, 0, color, 0};
+}
+
+inline LedAnimation LedAnimation::blink(uint32_t color, uint16_t period, uint32_t background) {
+    return {Type::BLINK, 0, period, color, background};
+}
+
+inline LedAnimation LedAnimation::blinkCode(uint32_t color, uint8_t count, uint32_t background) {
+    return {Type::BLINK_CODE, count, 0, color, background};
+}
+
+inline LedAnimation LedAnimation::breathe(uint32_t color, uint16_t period) {
+    return {Type::BREATHE, 0, period, color, 0};
+}
+
+inline LedAnimation LedAnimation::fade(uint32_t from, uint32_t to, uint16_t duration) {
+    return {Type::FADE, 0, duration, to, from};
+}
+
+inline bool LedAnimation::operator==(const LedAnimation &other) const {
+    return type == other.type && count == other.count && period == other.period &&
+           color == other.color && background == other.background;
+}
+
+inline bool LedAnimation::operator!=(const LedAnimation &other) const {
+    return !(*this == other);
+}
+
+template <size_t S>
+LedAnimator<S>::LedAnimator(Ws2812<S> &leds, uint32_t framePeriod): mLeds(leds), mFramePeriod(framePeriod), mFrame(0), mBrightness(0xFF) {
+    for (size_t i = 0; i < S; i++) {
+        mRequested[i] = LedAnimation::solid(0);
+        mActive[i] = mRequested[i];
+        mPendingValid[i] = false;
+        mStart[i] = 0;
+    }
+}
+
+template <size_t S>
+void LedAnimator<S>::setAnimation(size_t led, const LedAnimation &animation) {
+    if (led >= S || mRequested[led] == animation) {
+        return;
+    }
+    mRequested[led] = animation;
+
+    mPendingValid[led] = false;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    mPending[led] = animation;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    mPendingValid[led] = true;
+}
+
+template <size_t S>
+void LedAnimator<S>::setAnimation(const LedAnimation &animation) {
+    for (size_t i = 0; i < S; i++) {
+        setAnimation(i, animation);
+    }
+}
+
+template <size_t S>
+void LedAnimator<S>::setBrightness(uint8_t brightness) {
+    mBrightness = brightness;
+}
+
+template <size_t S>
+void LedAnimator<S>::tick() {
+    mLeds.setBrightness(mBrightness);
+    for (size_t i = 0; i < S; i++) {
+        if (mPendingValid[i]) {
+            mActive[i] = mPending[i];
+            mStart[i] = mFrame;
+            mPendingValid[i] = false;
+        }
+        mLeds.setColor(i, render(mActive[i], (mFrame - mStart[i]) * mFramePeriod));
+    }
+    mLeds.update();
+    mFrame++;
+}
+
+template <size_t S>
+uint32_t LedAnimator<S>::render(const LedAnimation &animation, uint32_t elapsed) {
+    switch (animation.type) {
+    case LedAnimation::Type::BLINK:
+        return animation.period ? Colors::blinking(animation.period, elapsed, animation.color, animation.background) : animation.color;
+
+    case LedAnimation::Type::BLINK_CODE: {
+        uint32_t blinks = animation.count * cCodeBlinkStep;
+        uint32_t position = elapsed % (blinks + cCodePause);
+        bool lit = position < blinks && (position % cCodeBlinkStep) < cCodeBlinkOn;
+        return lit ? animation.color : animation.background;
+    }
+
+    case LedAnimation::Type::BREATHE: {
+        if (animation.period < 2) {
+            return animation.color;
+        }
+        uint32_t half = animation.period / 2;
+        uint32_t phase = elapsed % (2 * half);
+        uint32_t level = (phase < half ? phase : 2 * half - phase) * 0xFF / half;
+        // Linear ramp, the strip applies the gamma correction
+        return Colors::setBrightness(animation.color, static_cast<uint8_t>(level));
+    }
+
+    case LedAnimation::Type::FADE:
+        if (elapsed >= animation.period) {
+            return animation.color;
+        }
+        return Colors::mix(animation.background, animation.color, static_cast<uint8_t>(elapsed * 0xFF / animation.period));
+
+    case LedAnimation::Type::SOLID:
+    default:
+        return animation.color;
+    }
+}
+
+#endif // LED_ANIMATOR_H
@@ -5,13 +5,14 @@
 #include "ring_buffer.h"
 #include <cassert>
 #include <cstring>
-#include <cstdio>
+#include <atomic>
+#include "delegate.h"
 
 
 
 class UartStream {
     public:
-        UartStream(IUart &uart):mUart(uart), mLines(0), mSending(0) {
+        UartStream(IUart &uart):mUart(uart), mLines(0), mSending(0), mRawMode(false) {
             if(mInstance) {
                 assert("Cannot create second instance");
             }
@@ -21,11 +22,55 @@ class UartStream {
         }
 
         void print(const char* str) {
-            std::size_t len = strlen(str);
-            mTxBuffer.push(reinterpret_cast<const uint8_t*>(str), len);
+            write(reinterpret_cast<const uint8_t*>(str), strlen(str));
+        }
+
+        void write(const uint8_t* data, std::size_t len) {
+            mTxBuffer.push(data, len);
             send();
         }
 
+        /// @brief Waits until all queued data was handed over to the UART.
+        void flush() {
+            while(!mTxBuffer.empty()) {
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        /// @brief Passes received bytes to the receiver instead of the line buffer.
+        ///
+        /// Must not be called while bytes may arrive, which binary transfers ensure by
+        /// switching only between a request and its response.
+        ///
+        /// @param receiver Function called from the interrupt for every byte, empty to return to lines.
+        void setRawReceiver(Delegate<void(uint8_t)> receiver) {
+            mRawMode = false;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            mRawReceiver = receiver;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            mRawMode = static_cast<bool>(mRawReceiver);
+        }
+
+        /// @brief Returns the maximal number of bytes waiting for transmission.
+        size_t getTxPeak() const {
+            return mTxBuffer.peak();
+        }
+
+        /// @brief Returns the maximal number of received bytes waiting to be read.
+        size_t getRxPeak() const {
+            return mRxBuffer.peak();
+        }
+
+        /// @brief Returns the capacity of the transmit buffer.
+        size_t getTxBufferSize() const {
+            return mTxBuffer.capacity();
+        }
+
+        /// @brief Returns the capacity of the receive buffer.
+        size_t getRxBufferSize() const {
+            return mRxBuffer.capacity();
+        }
+
         static UartStream *getInstance() {
             if(!mInstance) {
                 assert("UartStream is not created");
@@ -55,6 +100,10 @@ class UartStream {
     }
 
     void rxCompleted(uint8_t data){
+        if(mRawMode) {
+            mRawReceiver(data);
+            return;
+        }
         mRxBuffer.push(data);
         if(data=='\r') {
             mLines++;
@@ -72,6 +121,8 @@ class UartStream {
     IUart &mUart;
     size_t mLines;
     size_t mSending;
+    volatile bool mRawMode;
+    Delegate<void(uint8_t)> mRawReceiver;
     static UartStream *mInstance;
     RingBuffer<uint8_t, 1024> mTxBuffer;
     RingBuffer<char, 1024> mRxBuffer;
@@ -97,19 +148,31 @@ class Logger {
     }
 
     Logger& operator<<(int value) {
-        char buffer[12]; // Enough to hold all int values including negative sign
-        snprintf(buffer, sizeof(buffer), "%d", value);
-        UartStream::getInstance()->print(buffer);
-        return *this;
+        if (value < 0) {
+            operator<<('-');
+            return printUnsigned(0u - static_cast<uint32_t>(value));
+        }
+        return printUnsigned(static_cast<uint32_t>(value));
     }
 
     Logger& operator<<(uint32_t value) {
-        operator<<(static_cast<int>(value));
-        return *this;
+        return printUnsigned(value);
     }
 
     Logger& operator<<(size_t value) {
-        operator<<(static_cast<int>(value));
+        return printUnsigned(static_cast<uint32_t>(value));
+    }
+
+    private:
+    /// @brief Prints a number in decimal, without snprintf() which pulls in malloc from newlib.
+    Logger& printUnsigned(uint32_t value) {
+        char buffer[11] = {}; // Enough to hold all uint32_t values and the terminator
+        char *digit = &buffer[sizeof(buffer) - 1];
+        do {
+            *--digit = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value);
+        UartStream::getInstance()->print(digit);
         return *this;
     }
 };
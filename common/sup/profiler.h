@@ -0,0 +1,206 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__arm__)
+#include "stm32f1xx_hal.h"
+#else
+#include <chrono>
+#endif
+
+/// @brief Source of the profiler time stamps.
+///
+/// On the target the ticks are CPU cycles of the DWT cycle counter, on the host they are
+/// nanoseconds of std::chrono::steady_clock, so code using the profiler builds on both.
+struct ProfileClock
+{
+    /// @brief Starts the clock.
+    static void enable();
+
+    /// @brief Returns the current time stamp, wrapping at 2^32 ticks.
+    static uint32_t now();
+
+    /// @brief Returns the tick frequency [Hz].
+    static uint32_t frequency();
+};
+
+/// @brief Execution time statistics of a profiled zone.
+///
+/// All times are in ProfileClock ticks. Histogram bucket i counts durations below
+/// 2^(cFirstBucketBits + 2 * i) ticks that do not fit a lower bucket, the last bucket
+/// counts all longer ones.
+struct ProfileStats
+{
+    static constexpr size_t cBuckets = 8;          ///< Number of histogram buckets.
+    static constexpr uint8_t cFirstBucketBits = 8; ///< The first bucket holds durations below 2^8 ticks.
+
+    uint32_t count;               ///< Number of measurements.
+    uint32_t min;                 ///< Shortest duration.
+    uint32_t max;                 ///< Longest duration.
+    uint64_t total;               ///< Sum of all durations.
+    uint16_t histogram[cBuckets]; ///< Duration histogram, saturating.
+
+    /// @brief Returns the average duration, 0 without measurements.
+    uint32_t average() const;
+};
+
+/// @brief A template class collecting execution time statistics of code zones.
+///
+/// Zones are identified by compile-time indexes and measured by Scope objects:
+///
+///     Profiler<2>::Scope<0> zone(profiler);
+///
+/// A zone must be measured from a single context, e.g. only from the main loop or only from
+/// one interrupt. Times measured in the main loop include interrupts taken in between.
+///
+/// @tparam N Number of zones.
+template <size_t N>
+class Profiler
+{
+public:
+    /// @brief Measures the lifetime of the object as one execution of zone Z.
+    /// @tparam Z Index of the zone.
+    template <size_t Z>
+    class Scope
+    {
+        static_assert(Z < N, "Unknown profiler zone");
+
+    public:
+        /// @brief Starts the measurement.
+        /// @param profiler The profiler the measurement is recorded in.
+        explicit Scope(Profiler &profiler) : mProfiler(profiler), mStart(ProfileClock::now()) {}
+
+        /// @brief Ends the measurement and records it.
+        ~Scope() { mProfiler.record(Z, ProfileClock::now() - mStart); }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Profiler &mProfiler;
+        uint32_t mStart;
+    };
+
+    /// @brief Constructs the profiler and starts the clock.
+    Profiler();
+
+    /// @brief Records one execution of a zone.
+    /// @param zone Index of the zone.
+    /// @param ticks Duration of the execution.
+    void record(size_t zone, uint32_t ticks);
+
+    /// @brief Returns the statistics of a zone.
+    /// @param zone Index of the zone.
+    /// @return The statistics, empty for an unknown zone.
+    ProfileStats getStats(size_t zone) const;
+
+    /// @brief Clears the statistics of all zones.
+    void reset();
+
+    /// @brief Returns the number of zones.
+    static constexpr size_t size() { return N; }
+
+private:
+    ProfileStats mStats[N];
+};
+
+inline uint32_t ProfileStats::average() const
+{
+    return count ? static_cast<uint32_t>(total / count) : 0;
+}
+
+#if defined(__arm__)
+
+inline void ProfileClock::enable()
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+inline uint32_t ProfileClock::now()
+{
+    return DWT->CYCCNT;
+}
+
+inline uint32_t ProfileClock::frequency()
+{
+    return SystemCoreClock;
+}
+
+#else
+
+inline void ProfileClock::enable()
+{
+}
+
+inline uint32_t ProfileClock::now()
+{
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline uint32_t ProfileClock::frequency()
+{
+    return 1000000000;
+}
+
+#endif
+
+template <size_t N>
+Profiler<N>::Profiler()
+{
+    ProfileClock::enable();
+    reset();
+}
+
+template <size_t N>
+void Profiler<N>::record(size_t zone, uint32_t ticks)
+{
+    if (zone >= N)
+    {
+        return;
+    }
+    ProfileStats &stats = mStats[zone];
+
+    if (stats.count == 0 || ticks < stats.min)
+    {
+        stats.min = ticks;
+    }
+    if (ticks > stats.max)
+    {
+        stats.max = ticks;
+    }
+    stats.count++;
+    stats.total += ticks;
+
+    // Bucket by the bit length of the duration, two bits per bucket
+    int bits = ticks ? 32 - __builtin_clz(ticks) : 0;
+    size_t bucket = bits > ProfileStats::cFirstBucketBits ? (bits - ProfileStats::cFirstBucketBits + 1) / 2 : 0;
+    if (bucket >= ProfileStats::cBuckets)
+    {
+        bucket = ProfileStats::cBuckets - 1;
+    }
+    if (stats.histogram[bucket] != UINT16_MAX)
+    {
+        stats.histogram[bucket]++;
+    }
+}
+
+template <size_t N>
+ProfileStats Profiler<N>::getStats(size_t zone) const
+{
+    return zone < N ? mStats[zone] : ProfileStats{};
+}
+
+template <size_t N>
+void Profiler<N>::reset()
+{
+    for (ProfileStats &stats : mStats)
+    {
+        stats = {};
+    }
+}
+
+#endif // PROFILER_H
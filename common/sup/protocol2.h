@@ -3,7 +3,7 @@
 
 #include "base64.h"
 #include <cstdint>
-#include <functional>
+#include "delegate.h"
 #include <cstring>
 
 
@@ -66,11 +66,14 @@ private:
         uint16_t crc; ///< CRC checksum of the output data
     };
 
+    /// Function executing a command
+    using CmdDelegate = Delegate<bool(const InType &inData, OutType &outData, size_t &outDataLen)>;
+
     /// Structure representing a command and its corresponding function
     struct CmdFnc
     {
-        char cmd;                                                                            ///< Command identifier
-        std::function<bool(const InType &inData, OutType &outData, size_t &outDataLen)> fnc; ///< Function to execute for the command
+        char cmd;        ///< Command identifier
+        CmdDelegate fnc; ///< Function to execute for the command
     };
 
     CmdFnc mFncPtr[N] = {}; ///< Array of registered command functions
@@ -98,7 +101,7 @@ public:
     /// @param fnc The function to execute when the command is received.
     /// @return true if the command was registered successfully.
     /// @return false if the command could not be registered (e.g., if the command is already registered).
-    bool registerCmd(char cmd, std::function<bool(const InType &inData, OutType &outData, size_t &outDataLen)> fnc);
+    bool registerCmd(char cmd, CmdDelegate fnc);
 
 private:
     /// @brief Decodes a Base64 encoded input string into an InData structure.
@@ -148,7 +151,7 @@ private:
 };
 
 template <typename InType, typename OutType, size_t N>
-bool Protocol<InType, OutType, N>::registerCmd(char cmd, std::function<bool(const InType &inData, OutType &outData, size_t &outDataLen)> fnc)
+bool Protocol<InType, OutType, N>::registerCmd(char cmd, CmdDelegate fnc)
 {
     for (size_t i = 0; i < N; i++)
     {
@@ -62,6 +62,12 @@ public:
     /// @return const T* Pointer to the front element.
     const T *front() const;
 
+    /// @brief Get a pointer to an element without removing it.
+    ///
+    /// @param index The position of the element, 0 is the front.
+    /// @return const T* Pointer to the element, nullptr if there are fewer elements.
+    const T *at(std::size_t index) const;
+
     /// @brief Get the size of the continuous chunk of elements starting from the front.
     ///
     /// @return std::size_t The size of the continuous chunk.
@@ -74,14 +80,26 @@ public:
     /// @return false If the specified number of elements exceeds the number of elements in the ring buffer.
     bool remove(std::size_t len);
 
+    /// @brief Get the maximal number of elements stored since construction or resetPeak().
+    ///
+    /// @return std::size_t The peak number of elements.
+    std::size_t peak() const;
+
+    /// @brief Reset the peak number of elements to the current number.
+    void resetPeak();
+
 private:
+    /// @brief Update the peak number of elements after a push.
+    void updatePeak();
+
     T mBuffer[S]; ///< The buffer storing the elements.
     T *mInPtr;    ///< Pointer to the position where the next element will be inserted.
     T *mOutPtr;   ///< Pointer to the position of the next element to be removed.
+    std::size_t mPeak; ///< Maximal number of elements stored.
 };
 
 template <typename T, std::size_t S>
-RingBuffer<T, S>::RingBuffer() : mBuffer{}, mInPtr(mBuffer), mOutPtr(mBuffer) {}
+RingBuffer<T, S>::RingBuffer() : mBuffer{}, mInPtr(mBuffer), mOutPtr(mBuffer), mPeak(0) {}
 
 template <typename T, std::size_t S>
 bool RingBuffer<T, S>::push(const T &data)
@@ -92,6 +110,7 @@ bool RingBuffer<T, S>::push(const T &data)
     }
     *mInPtr = data;
     mInPtr = mBuffer + ((mInPtr - mBuffer + 1) % S);
+    updatePeak();
     return true;
 }
 
@@ -113,6 +132,7 @@ bool RingBuffer<T, S>::push(const T *data, std::size_t len)
         std::copy(data + spaceToEnd, data + len, mBuffer);
     }
     mInPtr = mBuffer + ((mInPtr - mBuffer + len) % S);
+    updatePeak();
     return true;
 }
 
@@ -165,6 +185,16 @@ const T *RingBuffer<T, S>::front() const
     return mOutPtr;
 }
 
+template <typename T, std::size_t S>
+const T *RingBuffer<T, S>::at(std::size_t index) const
+{
+    if (index >= size())
+    {
+        return nullptr;
+    }
+    return mBuffer + ((mOutPtr - mBuffer + index) % S);
+}
+
 template <typename T, std::size_t S>
 std::size_t RingBuffer<T, S>::chunkSize() const
 {
@@ -182,4 +212,26 @@ bool RingBuffer<T, S>::remove(std::size_t len)
     return true;
 }
 
+template <typename T, std::size_t S>
+std::size_t RingBuffer<T, S>::peak() const
+{
+    return mPeak;
+}
+
+template <typename T, std::size_t S>
+void RingBuffer<T, S>::resetPeak()
+{
+    mPeak = size();
+}
+
+template <typename T, std::size_t S>
+void RingBuffer<T, S>::updatePeak()
+{
+    std::size_t used = size();
+    if (used > mPeak)
+    {
+        mPeak = used;
+    }
+}
+
 #endif
@@ -2,24 +2,73 @@
 #define SETTINGS_H
 
 #include "iflash.h"
+#include "crc16.h"
+#include <cstring>
 
 /// @brief A template class for managing settings stored in flash memory.
+///
+/// Settings are kept in two slots (A/B). Every save goes to the slot which does not hold
+/// the currently loaded copy and carries a generation counter incremented on each save,
+/// so a power loss during erase or write leaves the previous copy intact. At boot only
+/// the headers of both slots are read, and the data of the newest slot is verified
+/// against its CRC before it is accepted.
+///
+/// Each slot occupies a whole number of flash sectors, so the settings take
+/// `2 * getSlotSize()` bytes starting from the given address.
+///
+/// Changes made through get() may be marked with markDirty() instead of being saved
+/// immediately; commitIfIdle() then writes them once after a quiet period, so a burst
+/// of updates costs a single erase and program cycle. Such a save is only queued on the
+/// flash (see IFlash::eraseAsync()), commitIfIdle() keeps checking it on subsequent calls
+/// and accepts the new slot once its content has been read back and verified.
+///
+/// Firmware before the A/B slots stored a single record, the data followed by a CRC field
+/// which was always written as 0. If neither slot has ever been programmed, load() reads
+/// such a record from the legacy address once and writes it out as generation 1, into the
+/// second slot if the record lies in the first one. A legacy record with a different size
+/// than T is converted by the migration function.
+///
+/// The size in the slot header identifies the layout of the stored data. A slot written
+/// with another layout of T is converted by the migration function as well, and load()
+/// saves the result in the other slot, so the old copy stays until the next save. Of a
+/// layout larger than T, e.g. written by a build with more entries, only the first
+/// `sizeof(T)` bytes are passed to the migration function.
+///
 /// @tparam T The type of the settings data to be managed.
-/// @todo Add calculation and checking CRC
 template <typename T>
 class Settings
 {
 public:
+    /// @brief Converts settings data stored with another layout of T.
+    /// @param data The stored data, only its first `sizeof(T)` bytes if it is larger.
+    /// @param size The size of the stored data, identifies its layout.
+    /// @param settings The settings to fill, holding the current values.
+    /// @return `true` if the layout is known and was converted, `false` otherwise.
+    typedef bool (*Migration)(const uint8_t *data, size_t size, T &settings);
+
+    static constexpr uint32_t cNoLegacyAddress = UINT32_MAX; ///< No legacy record to read.
+
     /// @brief Constructor that initializes the Settings class.
     /// @param flash Reference to the Flash object used for reading and writing to flash memory.
     /// @param address The address in flash memory where the settings are stored.
-    Settings(IFlash &flash, uint32_t address);
+    /// @param legacyAddress The address of the record written before the A/B slots.
+    /// @param legacySize The size of the data of the legacy record.
+    /// @param migration Function converting older layouts of T, nullptr if there are none.
+    Settings(IFlash &flash, uint32_t address, uint32_t legacyAddress = cNoLegacyAddress,
+             size_t legacySize = sizeof(T), Migration migration = nullptr);
 
-    /// @brief Loads the settings from flash memory.
+    /// @brief Loads the newest valid copy of the settings from flash memory.
+    ///
+    /// If none of the slots holds a valid copy, the settings data is left unchanged, unless
+    /// the slots were never programmed and the legacy record is valid.
+    ///
     /// @return `true` if the settings were successfully loaded, `false` otherwise.
     bool load();
 
-    /// @brief Saves the current settings to flash memory.
+    /// @brief Saves the current settings to the inactive slot in flash memory.
+    ///
+    /// Waits until the save completes, including a save started by commitIfIdle().
+    ///
     /// @return `true` if the settings were successfully saved, `false` otherwise.
     bool save();
 
@@ -27,46 +76,352 @@ public:
     /// @return A reference to the settings data.
     T &get();
 
+    /// @brief Marks the settings data as modified but not yet saved.
+    /// @param time The current time in milliseconds, starts the quiet period.
+    void markDirty(uint32_t time);
+
+    /// @brief Checks whether the settings data has unsaved modifications.
+    /// @return `true` if there are unsaved modifications, `false` otherwise.
+    bool isDirty() const;
+
+    /// @brief Saves the settings if they have unsaved modifications.
+    /// @return `true` if the settings are saved, `false` if saving failed.
+    bool commit();
+
+    /// @brief Saves the settings once no modification was made for the given period.
+    ///
+    /// Does not wait for the flash, the save is started on one call and completed on
+    /// a later one. A failed save is retried after another quiet period.
+    ///
+    /// @param time The current time in milliseconds.
+    /// @param quietPeriod The time since the last modification after which the settings are saved.
+    /// @return `false` if saving failed, `true` otherwise.
+    bool commitIfIdle(uint32_t time, uint32_t quietPeriod);
+
+    /// @brief Returns the size of a single settings slot.
+    /// @return The size of a slot in bytes, a multiple of the flash sector size.
+    size_t getSlotSize() const;
+
 private:
-    IFlash &mFlash;         ///< Reference to the Flash object for flash memory operations.
-    uint32_t mAddress;     ///< The address in flash memory where the settings are stored.
-    
-    /// @brief Structure to hold the settings data and its associated CRC.
-    struct {
-        T data;            ///< The settings data.
-        uint16_t crc;      ///< The CRC checksum for the settings data.
-    } mData;
+    /// @brief Header stored at the beginning of each slot.
+    struct Header {
+        uint32_t magic;      ///< Marks a programmed slot, see cMagic.
+        uint32_t generation; ///< Incremented on every save, the higher one is newer.
+        uint16_t size;       ///< Size of the settings data, identifies its layout.
+        uint16_t crc;        ///< CRC of the generation counter and the settings data.
+    };
+
+    /// @brief Checks whether the slot header describes a copy of this settings type.
+    ///
+    /// Copies of other layouts have a different size than T, whether they can be converted
+    /// is decided when their data is read.
+    ///
+    /// @param header The header to check.
+    /// @return `true` if the header is valid, `false` otherwise.
+    bool isHeaderValid(const Header &header) const;
+
+    /// @brief Calculates the CRC of a slot.
+    /// @param generation The generation counter of the slot.
+    /// @param data The settings data of the slot.
+    /// @param size The size of the settings data.
+    /// @return The calculated CRC.
+    static uint16_t calculateCrc(uint32_t generation, const uint8_t *data, size_t size);
+
+    /// @brief Reads the settings data of a slot and verifies it against the header.
+    /// @param slot The slot index (0 or 1).
+    /// @param header The header previously read from the slot.
+    /// @return `true` if the data was read, its CRC matches and its layout is known, `false` otherwise.
+    bool loadSlot(size_t slot, const Header &header);
+
+    /// @brief Reads the legacy record and saves it in a slot which does not overlap it.
+    /// @return `true` if the record was valid and converted, `false` otherwise.
+    bool loadLegacy();
+
+    /// @brief Replaces the settings data with stored data, converting an older layout.
+    /// @param data The stored data.
+    /// @param size The size of the stored data.
+    /// @return `true` if the data was accepted, `false` if its layout is unknown.
+    bool convert(const uint8_t *data, size_t size);
+
+    /// @brief Queues the erase and write of the inactive slot.
+    ///
+    /// Has to be called only when the flash queue has room for cSaveJobs operations.
+    ///
+    /// @return `true` if the operations were queued, `false` otherwise.
+    bool startSave();
+
+    /// @brief Verifies the slot written by startSave() and makes it the active one.
+    ///
+    /// Has to be called once the flash has no pending operations.
+    ///
+    /// @return `true` if the slot holds the saved copy, `false` otherwise.
+    bool finishSave();
+
+    /// @brief Returns the flash address of a slot.
+    /// @param slot The slot index (0 or 1).
+    /// @return The address of the slot.
+    uint32_t getSlotAddress(size_t slot) const;
+
+    static constexpr uint32_t cMagic = 0x53455454; ///< "SETT"
+    static constexpr size_t cNoSlots = 2;          ///< Number of slots.
+    static constexpr size_t cSaveJobs = 3;         ///< Flash operations queued by startSave().
+
+    IFlash &mFlash;          ///< Reference to the Flash object for flash memory operations.
+    uint32_t mAddress;       ///< The address in flash memory where the settings are stored.
+    uint32_t mLegacyAddress; ///< The address of the record written before the A/B slots.
+    size_t mLegacySize;      ///< The size of the data of the legacy record.
+    Migration mMigration;    ///< Function converting older layouts of T.
+    size_t mActiveSlot;      ///< Slot holding the currently loaded copy.
+    uint32_t mGeneration;    ///< Generation counter of the currently loaded copy.
+    bool mDirty;             ///< Set when the settings data has unsaved modifications.
+    uint32_t mDirtyTime;     ///< Time of the last modification.
+    bool mSaving;            ///< Set while a save is queued on the flash.
+    Header mSaveHeader;      ///< Header being written, has to outlive the queued write.
+    T mData;                 ///< The settings data.
 };
 
 template <typename T>
-Settings<T>::Settings(IFlash &flash, uint32_t address): mFlash(flash), mAddress(address) {
+Settings<T>::Settings(IFlash &flash, uint32_t address, uint32_t legacyAddress, size_t legacySize, Migration migration)
+    : mFlash(flash), mAddress(address), mLegacyAddress(legacyAddress), mLegacySize(legacySize), mMigration(migration), mActiveSlot(cNoSlots - 1), mGeneration(0), mDirty(false), mDirtyTime(0), mSaving(false), mSaveHeader{}, mData{} {
     load();
 }
 
 template <typename T>
 bool Settings<T>::load() {
-    if(!mFlash.read(mAddress, reinterpret_cast<uint8_t*>(&mData), sizeof(mData))) {
+    Header headers[cNoSlots];
+    bool valid[cNoSlots];
+    bool programmed = false;
+
+    for (size_t slot = 0; slot < cNoSlots; slot++) {
+        bool read = mFlash.read(getSlotAddress(slot), reinterpret_cast<uint8_t*>(&headers[slot]), sizeof(Header));
+        programmed = programmed || !read || headers[slot].magic == cMagic;
+        valid[slot] = read && isHeaderValid(headers[slot]);
+    }
+
+    // Try the newest slot first, fall back to the older one if its data is corrupted
+    size_t newest = 0;
+    if (valid[0] && valid[1]) {
+        newest = static_cast<int32_t>(headers[1].generation - headers[0].generation) > 0 ? 1 : 0;
+    } else if (valid[1]) {
+        newest = 1;
+    }
+
+    for (size_t i = 0; i < cNoSlots; i++) {
+        size_t slot = (newest + i) % cNoSlots;
+        if (valid[slot] && loadSlot(slot, headers[slot])) {
+            mActiveSlot = slot;
+            mGeneration = headers[slot].generation;
+            if (headers[slot].size != sizeof(T)) {
+                save();
+            }
+            return true;
+        }
+    }
+
+    // A damaged slot means the legacy record was already migrated or never existed
+    return !programmed && loadLegacy();
+}
+
+template <typename T>
+bool Settings<T>::save() {
+    // Complete a save started by commitIfIdle() first, it may hold older data
+    if(mSaving) {
+        while(mFlash.isBusy()) {
+            mFlash.process();
+        }
+        finishSave();
+    }
+    // Operations queued by other users of the flash have to make room first
+    while(mFlash.getQueueSpace() < cSaveJobs) {
+        mFlash.process();
+    }
+    if(!startSave()) {
         return false;
     }
-    if(mData.crc != 0) {
+    while(mFlash.isBusy()) {
+        mFlash.process();
+    }
+    return finishSave();
+}
+
+template <typename T>
+T &Settings<T>::get() {
+    return mData;
+}
+
+template <typename T>
+void Settings<T>::markDirty(uint32_t time) {
+    mDirty = true;
+    mDirtyTime = time;
+}
+
+template <typename T>
+bool Settings<T>::isDirty() const {
+    return mDirty;
+}
+
+template <typename T>
+bool Settings<T>::commit() {
+    if(!mDirty) {
+        return true;
+    }
+    return save();
+}
+
+template <typename T>
+bool Settings<T>::commitIfIdle(uint32_t time, uint32_t quietPeriod) {
+    if(mSaving) {
+        if(mFlash.isBusy()) {
+            return true;
+        }
+        if(!finishSave()) {
+            mDirtyTime = time;
+            return false;
+        }
+        return true;
+    }
+    if(!mDirty || time - mDirtyTime < quietPeriod) {
+        return true;
+    }
+    if(mFlash.getQueueSpace() < cSaveJobs) {
+        // Deferred to a later call instead of leaving the save half queued
+        return true;
+    }
+    if(!startSave()) {
+        mDirtyTime = time;
+        return false;
+    }
+    return true;
+}
+
+template <typename T>
+bool Settings<T>::startSave() {
+    size_t slot = (mActiveSlot + 1) % cNoSlots;
+    uint32_t address = getSlotAddress(slot);
+    mSaveHeader.magic = cMagic;
+    mSaveHeader.generation = mGeneration + 1;
+    mSaveHeader.size = sizeof(T);
+    mSaveHeader.crc = calculateCrc(mSaveHeader.generation, reinterpret_cast<const uint8_t*>(&mData), sizeof(T));
+
+    // The header is written last, so an interrupted write leaves the slot invalid
+    if(!mFlash.eraseAsync(address, getSlotSize() / mFlash.getSectorSize()) ||
+       !mFlash.writeAsync(address + sizeof(Header), reinterpret_cast<const uint8_t*>(&mData), sizeof(T)) ||
+       !mFlash.writeAsync(address, reinterpret_cast<const uint8_t*>(&mSaveHeader), sizeof(Header))) {
+        // Operations already queued leave the inactive slot invalid, which is harmless
         return false;
     }
 
+    // Modifications made from now on need another save
+    mSaving = true;
+    mDirty = false;
     return true;
 }
 
 template <typename T>
-bool Settings<T>::save() {
-    mData.crc = 0;
-    if(!mFlash.erase(mAddress, sizeof(mData)/mFlash.getSectorSize()+1)) {
+bool Settings<T>::finishSave() {
+    mSaving = false;
+    size_t slot = (mActiveSlot + 1) % cNoSlots;
+    Header header;
+    T data;
+
+    // mData may have changed while the write was queued, so verify what actually landed in flash
+    bool result = mFlash.read(getSlotAddress(slot), reinterpret_cast<uint8_t*>(&header), sizeof(Header)) &&
+                  mFlash.read(getSlotAddress(slot) + sizeof(Header), reinterpret_cast<uint8_t*>(&data), sizeof(T)) &&
+                  isHeaderValid(header) && header.size == sizeof(T) && header.generation == mSaveHeader.generation &&
+                  calculateCrc(header.generation, reinterpret_cast<const uint8_t*>(&data), sizeof(T)) == header.crc;
+    if(!result) {
+        mDirty = true;
         return false;
     }
-    return mFlash.write(mAddress, reinterpret_cast<uint8_t*>(&mData), sizeof(mData));
+
+    mActiveSlot = slot;
+    mGeneration = header.generation;
+    return true;
 }
 
 template <typename T>
-T &Settings<T>::get() {
-    return mData.data;
+size_t Settings<T>::getSlotSize() const {
+    size_t sectorSize = mFlash.getSectorSize();
+    return (sizeof(Header) + sizeof(T) + sectorSize - 1) / sectorSize * sectorSize;
+}
+
+template <typename T>
+bool Settings<T>::isHeaderValid(const Header &header) const {
+    return header.magic == cMagic && header.size != 0 && header.size <= getSlotSize() - sizeof(Header);
+}
+
+template <typename T>
+uint16_t Settings<T>::calculateCrc(uint32_t generation, const uint8_t *data, size_t size) {
+    uint16_t crc = Crc16::calculate(reinterpret_cast<const uint8_t*>(&generation), sizeof(generation));
+    return Crc16::calculate(data, size, crc);
+}
+
+template <typename T>
+bool Settings<T>::loadSlot(size_t slot, const Header &header) {
+    uint8_t data[sizeof(T)];
+    uint32_t address = getSlotAddress(slot) + sizeof(Header);
+    size_t size = header.size < sizeof(T) ? header.size : sizeof(T);
+    if(!mFlash.read(address, data, size)) {
+        return false;
+    }
+    uint16_t crc = calculateCrc(header.generation, data, size);
+
+    // The CRC covers the rest of a larger layout as well, which is not converted
+    for(size_t offset = size; offset < header.size;) {
+        uint8_t chunk[32];
+        size_t len = header.size - offset < sizeof(chunk) ? header.size - offset : sizeof(chunk);
+        if(!mFlash.read(address + offset, chunk, len)) {
+            return false;
+        }
+        crc = Crc16::calculate(chunk, len, crc);
+        offset += len;
+    }
+    if(crc != header.crc) {
+        return false;
+    }
+    return convert(data, header.size);
+}
+
+template <typename T>
+bool Settings<T>::loadLegacy() {
+    uint8_t data[sizeof(T)];
+    uint16_t crc;
+    uint32_t crcOffset = (mLegacySize + 1) & ~1u;
+    if(mLegacyAddress == cNoLegacyAddress || mLegacySize > sizeof(T) ||
+       !mFlash.read(mLegacyAddress, data, mLegacySize) ||
+       !mFlash.read(mLegacyAddress + crcOffset, reinterpret_cast<uint8_t*>(&crc), sizeof(crc)) ||
+       crc != 0 || !convert(data, mLegacySize)) {
+        return false;
+    }
+
+    // Once saved the slots are programmed and the legacy record is not read again. It may lie
+    // in the first slot, then the copy goes to the second one, so the record stays intact
+    // until the copy is verified.
+    uint32_t legacyEnd = mLegacyAddress + crcOffset + sizeof(crc);
+    bool inFirstSlot = mLegacyAddress < getSlotAddress(0) + getSlotSize() && legacyEnd > getSlotAddress(0);
+    mActiveSlot = inFirstSlot ? 0 : cNoSlots - 1;
+    mGeneration = 0;
+    save();
+    return true;
+}
+
+template <typename T>
+bool Settings<T>::convert(const uint8_t *data, size_t size) {
+    if(size == sizeof(T)) {
+        memcpy(&mData, data, sizeof(T));
+        return true;
+    }
+    T converted = mData;
+    if(mMigration == nullptr || !mMigration(data, size, converted)) {
+        return false;
+    }
+    mData = converted;
+    return true;
+}
+
+template <typename T>
+uint32_t Settings<T>::getSlotAddress(size_t slot) const {
+    return mAddress + slot * getSlotSize();
 }
 
 #endif // SETTINGS_H
@@ -0,0 +1,37 @@
+#ifndef STATIC_STORAGE_H
+#define STATIC_STORAGE_H
+
+#include <cstdint>
+#include <new>
+#include <utility>
+
+/// @brief A template class providing statically allocated storage for a single object.
+///
+/// The storage is sized and aligned for T at compile time and the object is constructed in it at
+/// run time by create(), so objects which need the hardware initialized first can be placed in
+/// .bss instead of the heap. A zero-initialized storage needs no static constructor. The object is
+/// never destroyed.
+///
+/// @tparam T Type of the stored object.
+template <typename T>
+class StaticStorage
+{
+public:
+    /// @brief Constructs the object in the storage.
+    /// @param args Arguments passed to the constructor of T.
+    /// @return Pointer to the constructed object.
+    template <typename... Args>
+    T *create(Args &&...args);
+
+private:
+    alignas(T) uint8_t mData[sizeof(T)];
+};
+
+template <typename T>
+template <typename... Args>
+T *StaticStorage<T>::create(Args &&...args)
+{
+    return new (mData) T(std::forward<Args>(args)...);
+}
+
+#endif // STATIC_STORAGE_H
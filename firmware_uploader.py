@@ -1,66 +1,136 @@
 import base64
+import binascii
+import os
 import serial
 import time
 import struct
 import sys
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), 'tools'))
+import lzss_pack
+
+FRAME_START = 0xA5
+ACK = 0x06
+NAK = 0x15
+FAILED = 0x18
+
 class ProtocolUploader:
+    """Uploads a firmware image to the bootloader.
+
+    The 'b' command erases the application area and switches the bootloader to binary frames
+    [0xA5, seq, len (LE16), data, crc16 (LE16)]. Up to `window` frames are sent ahead of the
+    last acknowledged one, so the bootloader programs a chunk while the next ones arrive.
+    The image is sent as an LZSS stream (see tools/lzss_pack.py), which the bootloader
+    decompresses while programming.
+    """
+
     def __init__(self, port, baudrate=115200):
-        self.ser = serial.Serial(port, baudrate)
-    
-    def encode_base64(self, data):
-        return base64.b64encode(data).decode('ascii')
-    
-    def send_command(self, command):
-        print("cmd:", command)
-        #self.ser.write((command + '\r').encode('ascii'))
-        for d in (command + '\r'):
-            self.ser.write(d.encode('ascii'))
-            time.sleep(0.0001)
-    
-    def send_data(self, data):
-        for d in data.encode('ascii'):
-            self.ser.write(d)
-            time.sleep(0.2)
-        self.ser.write(b'\r')
-    
-    def upload_file(self, file_path):
+        self.ser = serial.Serial(port, baudrate, timeout=1.0)
+
+    def encode_command(self, cmd, data=b''):
+        frame = bytes([ord(cmd), len(data)]) + data + bytes(2)
+        return base64.b64encode(frame) + b'\r'
+
+    def decode_response(self, line):
+        decoded = base64.b64decode(line)
+        return decoded[2:-2]  # excluding cmd, len and CRC
+
+    def send_command(self, cmd, data=b'', timeout=1.0):
+        self.ser.reset_input_buffer()
+        self.ser.write(self.encode_command(cmd, data))
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            line = self.ser.readline().decode('ascii', errors='ignore').strip()
+            if line and not line.startswith('LOG:'):
+                return self.decode_response(line)
+        raise TimeoutError(f"No response to '{cmd}' command")
+
+    def make_frame(self, seq, chunk):
+        header = struct.pack('<BH', seq & 0xFF, len(chunk))
+        crc = binascii.crc_hqx(header + chunk, 0xFFFF)  # CRC-16/CCITT-FALSE
+        return bytes([FRAME_START]) + header + chunk + struct.pack('<H', crc)
+
+    def read_response(self):
+        # Skip anything which is not a response, e.g. the rest of a log line
+        while True:
+            code = self.ser.read(1)
+            if not code:
+                return None, None
+            if code[0] in (ACK, NAK, FAILED):
+                seq = self.ser.read(1)
+                return (code[0], seq[0]) if seq else (None, None)
+
+    def upload_file(self, file_path, compress=True):
+        """Uploads a .bin image, or a .lzss image created by tools/lzss_pack.py."""
         with open(file_path, 'rb') as f:
             file_data = f.read()
 
-        # Send the 'L' command with file size
-        file_size = len(file_data)
-        command_data = struct.pack('<cI', b'L', file_size)
-        encoded_command = self.encode_base64(command_data)
-        self.send_command(encoded_command)
-        self.wait_for_response()
-
-        # Send the 'C' commands with file data in chunks
-        chunk_size = 64
-        for i in range(0, file_size, chunk_size):
-            chunk = file_data[i:i+chunk_size]
-            command_data = struct.pack('<cB', b'C', len(chunk)) + chunk
-            encoded_command = self.encode_base64(command_data)
-            self.send_command(encoded_command)
-            self.wait_for_response()
-    
-    def wait_for_response(self):
-        while True:
-            response = self.ser.readline().decode('ascii').strip()
-            print(f"Response: {response}")
-            if 'Response' in response:
-                return response
-            else:
-                self.send_data('')
-    
-    def wait_for_bootloader(self):
-        while True:
-            line = self.ser.readline().decode('ascii').strip()
-            print(f"Received: {line}")
-            if "Bootloader BS" in line:
-                print("Bootloader BS detected, ready to upload.")
-                break
-    
+        if file_path.endswith('.lzss'):
+            image_size, file_data = lzss_pack.unpack(file_data)
+            compressed = True
+        elif compress:
+            image_size = len(file_data)
+            _, file_data = lzss_pack.unpack(lzss_pack.pack(file_data))
+            compressed = True
+        else:
+            image_size = len(file_data)
+            compressed = False
+
+        # Erasing the whole application area takes a while
+        response = self.send_command('b', struct.pack('<IB', image_size, compressed), timeout=5.0)
+        result, window, chunk_size = struct.unpack('<BBH', response[:4])
+        if not result:
+            raise RuntimeError("Bootloader refused the image")
+
+        chunks = [file_data[i:i + chunk_size] for i in range(0, len(file_data), chunk_size)]
+        chunks.append(b'')  # final frame
+        frames = [self.make_frame(seq, chunk) for seq, chunk in enumerate(chunks)]
+
+        start = time.time()
+        base = 0       # oldest frame not acknowledged
+        next_seq = 0   # next frame to send
+        while base < len(frames):
+            while next_seq < len(frames) and next_seq < base + window:
+                self.ser.write(frames[next_seq])
+                next_seq += 1
+
+            code, seq = self.read_response()
+            if code is None:
+                print(f"Timeout, resending from frame {base}")
+                next_seq = base
+                continue
+
+            # Sequence numbers wrap at 256, the response refers to a frame near the base
+            seq = base + ((seq - base) & 0xFF)
+            if code == FAILED:
+                raise RuntimeError(f"Programming failed at frame {seq}")
+            if code == ACK and seq > base:
+                base = min(seq, len(frames))
+            elif code == NAK:
+                print(f"Frame {seq} corrupted, resending")
+                next_seq = base
+            print(f"\rUploaded {min(base * chunk_size, len(file_data))}/{len(file_data)} bytes", end='')
+
+        elapsed = time.time() - start
+        print(f"\nUpload of {image_size} bytes as {len(file_data)} bytes finished in {elapsed:.2f} s "
+              f"({image_size / elapsed / 1024:.1f} KiB/s)")
+
+    def enter_bootloader(self):
+        """Restarts the application in the bootloader update mode with the 'B' command."""
+        self.ser.reset_input_buffer()
+        self.ser.write(self.encode_command('B'))
+
+    def wait_for_bootloader(self, timeout=3.0):
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            line = self.ser.readline().decode('ascii', errors='ignore').strip()
+            if line:
+                print(f"Received: {line}")
+            if "Update mode" in line:
+                print("Bootloader detected, ready to upload.")
+                return True
+        return False
+
     def close(self):
         self.ser.close()
 
@@ -70,8 +140,12 @@ if __name__ == '__main__':
         sys.exit(1)
 
     file_path = sys.argv[1]
-    
+
     uploader = ProtocolUploader('/dev/ttyUSB0')  # Update with your actual serial port
-    uploader.wait_for_bootloader()
+    uploader.enter_bootloader()
+    if not uploader.wait_for_bootloader():
+        print("Bootloader not responding, power the device up with the test switch held.")
+        if not uploader.wait_for_bootloader(timeout=60.0):
+            sys.exit(1)
     uploader.upload_file(file_path)
     uploader.close()
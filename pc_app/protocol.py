@@ -1,8 +1,11 @@
 import base64
+import struct
 from typing import Generic, TypeVar, Union, Optional
 from widgets.user_settings import UserSettings
 from widgets.channel_settings import ChannelSettings
 from widgets.monitoring_data import MonitoringData
+from widgets.event_log import EventLogFrame
+from widgets.sample_log import SampleLogFrame
 
 # Generic types for input and output data
 DataInType = TypeVar('DataInType')
@@ -79,13 +82,13 @@ class AppProtocol:
     def getLogs(self):
         return self.uart.getLogs()
     
-    def scanI2c(self, address, fnc):
+    def scanI2c(self, address, fnc, bus=0):
         if not self.uart.isOpen():
             fnc(False)
             return
 
         try:
-            cmd_str = self.protocol.InData(cmd='s', data=address.to_bytes())
+            cmd_str = self.protocol.InData(cmd='s', data=address.to_bytes() + bus.to_bytes())
             encoded_cmd = self.protocol.encode_output(cmd_str)
         
             # Send and receive response, call fnc depending on whether response is None
@@ -168,6 +171,94 @@ class AppProtocol:
         except:
             fnc(False)
         
+    def commitSettings(self, fnc=None):
+        if fnc == None:
+            fnc = lambda x: x
+        if not self.uart.isOpen():
+            fnc(False)
+            return
+        try:
+            cmd_str = self.protocol.InData(cmd='W')
+            encoded_cmd = self.protocol.encode_output(cmd_str)
+
+            self.uart.send_receive(encoded_cmd, lambda response: (
+                fnc(bool().from_bytes(self.protocol.decode_response(response)))
+            ))
+
+        except:
+            fnc(False)
+
+    def readEventLog(self, seq, fnc):
+        if not self.uart.isOpen():
+            fnc(None)
+            return
+
+        try:
+            cmd_str = self.protocol.InData(cmd='e', data=seq.to_bytes(4, 'little'))
+            encoded_cmd = self.protocol.encode_output(cmd_str)
+
+            self.uart.send_receive(encoded_cmd, lambda response: (
+                fnc(EventLogFrame().fromByteArray(self.protocol.decode_response(response))) if len(response) != 0
+                else fnc(None)
+            ))
+
+        except:
+            fnc(None)
+
+    def downloadEventLog(self, fnc, progress=None):
+        records = []
+
+        def onFrame(frame):
+            if frame is None:
+                fnc(None)
+                return
+            records.extend(frame.records)
+            if progress:
+                progress(frame.cont - frame.first, frame.next - frame.first)
+            if frame.cont == frame.next:
+                fnc(records)
+            else:
+                self.readEventLog(frame.cont, onFrame)
+
+        # Sequence number 0xFFFFFFFF is outside of the log, the device starts from the oldest record
+        self.readEventLog(0xFFFFFFFF, onFrame)
+
+    def readSampleLog(self, seq, fnc):
+        if not self.uart.isOpen():
+            fnc(None)
+            return
+
+        try:
+            cmd_str = self.protocol.InData(cmd='a', data=seq.to_bytes(4, 'little'))
+            encoded_cmd = self.protocol.encode_output(cmd_str)
+
+            self.uart.send_receive(encoded_cmd, lambda response: (
+                fnc(SampleLogFrame().fromByteArray(self.protocol.decode_response(response))) if len(response) != 0
+                else fnc(None)
+            ))
+
+        except:
+            fnc(None)
+
+    def downloadSampleLog(self, fnc, progress=None):
+        blocks = []
+
+        def onFrame(frame):
+            if frame is None:
+                fnc(None)
+                return
+            if frame.block:
+                blocks.append(frame.block)
+            if progress:
+                progress(frame.cont - frame.first, frame.next - frame.first)
+            if frame.cont == frame.next:
+                fnc(blocks)
+            else:
+                self.readSampleLog(frame.cont, onFrame)
+
+        # Sequence number 0xFFFFFFFF is outside of the log, the device starts from the oldest block
+        self.readSampleLog(0xFFFFFFFF, onFrame)
+
     def getMonitoringData(self, channel, fnc):
         monitoringData = MonitoringData()
         if not self.uart.isOpen():
@@ -187,13 +278,13 @@ class AppProtocol:
         except:
             fnc(monitoringData)
             
-    def testRelays(self, pcf_addr, pcf_channel, ina_addr, fnc):
+    def testRelays(self, pcf_addr, pcf_channel, ina_addr, fnc, bus=0):
         print("Protocol: test relays, pcf_addr:", pcf_addr, " pcf_channel:", pcf_channel, " ina_addr:", ina_addr)
         if not self.uart.isOpen():
             fnc(False)
         
         try:
-            cmd_str = self.protocol.InData(cmd='t', data=ina_addr.to_bytes(1)+pcf_addr.to_bytes(1)+pcf_channel.to_bytes(1))
+            cmd_str = self.protocol.InData(cmd='t', data=ina_addr.to_bytes(1)+pcf_addr.to_bytes(1)+pcf_channel.to_bytes(1)+bus.to_bytes(1))
             encoded_cmd = self.protocol.encode_output(cmd_str)
         
             # Send and receive response, call fnc depending on whether response is None
@@ -220,19 +311,148 @@ class AppProtocol:
         except:
             fnc(False)
         
-    def uploadFirmware(self, fnc, data, ptr, len):
+    def getMemoryUsage(self, fnc):
+        """Reads the RAM usage ('M' command), fnc receives a dict or None."""
         if not self.uart.isOpen():
-            fnc(False)
-        
+            fnc(None)
+            return
+
+        fields = ('staticSize', 'stackSize', 'stackPeak', 'txSize', 'txPeak', 'rxSize', 'rxPeak')
         try:
-            cmd_str = self.protocol.InData(cmd='u')
-            encoded_cmd = self.protocol.encode_output(cmd_str, data=ptr.to_bytes(2)+len.to_bytes(2)+data)
-        
-            # Send and receive response, call fnc depending on whether response is None
-            self.uart.send_receive(encoded_cmd, lambda response: (
-                fnc(bool().from_bytes(self.protocol.decode_response(response)))
+            cmd_str = self.protocol.InData(cmd='M')
+            encoded_cmd = self.protocol.encode_output(cmd_str)
+            self.uart.send_receive(encoded_cmd, lambda response: fnc(
+                dict(zip(fields, struct.unpack('<IIIHHHH', self.protocol.decode_response(response))))
+                if len(response) != 0 else None
             ))
 
+        except:
+            fnc(None)
+
+    def readProfileZone(self, zone, reset, fnc):
+        """Reads the execution time statistics of a zone ('p' command), fnc receives a dict or None."""
+        if not self.uart.isOpen():
+            fnc(None)
+            return
+
+        def decode(data):
+            values = struct.unpack('<IIIII8HBB2x', data)
+            frequency = values[0]
+            return {
+                'zone': values[14],
+                'zones': values[13],
+                'count': values[1],
+                'min_us': values[2] * 1e6 / frequency,
+                'max_us': values[3] * 1e6 / frequency,
+                'avg_us': values[4] * 1e6 / frequency,
+                'histogram': list(values[5:13]),
+            }
+
+        try:
+            cmd_str = self.protocol.InData(cmd='p', data=bytes([zone, int(reset)]))
+            encoded_cmd = self.protocol.encode_output(cmd_str)
+            self.uart.send_receive(encoded_cmd, lambda response: fnc(
+                decode(self.protocol.decode_response(response)) if len(response) != 0 else None
+            ))
+
+        except:
+            fnc(None)
+
+    def getProfile(self, fnc, reset=False):
+        """Reads the statistics of all profiled zones, fnc receives a list of dicts or None."""
+        zones = []
+
+        def onZone(stats):
+            if stats is None:
+                fnc(None)
+                return
+            zones.append(stats)
+            if len(zones) == stats['zones']:
+                fnc(zones)
+            else:
+                # The statistics are cleared after reading the last zone
+                self.readProfileZone(len(zones), reset and len(zones) + 1 == stats['zones'], onZone)
+
+        self.readProfileZone(0, False, onZone)
+
+    def getIdleStats(self, fnc):
+        """Reads the CPU idle statistics ('i' command), fnc receives a dict or None."""
+        if not self.uart.isOpen():
+            fnc(None)
+            return
+
+        def decode(data):
+            uptime, idle, min_idle = struct.unpack('<IHH', data)
+            return {'uptime_s': uptime / 1000, 'idle_pct': idle / 10, 'min_idle_pct': min_idle / 10}
+
+        try:
+            cmd_str = self.protocol.InData(cmd='i')
+            encoded_cmd = self.protocol.encode_output(cmd_str)
+            self.uart.send_receive(encoded_cmd, lambda response: fnc(
+                decode(self.protocol.decode_response(response)) if len(response) != 0 else None
+            ))
+
+        except:
+            fnc(None)
+
+    def getDeviceInfo(self, fnc):
+        """Reads the number of channels and I2C buses ('n' command), fnc receives a dict or None."""
+        if not self.uart.isOpen():
+            fnc(None)
+            return
+
+        def decode(data):
+            channels, buses = struct.unpack('<BB', data)
+            return {'channels': channels, 'buses': buses}
+
+        try:
+            cmd_str = self.protocol.InData(cmd='n')
+            encoded_cmd = self.protocol.encode_output(cmd_str)
+            self.uart.send_receive(encoded_cmd, lambda response: fnc(
+                decode(self.protocol.decode_response(response)) if len(response) != 0 else None
+            ))
+
+        except:
+            fnc(None)
+
+    def getI2cSpeed(self, fnc, bus=0, addr=0, speed=0):
+        """Reads the clock speed of an I2C bus and the speed negotiated with a device ('S' command).
+
+        A non-zero speed [Hz] sets the bus speed until the next reset, the devices of the
+        channels on the bus are probed again. fnc receives a dict or None.
+        """
+        if not self.uart.isOpen():
+            fnc(None)
+            return
+
+        def decode(data):
+            bus_speed, device_speed = struct.unpack('<II', data)
+            return {'bus_speed': bus_speed, 'device_speed': device_speed}
+
+        try:
+            cmd_str = self.protocol.InData(cmd='S', data=struct.pack('<IBB', speed, bus, addr))
+            encoded_cmd = self.protocol.encode_output(cmd_str)
+            self.uart.send_receive(encoded_cmd, lambda response: fnc(
+                decode(self.protocol.decode_response(response)) if len(response) != 0 else None
+            ))
+
+        except:
+            fnc(None)
+
+    def setI2cSpeed(self, speed, fnc, bus=0):
+        """Sets the clock speed of an I2C bus [Hz] until the next reset, fnc receives a dict or None."""
+        self.getI2cSpeed(fnc, bus=bus, speed=speed)
+
+    def enterBootloader(self, fnc):
+        """Restarts the device in the bootloader update mode, the device resets without a response."""
+        if not self.uart.isOpen():
+            fnc(False)
+            return
+
+        try:
+            cmd_str = self.protocol.InData(cmd='B')
+            encoded_cmd = self.protocol.encode_output(cmd_str)
+            self.uart.send_receive(encoded_cmd, lambda response: fnc(True))
+
         except:
             fnc(False)
-        
\ No newline at end of file
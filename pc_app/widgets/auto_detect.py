@@ -212,6 +212,8 @@ class AutoDetect:
                 s.values['min_voltage_limit'] = 80
                 s.values['max_current_limit'] = 50
                 s.values['min_current_limit'] = 0
+                s.values['max_move_time'] = 300
+                s.values['min_move_time'] = 0
                 s.values['ina_calibration'] = 50
                 s.values['enable'] = True
                 self.channel_settings_table.addData(idx)
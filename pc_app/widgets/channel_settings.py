@@ -14,6 +14,7 @@ class ChannelSettings:
         self.values['inverse_down_limit_switch'] = False
         self.values['inverse_limit_switch'] = False
         self.values['rudder'] = False
+        self.values['bus'] = 0
         self.values['ina_addr'] = 0
         self.values['ina_calibration'] = 0
         self.values['pcf_addr'] = 0
@@ -22,6 +23,8 @@ class ChannelSettings:
         self.values['min_voltage_limit'] = 0
         self.values['max_current_limit'] = 0
         self.values['min_current_limit'] = 0
+        self.values['max_move_time'] = 0
+        self.values['min_move_time'] = 0
 
     def get(self, key):
         return self.values.get(key, '')
@@ -38,13 +41,14 @@ class ChannelSettings:
             (self.values['inverse_up_limit_switch'] << 3) |
             (self.values['inverse_down_limit_switch'] << 4) |
             (self.values['inverse_limit_switch'] << 5) |
-            (self.values['rudder'] << 6)
+            (self.values['rudder'] << 6) |
+            ((self.values['bus'] & 1) << 7)
         )
 
         # Pack all values into a byte array using struct.pack
         # '<' means little-endian, 'B' is for uint8_t and 'H' is for uint16_t
         packed_data = struct.pack(
-            '<B B H B B H H H H', 
+            '<B B H B B H H H H H H', 
             bit_fields,                         # 1st byte for bitfields
             self.values['ina_addr'],            # 2nd byte
             self.values['ina_calibration'],     # 3rd and 4th byte
@@ -53,14 +57,16 @@ class ChannelSettings:
             self.values['max_voltage_limit'],   # 7th and 8th byte
             self.values['min_voltage_limit'],   # 9th and 10th byte
             self.values['max_current_limit'],   # 11th and 12th byte
-            self.values['min_current_limit']    # 13th and 14th byte
+            self.values['min_current_limit'],   # 13th and 14th byte
+            self.values['max_move_time'],       # 15th and 16th byte
+            self.values['min_move_time']        # 17th and 18th byte
         )
 
         return packed_data
 
     def fromByteArray(self, data):
         # Unpack the byte array into individual fields
-        unpacked_data = struct.unpack('<BBHBBHHHH', data)
+        unpacked_data = struct.unpack('<BBHBBHHHHHH', data)
 
         # Extract the bitfields from the first byte
         bit_fields = unpacked_data[0]
@@ -71,6 +77,7 @@ class ChannelSettings:
         self.values['inverse_down_limit_switch'] = bool(bit_fields & (1 << 4))
         self.values['inverse_limit_switch'] = bool(bit_fields & (1 << 5))
         self.values['rudder'] = bool(bit_fields & (1 << 6))
+        self.values['bus'] = (bit_fields >> 7) & 1
 
         # Set the remaining fields
         self.values['ina_addr'] = unpacked_data[1]
@@ -81,6 +88,8 @@ class ChannelSettings:
         self.values['min_voltage_limit'] = unpacked_data[6]
         self.values['max_current_limit'] = unpacked_data[7]
         self.values['min_current_limit'] = unpacked_data[8]
+        self.values['max_move_time'] = unpacked_data[9]
+        self.values['min_move_time'] = unpacked_data[10]
         
             # Adding the __str__ method for human-readable output
     def __str__(self):
@@ -93,6 +102,7 @@ class ChannelSettings:
             f"  inverse_down_limit_switch: {self.values['inverse_down_limit_switch']}\n"
             f"  inverse_limit_switch: {self.values['inverse_limit_switch']}\n"
             f"  rudder: {self.values['rudder']}\n"
+            f"  bus: I2C{self.values['bus'] + 1}\n"
             f"  ina_addr: 0x{self.values['ina_addr']:02X}\n"
             f"  ina_calibration: {self.values['ina_calibration']}\n"
             f"  pcf_addr: 0x{self.values['pcf_addr']:02X}\n"
@@ -101,4 +111,6 @@ class ChannelSettings:
             f"  min_voltage_limit: {self.values['min_voltage_limit']} (0.1V units)\n"
             f"  max_current_limit: {self.values['max_current_limit']} (0.1A units)\n"
             f"  min_current_limit: {self.values['min_current_limit']} (0.1A units)\n"
+            f"  max_move_time: {self.values['max_move_time']} (0.1s units)\n"
+            f"  min_move_time: {self.values['min_move_time']} (0.1s units)\n"
         )
\ No newline at end of file
@@ -39,6 +39,7 @@ class ChannelSettingsTable(tk.Frame):
             'inverse_down_limit_switch',
             'inverse_limit_switch',
             'rudder',
+            'bus',
             'ina_addr',
             'ina_calibration',
             'pcf_addr',
@@ -46,7 +47,9 @@ class ChannelSettingsTable(tk.Frame):
             'max_voltage_limit',
             'min_voltage_limit',
             'max_current_limit',
-            'min_current_limit'
+            'min_current_limit',
+            'max_move_time',
+            'min_move_time'
         ]
         self.tree['columns'] = column_names  # Include an index column
         self.tree['show'] = "headings"
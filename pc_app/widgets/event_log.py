@@ -0,0 +1,75 @@
+import struct
+
+# Simulating the EventType enum from C++
+class EventType:
+    BOOT = 0
+    STATE = 1
+    ERRORS = 2
+    WARNINGS = 3
+    MOVEMENT = 4
+
+STATE_NAMES = ['UP', 'DOWN', 'MOVING', 'ERROR']
+
+ERROR_NAMES = ['NONE', 'OPEN_CIRCUIT', 'SHORT_CIRCUIT', 'TIME_EXCEEDED', 'PCF_COMMUNICATION_ISSUE',
+               'INA_COMMUNICATION_ISSUE', 'ENDSTOP_SHORT_CIRCUIT', 'RELAYS_ISSUE']
+
+WARNING_NAMES = ['LOW_MOTOR_IMPEDANCE', 'HIGH_MOTOR_IMPEDANCE', 'LOW_POWER_VOLTAGE', 'HIGH_POWER_VOLTAGE',
+                 'SHORT_MOVEMENT_TIME']
+
+class EventRecord:
+    # uint32_t seq, uint32_t time, uint16_t value[3], uint8_t type, uint8_t channel
+    FORMAT = '<II3HBB'
+    SIZE = struct.calcsize(FORMAT)
+
+    def __init__(self, data):
+        self.seq, self.time, v0, v1, v2, self.type, self.channel = struct.unpack(self.FORMAT, data)
+        self.value = [v0, v1, v2]
+
+    def getTypeName(self):
+        names = ['BOOT', 'STATE', 'ERRORS', 'WARNINGS', 'MOVEMENT']
+        return names[self.type] if self.type < len(names) else 'UNKNOWN'
+
+    def getDescription(self):
+        if self.type == EventType.STATE:
+            return f"{self._stateName(self.value[0])} -> {self._stateName(self.value[1])}"
+        elif self.type == EventType.ERRORS:
+            return f"{self._maskNames(self.value[1], ERROR_NAMES)} (was {self._maskNames(self.value[0], ERROR_NAMES)})"
+        elif self.type == EventType.WARNINGS:
+            return f"{self._maskNames(self.value[1], WARNING_NAMES)} (was {self._maskNames(self.value[0], WARNING_NAMES)})"
+        elif self.type == EventType.MOVEMENT:
+            return f"duration {self.value[0] * 0.01:.2f} s, current {self.value[1] * 0.001:.3f}-{self.value[2] * 0.001:.3f} A"
+        return ''
+
+    def toCsv(self):
+        channel = '' if self.channel == 0xFF else str(self.channel)
+        return f"{self.seq},{self.time * 0.001:.3f},{self.getTypeName()},{channel},\"{self.getDescription()}\""
+
+    @staticmethod
+    def _stateName(state):
+        return STATE_NAMES[state] if state < len(STATE_NAMES) else 'UNKNOWN'
+
+    @staticmethod
+    def _maskNames(mask, names):
+        active = [name for bit, name in enumerate(names) if mask & (1 << bit)]
+        return '|'.join(active) if active else '-'
+
+class EventLogFrame:
+    # uint32_t first, uint32_t next, uint32_t cont, uint8_t count, 3 bytes padding
+    HEADER_FORMAT = '<IIIB3x'
+    HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+
+    def __init__(self):
+        self.first = 0
+        self.next = 0
+        self.cont = 0
+        self.records = []
+
+    def fromByteArray(self, data):
+        self.first, self.next, self.cont, count = struct.unpack(self.HEADER_FORMAT, data[:self.HEADER_SIZE])
+        self.records = []
+        for i in range(count):
+            offset = self.HEADER_SIZE + i * EventRecord.SIZE
+            self.records.append(EventRecord(data[offset:offset + EventRecord.SIZE]))
+        return self
+
+CSV_HEADER = "seq,time [s],type,channel,description"
@@ -65,8 +65,8 @@ class FirmwareUpload:
                 print("reset callback")
                 self.wait_for_bootloader()
 
-            self.update_progress("Resetting device...")
-            self.protocol.reset(callback)
+            self.update_progress("Starting bootloader...")
+            self.protocol.enterBootloader(callback)
         except Exception as e:
             print(f"Error resetting device: {e}")
             self.reportError(f"Error resetting device: {e}")
@@ -3,10 +3,15 @@ try:
     import tkinter as tk
     from tkinter.ttk import *
     import tkinter.scrolledtext as scrolledtext
+    from tkinter import filedialog
 except ImportError:
     # python 2.x
     import Tkinter as tk
     import Tkinter.scrolledtext as scrolledtext
+    import tkFileDialog as filedialog
+
+from widgets.event_log import CSV_HEADER
+from widgets.sample_log import CSV_HEADER as SAMPLES_CSV_HEADER, getCompressionRatio
 
 class LogsFrameWidget(tk.Frame):
     def __init__(self, parent, app_protocol):
@@ -25,9 +30,15 @@ class LogsFrameWidget(tk.Frame):
         self.log.config(state=tk.DISABLED)
         self.log.grid(row=1, column=0, sticky="nsew", padx=10)  # Add horizontal padding with padx=10
         
-        # Clear button positioned under the Text widget
-        self.clear_button = tk.Button(self, text="Clear", command=self.clean_log)
-        self.clear_button.grid(row=2, column=0)
+        # Buttons positioned under the Text widget
+        self.buttons = tk.Frame(self)
+        self.buttons.grid(row=2, column=0)
+        self.clear_button = tk.Button(self.buttons, text="Clear", command=self.clean_log)
+        self.clear_button.grid(row=0, column=0)
+        self.download_button = tk.Button(self.buttons, text="Download event log", command=self.download_event_log)
+        self.download_button.grid(row=0, column=1)
+        self.samples_button = tk.Button(self.buttons, text="Download samples", command=self.download_samples)
+        self.samples_button.grid(row=0, column=2)
 
     def update(self):
         self.log.config(state=tk.NORMAL)
@@ -39,3 +50,43 @@ class LogsFrameWidget(tk.Frame):
         self.log.config(state=tk.NORMAL)
         self.log.delete(1.0, 'end')
         self.log.config(state=tk.DISABLED)
+
+    def download_event_log(self):
+        self.download_button.config(state=tk.DISABLED, text="Downloading...")
+        self.app_protocol.downloadEventLog(
+            lambda records: self.after(0, self.save_event_log, records),
+            lambda done, total: self.after(0, self.download_button.config, {'text': f"Downloading {done}/{total}"}))
+
+    def save_event_log(self, records):
+        self.download_button.config(state=tk.NORMAL, text="Download event log")
+        if records is None:
+            return
+        filename = filedialog.asksaveasfilename(defaultextension=".csv", filetypes=[("CSV files", "*.csv")])
+        if not filename:
+            return
+        with open(filename, 'w') as f:
+            f.write(CSV_HEADER + '\n')
+            for record in records:
+                f.write(record.toCsv() + '\n')
+
+    def download_samples(self):
+        self.samples_button.config(state=tk.DISABLED, text="Downloading...")
+        self.app_protocol.downloadSampleLog(
+            lambda blocks: self.after(0, self.save_samples, blocks),
+            lambda done, total: self.after(0, self.samples_button.config, {'text': f"Downloading {done}/{total}"}))
+
+    def save_samples(self, blocks):
+        self.samples_button.config(state=tk.NORMAL, text="Download samples")
+        if blocks is None:
+            return
+        self.log.config(state=tk.NORMAL)
+        self.log.insert("end", f"Downloaded {sum(block.count for block in blocks)} samples, "
+                               f"compression ratio {getCompressionRatio(blocks):.2f}\n")
+        self.log.config(state=tk.DISABLED)
+        filename = filedialog.asksaveasfilename(defaultextension=".csv", filetypes=[("CSV files", "*.csv")])
+        if not filename:
+            return
+        with open(filename, 'w') as f:
+            f.write(SAMPLES_CSV_HEADER + '\n')
+            for block in blocks:
+                f.write(block.toCsv() + '\n')
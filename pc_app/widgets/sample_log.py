@@ -0,0 +1,69 @@
+import struct
+
+def decodeVarint(data, offset):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, offset
+
+def unZigZag(value):
+    return (value >> 1) ^ -(value & 1)
+
+def decodeSamples(data, count, channels):
+    """Decodes samples compressed by DeltaEncoder<channels>, returns a list of tuples."""
+    samples = []
+    previous = [0] * channels
+    offset = 0
+    for _ in range(count):
+        sample = []
+        for i in range(channels):
+            delta, offset = decodeVarint(data, offset)
+            previous[i] += unZigZag(delta)
+            sample.append(previous[i])
+        samples.append(tuple(sample))
+    return samples
+
+class SampleBlock:
+    # uint32_t startTime, uint16_t period, uint8_t channel, uint8_t count, uint8_t size, 3 bytes reserved, uint8_t data[108]
+    FORMAT = '<IHBBB3x108s'
+    SIZE = struct.calcsize(FORMAT)
+    RAW_SAMPLE_SIZE = 4  # uint16_t voltage, int16_t current
+
+    def __init__(self, data):
+        self.startTime, self.period, self.channel, self.count, self.size, payload = struct.unpack(self.FORMAT, data)
+        self.samples = decodeSamples(payload[:self.size], self.count, 2)
+
+    def toCsv(self):
+        lines = []
+        for i, (voltage, current) in enumerate(self.samples):
+            time = (self.startTime + i * self.period) * 0.001
+            lines.append(f"{time:.3f},{self.channel},{voltage * 0.001:.3f},{current * 0.001:.3f}")
+        return '\n'.join(lines)
+
+class SampleLogFrame:
+    # uint32_t first, uint32_t next, uint32_t cont, uint8_t valid, 3 bytes padding
+    HEADER_FORMAT = '<IIIB3x'
+    HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+
+    def __init__(self):
+        self.first = 0
+        self.next = 0
+        self.cont = 0
+        self.block = None
+
+    def fromByteArray(self, data):
+        self.first, self.next, self.cont, valid = struct.unpack(self.HEADER_FORMAT, data[:self.HEADER_SIZE])
+        self.block = SampleBlock(data[self.HEADER_SIZE:self.HEADER_SIZE + SampleBlock.SIZE]) if valid else None
+        return self
+
+def getCompressionRatio(blocks):
+    raw = sum(block.count for block in blocks) * SampleBlock.RAW_SAMPLE_SIZE
+    encoded = sum(block.size for block in blocks)
+    return raw / encoded if encoded else 0
+
+CSV_HEADER = "time [s],channel,voltage [V],current [A]"
@@ -149,7 +149,8 @@ class SettingsFrameWidget(tk.Frame):
         self.user_settings.set('rudder_inactive_color', self.rudder_inactive_color.get_value())
         self.user_settings.set('warning_color', self.warning_color.get_value())
         self.user_settings.set('error_color', self.error_color.get_value())
-        self.protocol.updateUserSettings(self.user_settings)        
+        self.protocol.updateUserSettings(self.user_settings)
+        self.protocol.commitSettings()
 
     def loadDefaultSettings(self):
         # Load default settings
@@ -164,20 +165,26 @@ class SettingsFrameWidget(tk.Frame):
         self.channel_settings_table.display_instructions()
 
     def loadChannelSettings(self):
-        status = [False] * 6
-        def callback(channel_settings, idx):
-            status[idx] = True
-            self.channel_settings_table.addData(idx)
-            self.channel_settings_table.setData(idx, channel_settings) 
-            if all(status):
-                self.channel_settings_table.populate_treeview()
-
-        for i in range(6):
-            self.protocol.getChannelSettings(i, lambda data, idx=i: callback(data, idx))
+        def onDeviceInfo(info):
+            # Devices without the 'n' command have six channels
+            count = info['channels'] if info else 6
+            status = [False] * count
+            def callback(channel_settings, idx):
+                status[idx] = True
+                self.channel_settings_table.addData(idx + 1)
+                self.channel_settings_table.setData(idx, channel_settings)
+                if all(status):
+                    self.channel_settings_table.populate_treeview()
+
+            for i in range(count):
+                self.protocol.getChannelSettings(i, lambda data, idx=i: callback(data, idx))
+
+        self.protocol.getDeviceInfo(onDeviceInfo)
 
     def saveChannelSettings(self):
-        for i in range(6):
+        for i in range(len(self.channel_settings_table.channel_settings_list)):
 
             channel_settings = self.channel_settings_table.getData(i)
             self.protocol.updateChannelSettings(i, channel_settings)
+        self.protocol.commitSettings()
             
\ No newline at end of file
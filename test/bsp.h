@@ -0,0 +1,12 @@
+#ifndef BSP_H
+#define BSP_H
+
+#include <cstdint>
+
+// Host replacement of the board support package, provides the time source of the drivers.
+
+/// @brief Returns the simulated time, defined by the test.
+/// @return The time in milliseconds.
+uint32_t getTime();
+
+#endif // BSP_H
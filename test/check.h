@@ -0,0 +1,15 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdio>
+
+/// @brief Fails the current test, a function returning bool, if the condition does not hold.
+#define CHECK(condition)                                                            \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);    \
+            return false;                                                           \
+        }                                                                           \
+    } while (0)
+
+#endif // CHECK_H
@@ -0,0 +1,41 @@
+"""Decodes the sample blocks written by delta_encoder_test with the decoder of the PC application.
+
+Usage: check_sample_blocks.py <blocks.bin>
+
+The file holds the number of blocks (uint32_t), the SampleBlock structures and the original
+samples (int32_t voltage and current), the decoded samples have to match them.
+"""
+import os
+import struct
+import sys
+
+sys.dont_write_bytecode = True  # keep the source tree clean
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'pc_app', 'widgets'))
+from sample_log import SampleBlock, getCompressionRatio
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__)
+        return 1
+    with open(sys.argv[1], 'rb') as file:
+        data = file.read()
+
+    count, = struct.unpack_from('<I', data)
+    offset = 4
+    blocks = []
+    for _ in range(count):
+        blocks.append(SampleBlock(data[offset:offset + SampleBlock.SIZE]))
+        offset += SampleBlock.SIZE
+    expected = list(struct.iter_unpack('<ii', data[offset:]))
+
+    decoded = [sample for block in blocks for sample in block.samples]
+    if decoded != expected:
+        print(f"Decoded {len(decoded)} samples differ from the {len(expected)} encoded ones")
+        print("Failed")
+        return 1
+    print(f"{len(decoded)} samples in {len(blocks)} blocks, compression ratio {getCompressionRatio(blocks):.2f}")
+    print("Passed")
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,174 @@
+#include "delta_encoder.h"
+#include "sample_log.h"
+#include "check.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr uint16_t cPeriod = 50;    ///< Sample period of the application [ms].
+constexpr size_t cSamples = 400;    ///< Samples of the movement, 20 s.
+constexpr size_t cRawSampleSize = 4; ///< uint16_t voltage and int16_t current.
+
+struct Sample {
+    int32_t voltage; ///< Bus voltage [mV].
+    int32_t current; ///< Motor current [mA].
+};
+
+/// @brief Synthesizes a movement: inrush current with a voltage sag, a noisy steady state,
+/// a reversal and the stall at the end position.
+std::vector<Sample> makeMovement() {
+    std::vector<Sample> samples;
+    uint32_t noise = 12345;
+    for (size_t i = 0; i < cSamples; i++) {
+        noise = noise * 1103515245 + 12345;
+        int32_t jitter = static_cast<int32_t>((noise >> 16) % 21) - 10;
+        double t = i * cPeriod * 0.001;
+        double current = 900 + 2500 * exp(-t / 0.15);
+        if (i >= cSamples / 2) {
+            current = -current; // Reversed direction
+        }
+        if (i >= cSamples - 10) {
+            current = current > 0 ? 4000 : -4000; // Stalled at the limit
+        }
+        Sample sample;
+        sample.current = static_cast<int32_t>(current) + jitter;
+        sample.voltage = 12000 - std::abs(sample.current) / 4 + jitter / 2;
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+/// @brief Records the movement like Application::recordSample, starting a new block when one is full.
+std::vector<SampleBlock> record(const std::vector<Sample> &samples) {
+    std::vector<SampleBlock> blocks;
+    DeltaEncoder<2> encoder;
+    SampleBlock block = {};
+    encoder.reset(block.data, sizeof(block.data));
+
+    for (size_t i = 0; i < samples.size(); i++) {
+        const int32_t sample[] = {samples[i].voltage, samples[i].current};
+        uint32_t time = 1000 + i * cPeriod;
+        if (!encoder.append(sample)) {
+            block.count = encoder.getCount();
+            block.size = encoder.getSize();
+            blocks.push_back(block);
+            block = {};
+            encoder.reset(block.data, sizeof(block.data));
+            encoder.append(sample);
+        }
+        if (encoder.getCount() == 1) {
+            block.startTime = time;
+            block.period = cPeriod;
+        }
+    }
+    block.count = encoder.getCount();
+    block.size = encoder.getSize();
+    blocks.push_back(block);
+    return blocks;
+}
+
+/// @brief Decodes a block, mirrors decodeSamples() of pc_app/widgets/sample_log.py.
+bool decode(const SampleBlock &block, std::vector<Sample> &samples) {
+    int32_t previous[2] = {};
+    size_t offset = 0;
+    for (size_t i = 0; i < block.count; i++) {
+        for (size_t channel = 0; channel < 2; channel++) {
+            uint32_t value = 0;
+            uint8_t byte;
+            size_t shift = 0;
+            do {
+                CHECK(offset < block.size && shift < 35);
+                byte = block.data[offset++];
+                value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            previous[channel] += static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+        }
+        samples.push_back({previous[0], previous[1]});
+    }
+    CHECK(offset == block.size);
+    return true;
+}
+
+bool testZigZagAndVarint() {
+    CHECK(DeltaEncoder<1>::zigZag(0) == 0);
+    CHECK(DeltaEncoder<1>::zigZag(-1) == 1);
+    CHECK(DeltaEncoder<1>::zigZag(1) == 2);
+    CHECK(DeltaEncoder<1>::zigZag(INT32_MIN) == UINT32_MAX);
+    uint8_t out[DeltaEncoder<1>::cMaxVarintSize];
+    CHECK(DeltaEncoder<1>::writeVarint(127, out) == 1);
+    CHECK(DeltaEncoder<1>::writeVarint(128, out) == 2 && out[0] == 0x80 && out[1] == 0x01);
+    CHECK(DeltaEncoder<1>::writeVarint(UINT32_MAX, out) == DeltaEncoder<1>::cMaxVarintSize);
+    return true;
+}
+
+/// @brief A sample which does not fit leaves the buffer unchanged.
+bool testFull() {
+    uint8_t buffer[5] = {};
+    DeltaEncoder<2> encoder;
+    encoder.reset(buffer, sizeof(buffer));
+    const int32_t first[] = {12000, 900};
+    CHECK(encoder.append(first)); // 3 + 2 bytes
+    CHECK(encoder.getSize() == 5 && encoder.getCount() == 1);
+    const int32_t next[] = {12000, 900};
+    CHECK(!encoder.append(next));
+    CHECK(encoder.getSize() == 5 && encoder.getCount() == 1);
+    return true;
+}
+
+bool testMovement() {
+    std::vector<Sample> samples = makeMovement();
+    std::vector<SampleBlock> blocks = record(samples);
+    CHECK(blocks.size() > 1);
+
+    std::vector<Sample> decoded;
+    size_t size = 0;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        // Every block starts with a full sample and continues the time base of the previous one
+        CHECK(blocks[i].count > 0 && blocks[i].size <= sizeof(blocks[i].data));
+        CHECK(blocks[i].startTime == 1000 + decoded.size() * cPeriod);
+        CHECK(decode(blocks[i], decoded));
+        size += blocks[i].size;
+    }
+    CHECK(decoded.size() == samples.size());
+    for (size_t i = 0; i < samples.size(); i++) {
+        CHECK(decoded[i].voltage == samples[i].voltage && decoded[i].current == samples[i].current);
+    }
+
+    double perSample = static_cast<double>(size) / samples.size();
+    printf("%zu samples in %zu blocks: %.2f bytes per sample, %.2f raw, %.1f samples per block\n",
+           samples.size(), blocks.size(), perSample, static_cast<double>(cRawSampleSize),
+           static_cast<double>(samples.size()) / blocks.size());
+    CHECK(perSample < cRawSampleSize);
+    return true;
+}
+
+/// @brief Writes the blocks of the movement followed by its samples, for the decoder of the PC application.
+bool writeMovement(const char *path) {
+    std::vector<Sample> samples = makeMovement();
+    std::vector<SampleBlock> blocks = record(samples);
+    FILE *file = fopen(path, "wb");
+    CHECK(file != nullptr);
+    uint32_t count = blocks.size();
+    bool result = fwrite(&count, sizeof(count), 1, file) == 1 &&
+                  fwrite(blocks.data(), sizeof(SampleBlock), blocks.size(), file) == blocks.size() &&
+                  fwrite(samples.data(), sizeof(Sample), samples.size(), file) == samples.size();
+    fclose(file);
+    CHECK(result);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    bool result = true;
+    result &= testZigZagAndVarint();
+    result &= testFull();
+    result &= testMovement();
+    if (argc > 1) {
+        result &= writeMovement(argv[1]);
+    }
+    printf("%s\n", result ? "Passed" : "Failed");
+    return result ? 0 : 1;
+}
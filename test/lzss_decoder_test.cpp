@@ -0,0 +1,173 @@
+#include "lzss_decoder.h"
+#include "binary_transfer.h"
+#include "ram_flash.h"
+#include "check.h"
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t cImageAddress = 0x5000;                       ///< Flash address of the decoded image.
+constexpr size_t cFrameSize = BinaryTransfer::cMaxChunkSize;     ///< Stream bytes carried by an upload frame.
+constexpr size_t cBufferSize = 256;                              ///< Size of the decoder buffer, see LzssDecoder.
+
+std::vector<uint8_t> image;  ///< The uncompressed image.
+std::vector<uint8_t> stream; ///< Its LZSS stream, without the size header of the .lzss file.
+
+/// @brief A match of the stream.
+struct Match {
+    size_t hiPos;    ///< Position of the second byte of the match in the stream.
+    size_t distance; ///< Distance back in the image.
+};
+
+bool readFile(const char *path, std::vector<uint8_t> &data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        printf("Cannot open %s\n", path);
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+/// @brief Lists the matches of the stream, parsing it like tools/lzss_pack.py.
+std::vector<Match> findMatches() {
+    std::vector<Match> matches;
+    size_t pos = 0;
+    size_t written = 0;
+    while (written < image.size() && pos < stream.size()) {
+        uint8_t flags = stream[pos++];
+        for (int bit = 0; bit < 8 && written < image.size() && pos < stream.size(); bit++) {
+            if (flags & (1 << bit)) {
+                pos++;
+                written++;
+            } else {
+                uint8_t lo = stream[pos];
+                uint8_t hi = stream[pos + 1];
+                matches.push_back({pos + 1, (lo | static_cast<size_t>(hi >> 4) << 8) + 1});
+                pos += 2;
+                written += (hi & 0x0F) + LzssDecoder::cMinMatch;
+            }
+        }
+    }
+    return matches;
+}
+
+/// @brief Decodes the stream split at the given positions and compares the result with the image.
+bool decodeSplit(RamFlash &flash, const std::vector<size_t> &splits) {
+    LzssDecoder decoder(flash);
+    decoder.begin(cImageAddress, image.size());
+    size_t start = 0;
+    for (size_t i = 0; i <= splits.size(); i++) {
+        size_t end = i < splits.size() ? splits[i] : stream.size();
+        CHECK(decoder.decode(stream.data() + start, end - start));
+        start = end;
+    }
+    CHECK(decoder.finish());
+    CHECK(std::equal(image.begin(), image.end(), flash.getMemory().begin() + cImageAddress));
+    CHECK(flash.getMemory()[cImageAddress + image.size()] == 0xFF);
+    return true;
+}
+
+/// @brief Decodes the stream in upload frames like the bootloader.
+bool testFrames() {
+    std::vector<size_t> splits;
+    for (size_t pos = cFrameSize; pos < stream.size(); pos += cFrameSize) {
+        splits.push_back(pos);
+    }
+    RamFlash flash(cImageAddress + image.size() + 1);
+    CHECK(decodeSplit(flash, splits));
+    // Matches behind the decoder buffer were read back from the programmed image
+    CHECK(flash.getReads() > 0);
+    return true;
+}
+
+/// @brief Splits the stream between both bytes of a match which is read back from flash.
+bool testMatchAcrossFrames() {
+    std::vector<Match> matches = findMatches();
+    const Match *far = nullptr;
+    for (const Match &match : matches) {
+        if (match.distance > cBufferSize) {
+            far = &match;
+            break;
+        }
+    }
+    CHECK(far != nullptr);
+    RamFlash flash(cImageAddress + image.size() + 1);
+    CHECK(decodeSplit(flash, {far->hiPos}));
+    CHECK(flash.getReads() > 0);
+
+    // Every match spans a frame boundary when the stream arrives byte by byte
+    std::vector<size_t> splits;
+    for (size_t pos = 1; pos < stream.size(); pos++) {
+        splits.push_back(pos);
+    }
+    RamFlash byteFlash(cImageAddress + image.size() + 1);
+    CHECK(decodeSplit(byteFlash, splits));
+    return true;
+}
+
+/// @brief Checks that the decoder programs full buffers and the unaligned rest in finish().
+bool testFinalFlush() {
+    RamFlash flash(cImageAddress + image.size() + 1);
+    LzssDecoder decoder(flash);
+    decoder.begin(cImageAddress, image.size());
+    CHECK(decoder.decode(stream.data(), stream.size()));
+    size_t rest = image.size() % cBufferSize;
+    CHECK(flash.getWrites().size() == image.size() / cBufferSize);
+    CHECK(decoder.finish());
+
+    const std::vector<RamFlash::Write> &writes = flash.getWrites();
+    CHECK(writes.size() == (image.size() + cBufferSize - 1) / cBufferSize);
+    for (size_t i = 0; i < writes.size(); i++) {
+        CHECK(writes[i].address == cImageAddress + i * cBufferSize);
+    }
+    CHECK(writes.back().size == (rest != 0 ? rest : cBufferSize));
+    CHECK(std::equal(image.begin(), image.end(), flash.getMemory().begin() + cImageAddress));
+    return true;
+}
+
+/// @brief Checks that an incomplete or overlong stream is rejected.
+bool testCorruptedStream() {
+    RamFlash truncatedFlash(cImageAddress + image.size() + 1);
+    LzssDecoder truncated(truncatedFlash);
+    truncated.begin(cImageAddress, image.size());
+    CHECK(truncated.decode(stream.data(), stream.size() - 2));
+    CHECK(!truncated.finish());
+
+    // The image ends before the stream
+    RamFlash shortFlash(cImageAddress + image.size() + 1);
+    LzssDecoder shortImage(shortFlash);
+    shortImage.begin(cImageAddress, image.size() - 1);
+    CHECK(!shortImage.decode(stream.data(), stream.size()));
+    return true;
+}
+
+} // namespace
+
+/// @brief Decodes the .lzss file of tools/lzss_pack.py and compares the result with the .bin file.
+///
+/// Usage: lzss_decoder_test <image.bin> <image.lzss>
+int main(int argc, char **argv) {
+    std::vector<uint8_t> packed;
+    if (argc != 3 || !readFile(argv[1], image) || !readFile(argv[2], packed) || packed.size() < 4) {
+        printf("Usage: lzss_decoder_test <image.bin> <image.lzss>\n");
+        return 1;
+    }
+    uint32_t size = packed[0] | packed[1] << 8 | packed[2] << 16 | static_cast<uint32_t>(packed[3]) << 24;
+    if (size != image.size()) {
+        printf("The .lzss file holds %u bytes, the .bin file %u\n", static_cast<unsigned>(size),
+               static_cast<unsigned>(image.size()));
+        return 1;
+    }
+    stream.assign(packed.begin() + 4, packed.end());
+
+    bool result = true;
+    result &= testFrames();
+    result &= testMatchAcrossFrames();
+    result &= testFinalFlush();
+    result &= testCorruptedStream();
+    printf("%s\n", result ? "Passed" : "Failed");
+    return result ? 0 : 1;
+}
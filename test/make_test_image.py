@@ -0,0 +1,41 @@
+"""Creates the firmware-like test image of the LZSS decoder test.
+
+Usage: make_test_image.py <output.bin>
+
+The image mixes random runs with repeats of earlier data near by and far back, so its LZSS stream
+has literals and matches of all distances. Its size is odd and not a multiple of the decoder
+buffer, so the last part of the image is programmed unaligned.
+"""
+import random
+import sys
+
+IMAGE_SIZE = 23331
+NEAR_DISTANCE = 255           # matches up to this distance stay in the decoder buffer
+FAR_DISTANCE = (300, 4000)    # matches at these distances are read back from flash
+
+def make_image():
+    """Returns the test image."""
+    rng = random.Random(0x1234)
+    image = bytearray()
+    while len(image) < IMAGE_SIZE:
+        choice = rng.random()
+        if choice < 0.4 or len(image) < FAR_DISTANCE[1]:
+            image += bytes(rng.randrange(256) for _ in range(rng.randrange(8, 64)))
+        else:
+            if choice < 0.7:
+                distance = rng.randrange(*FAR_DISTANCE)
+            else:
+                distance = rng.randrange(1, NEAR_DISTANCE + 1)
+            for _ in range(rng.randrange(3, 40)):
+                image.append(image[-distance])
+    return bytes(image[:IMAGE_SIZE])
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__)
+        sys.exit(1)
+    with open(sys.argv[1], 'wb') as f:
+        f.write(make_image())
+
+if __name__ == '__main__':
+    main()
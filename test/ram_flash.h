@@ -0,0 +1,78 @@
+#ifndef RAM_FLASH_H
+#define RAM_FLASH_H
+
+#include "iflash.h"
+#include <cstring>
+#include <vector>
+
+/// @brief Flash emulated in RAM for the host tests.
+///
+/// Like a NOR flash, erased bytes read as 0xFF and a byte has to be erased before it is
+/// programmed again. The writes are recorded so the tests can check how the data was programmed.
+class RamFlash : public IFlash
+{
+public:
+    /// @brief A recorded write.
+    struct Write {
+        uint32_t address;
+        size_t size;
+    };
+
+    /// @brief Constructs an erased flash.
+    /// @param capacity The size of the flash in bytes.
+    RamFlash(size_t capacity) : mMemory(capacity, 0xFF), mReads(0) {}
+
+    bool erase(uint32_t address, size_t no_sectors) override {
+        address -= address % cSectorSize;
+        if (address + no_sectors * cSectorSize > mMemory.size()) {
+            return false;
+        }
+        memset(&mMemory[address], 0xFF, no_sectors * cSectorSize);
+        return true;
+    }
+
+    bool write(uint32_t address, const uint8_t* data, size_t size) override {
+        if (address + size > mMemory.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < size; i++) {
+            if (mMemory[address + i] != 0xFF) {
+                return false;
+            }
+        }
+        memcpy(&mMemory[address], data, size);
+        mWrites.push_back({address, size});
+        return true;
+    }
+
+    bool read(uint32_t address, uint8_t* data, size_t size) override {
+        if (address + size > mMemory.size()) {
+            return false;
+        }
+        memcpy(data, &mMemory[address], size);
+        mReads++;
+        return true;
+    }
+
+    size_t getSectorSize() override { return cSectorSize; }
+
+    uint32_t getCapacity() override { return mMemory.size(); }
+
+    /// @brief Returns the content of the flash.
+    const std::vector<uint8_t> &getMemory() const { return mMemory; }
+
+    /// @brief Returns the writes in the order they were carried out.
+    const std::vector<Write> &getWrites() const { return mWrites; }
+
+    /// @brief Returns the number of read() calls.
+    size_t getReads() const { return mReads; }
+
+private:
+    static constexpr size_t cSectorSize = 4096; ///< Size of an erase sector.
+
+    std::vector<uint8_t> mMemory;
+    std::vector<Write> mWrites;
+    size_t mReads;
+};
+
+#endif // RAM_FLASH_H
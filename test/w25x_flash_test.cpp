@@ -0,0 +1,365 @@
+#include "w25x_flash.h"
+#include "bsp.h"
+#include "check.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Typical times of the W25Q datasheets [us], the drivers wait for the maximal ones
+constexpr uint64_t cPageProgramTime = 400;
+constexpr uint64_t cSectorEraseTime = 45000;
+constexpr uint64_t cBlock32KEraseTime = 120000;
+constexpr uint64_t cBlock64KEraseTime = 150000;
+
+// SPI1 runs at 64 MHz / 4, every blocking HAL call costs a few microseconds of setup
+constexpr uint64_t cByteTimeNs = 500;
+constexpr uint64_t cCallTimeNs = 2000;
+// The idle loop of the application calls process() and sleeps for 1 ms
+constexpr uint64_t cLoopPeriodNs = 1000000;
+
+constexpr uint32_t cCapacity = 1024 * 1024;
+constexpr size_t cRange = 64 * 1024; ///< Bytes read, programmed and erased by the benchmarks.
+
+uint64_t gClockNs = 0; ///< Simulated time.
+
+void advance(uint64_t ns) {
+    gClockNs += ns;
+}
+
+/// @brief Simulates a W25Q (with Erase/Program Suspend) or W25X (without) device on the SPI bus.
+///
+/// Commands are decoded per chip select frame and the busy flag is set for the typical
+/// duration of programs and erases. Any command other than a status read, suspend or
+/// resume issued while the device is busy is counted as a violation.
+class FakeW25x : public ISpi
+{
+public:
+    explicit FakeW25x(bool suspendSupport) : memory(cCapacity, 0xFF), mSuspendSupport(suspendSupport) {}
+
+    bool transmit(const uint8_t *data, size_t len) override {
+        advance(cCallTimeNs + len * cByteTimeNs);
+        if (mFrame.empty() && len > 0) {
+            checkCommand(data[0]);
+        }
+        mFrame.insert(mFrame.end(), data, data + len);
+        return true;
+    }
+
+    bool receive(uint8_t *data, size_t len) override {
+        advance(cCallTimeNs + len * cByteTimeNs);
+        if (mFrame.empty()) {
+            return false;
+        }
+        switch (mFrame[0]) {
+        case 0x05:
+            memset(data, isBusy() ? 0x03 : (mWriteEnabled ? 0x02 : 0x00), len);
+            break;
+        case 0x9F: {
+            const uint8_t id[] = {0xEF, static_cast<uint8_t>(mSuspendSupport ? 0x40 : 0x30), 0x14};
+            memcpy(data, id, std::min(len, sizeof(id)));
+            break;
+        }
+        case 0x0B:
+            for (size_t i = 0; i < len; i++) {
+                data[i] = memory[(getAddress() + i) % cCapacity];
+            }
+            break;
+        default:
+            memset(data, 0xFF, len);
+        }
+        return true;
+    }
+
+    bool transmitReceive(const uint8_t *txData, uint8_t *rxData, size_t len) override {
+        return transmit(txData, len) && receive(rxData, len);
+    }
+
+    /// @brief Executes the command of the frame when the chip select is released.
+    void select(bool selected) {
+        if (selected) {
+            mFrame.clear();
+            return;
+        }
+        if (!mFrame.empty()) {
+            execute();
+        }
+    }
+
+    /// @brief Keeps the device busy until release() is called.
+    void hang() {
+        mBusyUntil = UINT64_MAX;
+    }
+
+    void release() {
+        mBusyUntil = gClockNs;
+    }
+
+    bool isBusy() const {
+        return !mSuspended && gClockNs < mBusyUntil;
+    }
+
+    std::vector<uint8_t> memory;
+    size_t violations = 0; ///< Commands issued while the device was busy.
+
+private:
+    uint32_t getAddress() const {
+        return mFrame.size() >= 4 ? (mFrame[1] << 16) | (mFrame[2] << 8) | mFrame[3] : 0;
+    }
+
+    void checkCommand(uint8_t opcode) {
+        bool allowed = opcode == 0x05 || opcode == 0x75 || opcode == 0x7A || (mSuspended && opcode == 0x0B);
+        if (gClockNs < mBusyUntil && !allowed) {
+            violations++;
+        }
+    }
+
+    void execute() {
+        uint8_t opcode = mFrame[0];
+        switch (opcode) {
+        case 0x06:
+            mWriteEnabled = !isBusy();
+            break;
+        case 0x02:
+            if (mWriteEnabled) {
+                // Page Program wraps around within the page
+                uint32_t address = getAddress();
+                for (size_t i = 4; i < mFrame.size(); i++) {
+                    memory[(address & ~0xFFu) | ((address + i - 4) & 0xFF)] &= mFrame[i];
+                }
+                startOperation(cPageProgramTime);
+            }
+            break;
+        case 0x20:
+            erase(4 * 1024, cSectorEraseTime);
+            break;
+        case 0x52:
+            erase(32 * 1024, cBlock32KEraseTime);
+            break;
+        case 0xD8:
+            erase(64 * 1024, cBlock64KEraseTime);
+            break;
+        case 0x75:
+            if (mSuspendSupport && isBusy()) {
+                mSuspended = true;
+                mRemaining = mBusyUntil - gClockNs;
+            }
+            break;
+        case 0x7A:
+            if (mSuspended) {
+                mSuspended = false;
+                mBusyUntil = gClockNs + mRemaining;
+            }
+            break;
+        }
+    }
+
+    void erase(uint32_t size, uint64_t time) {
+        if (mWriteEnabled) {
+            uint32_t address = getAddress() & ~(size - 1);
+            memset(&memory[address], 0xFF, size);
+            startOperation(time);
+        }
+    }
+
+    void startOperation(uint64_t timeUs) {
+        mWriteEnabled = false;
+        mBusyUntil = gClockNs + timeUs * 1000;
+    }
+
+    std::vector<uint8_t> mFrame;
+    bool mSuspendSupport;
+    bool mWriteEnabled = false;
+    bool mSuspended = false;
+    uint64_t mBusyUntil = 0;
+    uint64_t mRemaining = 0;
+};
+
+/// @brief Chip select pin, active low.
+class FakeCs : public IGpio
+{
+public:
+    explicit FakeCs(FakeW25x &device) : mDevice(device) {}
+
+    void set(bool state) override {
+        mState = state;
+        mDevice.select(!state);
+    }
+
+    bool get() const override { return mState; }
+
+private:
+    FakeW25x &mDevice;
+    bool mState = true;
+};
+
+/// @brief Converts bytes transferred since a start time to MB/s.
+double getRate(size_t bytes, uint64_t startNs) {
+    return bytes * 1e3 / (gClockNs - startNs);
+}
+
+std::vector<uint8_t> makePattern(size_t size, uint8_t seed) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = static_cast<uint8_t>(i * 7 + seed + (i >> 8));
+    }
+    return data;
+}
+
+/// @brief Measures the blocking read, program and erase throughput.
+bool testBlocking() {
+    FakeW25x device(true);
+    FakeCs cs(device);
+    W25xFlash flash(device, cs);
+    CHECK(flash.getCapacity() == cCapacity);
+
+    std::vector<uint8_t> data = makePattern(cRange, 1);
+    uint64_t start = gClockNs;
+    CHECK(flash.write(0, data.data(), data.size()));
+    printf("program:          %6.3f MB/s\n", getRate(cRange, start));
+
+    std::vector<uint8_t> read(cRange);
+    start = gClockNs;
+    for (size_t offset = 0; offset < cRange; offset += 4096) {
+        CHECK(flash.read(offset, &read[offset], 4096));
+    }
+    printf("read (4 KB):      %6.3f MB/s\n", getRate(cRange, start));
+    CHECK(read == data);
+
+    start = gClockNs;
+    for (size_t offset = 0; offset < cRange; offset += 64) {
+        CHECK(flash.read(offset, &read[offset], 64));
+    }
+    printf("read (64 B):      %6.3f MB/s\n", getRate(cRange, start));
+    CHECK(read == data);
+
+    start = gClockNs;
+    CHECK(flash.erase(0, cRange / 4096));
+    printf("erase (64K block): %5.3f MB/s\n", getRate(cRange, start));
+    CHECK(flash.write(0, data.data(), data.size()));
+    start = gClockNs;
+    for (size_t offset = 0; offset < cRange; offset += 4096) {
+        CHECK(flash.sectorErase(offset));
+    }
+    printf("erase (4K sector): %5.3f MB/s\n", getRate(cRange, start));
+    CHECK(flash.read(0, read.data(), read.size()));
+    CHECK(read == std::vector<uint8_t>(cRange, 0xFF));
+    CHECK(device.violations == 0);
+    return true;
+}
+
+/// @brief Measures the queued operations and the longest time process() takes.
+bool testAsync() {
+    FakeW25x device(true);
+    FakeCs cs(device);
+    W25xFlash flash(device, cs);
+
+    // Queue an erase and the writes in 4 KB chunks, like the logs do
+    std::vector<uint8_t> data = makePattern(cRange, 2);
+    uint64_t start = gClockNs;
+    uint64_t longest = 0;
+    size_t queued = 0;
+    CHECK(flash.eraseAsync(0, cRange / 4096));
+    while (flash.isBusy() || queued < cRange) {
+        if (queued < cRange && flash.getQueueSpace() > 0) {
+            CHECK(flash.writeAsync(queued, &data[queued], 4096));
+            queued += 4096;
+        }
+        uint64_t before = gClockNs;
+        flash.process();
+        longest = std::max(longest, gClockNs - before);
+        advance(cLoopPeriodNs);
+    }
+    printf("async erase and program: %6.3f MB/s, process() at most %.1f us\n",
+           getRate(cRange, start), longest / 1e3);
+    // At most the transfer of a page, process() never waits for the device
+    CHECK(longest < 200000);
+
+    std::vector<uint8_t> read(cRange);
+    CHECK(flash.read(0, read.data(), read.size()));
+    CHECK(read == data);
+    CHECK(flash.getErrorCount() == 0);
+    CHECK(device.violations == 0);
+    return true;
+}
+
+/// @brief Reads during a queued erase, suspending it or failing without waiting.
+bool testReadWhileBusy(bool suspendSupport) {
+    FakeW25x device(suspendSupport);
+    FakeCs cs(device);
+    W25xFlash flash(device, cs);
+
+    std::vector<uint8_t> data = makePattern(4096, 3);
+    CHECK(flash.write(0x10000, data.data(), data.size()));
+    CHECK(flash.eraseAsync(0, 1));
+    flash.process();
+    CHECK(device.isBusy());
+
+    std::vector<uint8_t> read(data.size());
+    uint64_t start = gClockNs;
+    bool result = flash.read(0x10000, read.data(), read.size());
+    uint64_t duration = gClockNs - start;
+    printf("read during erase (%s suspend): %s in %.1f us\n", suspendSupport ? "with" : "without",
+           result ? "read" : "failed", duration / 1e3);
+    CHECK(result == suspendSupport);
+    CHECK(!result || read == data);
+    CHECK(duration < 3000000);
+    CHECK(device.isBusy());
+
+    while (flash.isBusy()) {
+        flash.process();
+        advance(cLoopPeriodNs);
+    }
+    CHECK(flash.read(0x10000, read.data(), read.size()));
+    CHECK(read == data);
+    CHECK(device.violations == 0);
+    return true;
+}
+
+/// @brief A device stuck in an erase fails the queued operations and accepts no commands.
+bool testTimeout() {
+    FakeW25x device(false);
+    FakeCs cs(device);
+    W25xFlash flash(device, cs);
+
+    std::vector<uint8_t> data = makePattern(256, 4);
+    CHECK(flash.eraseAsync(0, 1));
+    CHECK(flash.writeAsync(0, data.data(), data.size()));
+    CHECK(flash.writeAsync(256, data.data(), data.size()));
+    flash.process();
+    device.hang();
+    while (flash.isBusy()) {
+        flash.process();
+        advance(cLoopPeriodNs);
+    }
+    CHECK(flash.getErrorCount() == 3);
+    CHECK(!flash.eraseAsync(0, 1));
+    CHECK(!flash.write(0, data.data(), data.size()));
+    CHECK(device.violations == 0);
+
+    device.release();
+    CHECK(flash.write(0, data.data(), data.size()));
+    std::vector<uint8_t> read(data.size());
+    CHECK(flash.read(0, read.data(), read.size()));
+    CHECK(read == data);
+    CHECK(device.violations == 0);
+    return true;
+}
+
+} // namespace
+
+uint32_t getTime() {
+    return static_cast<uint32_t>(gClockNs / 1000000);
+}
+
+int main() {
+    bool result = true;
+    result &= testBlocking();
+    result &= testAsync();
+    result &= testReadWhileBusy(true);
+    result &= testReadWhileBusy(false);
+    result &= testTimeout();
+    printf("%s\n", result ? "Passed" : "Failed");
+    return result ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+#include "ws2812.h"
+#include "check.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr uint8_t cShortPulse = 18; ///< Pulse width of a 0 bit, see Ws2812.
+constexpr uint8_t cLongPulse = 59;  ///< Pulse width of a 1 bit.
+constexpr size_t cResetPeriods = 50;
+
+/// @brief Records the frames passed to the PWM.
+class FakePwm : public IPwmDma
+{
+public:
+    bool start(const uint8_t *data, size_t len) override {
+        frame.assign(data, data + len);
+        frames++;
+        return true;
+    }
+
+    bool isBusy() override { return false; }
+
+    std::vector<uint8_t> frame; ///< Last frame.
+    size_t frames = 0;          ///< Number of started frames.
+};
+
+/// @brief Gamma 2.2 of a color byte, non-zero inputs stay visible.
+uint8_t gamma(unsigned value) {
+    long level = lround(255.0 * pow(value / 255.0, 2.2));
+    return value != 0 && level == 0 ? 1 : static_cast<uint8_t>(level);
+}
+
+/// @brief Decodes a color byte from its 8 pulses, the most significant bit first.
+bool decodeByte(const std::vector<uint8_t> &frame, size_t start, uint8_t &value) {
+    value = 0;
+    for (size_t bit = 0; bit < 8; bit++) {
+        uint8_t pulse = frame[start + bit];
+        CHECK(pulse == cShortPulse || pulse == cLongPulse);
+        value = (value << 1) | (pulse == cLongPulse ? 1 : 0);
+    }
+    return true;
+}
+
+/// @brief Decodes the color of an LED, sent in GRB order.
+bool decodeLed(const std::vector<uint8_t> &frame, size_t led, uint8_t &red, uint8_t &green, uint8_t &blue) {
+    CHECK(decodeByte(frame, led * 24, green));
+    CHECK(decodeByte(frame, led * 24 + 8, red));
+    CHECK(decodeByte(frame, led * 24 + 16, blue));
+    return true;
+}
+
+/// @brief Checks the pulses of every color byte at full brightness.
+bool testExpansion() {
+    FakePwm pwm;
+    Ws2812<1> leds(pwm);
+    for (unsigned value = 0; value < 256; value++) {
+        leds.setColor(0, value, 255 - value, value ^ 0x5A);
+        leds.update();
+        CHECK(pwm.frame.size() == 24 + cResetPeriods);
+        uint8_t red, green, blue;
+        CHECK(decodeLed(pwm.frame, 0, red, green, blue));
+        CHECK(red == gamma(value));
+        CHECK(green == gamma(255 - value));
+        CHECK(blue == gamma(value ^ 0x5A));
+        for (size_t i = 24; i < pwm.frame.size(); i++) {
+            CHECK(pwm.frame[i] == 0);
+        }
+    }
+    return true;
+}
+
+/// @brief Checks that the brightness scales the color bytes before the gamma correction.
+bool testBrightness() {
+    FakePwm pwm;
+    Ws2812<3> leds(pwm);
+    leds.setColor(0, 255, 128, 1);
+    leds.setColor(1, 0x102030);
+    leds.setColor(2, 0xFFFFFF);
+    const unsigned brightnesses[] = {255, 128, 64, 1, 0, 200};
+    for (unsigned brightness : brightnesses) {
+        leds.setBrightness(brightness);
+        leds.update();
+        const unsigned colors[3][3] = {{255, 128, 1}, {0x10, 0x20, 0x30}, {255, 255, 255}};
+        for (size_t led = 0; led < 3; led++) {
+            uint8_t levels[3];
+            CHECK(decodeLed(pwm.frame, led, levels[0], levels[1], levels[2]));
+            for (size_t i = 0; i < 3; i++) {
+                unsigned scaled = (colors[led][i] * brightness + 127) / 255;
+                CHECK(levels[i] == gamma(scaled));
+            }
+        }
+    }
+    // Zero brightness switches the LEDs off
+    leds.setBrightness(0);
+    leds.update();
+    for (size_t i = 0; i < 3 * 24; i++) {
+        CHECK(pwm.frame[i] == cShortPulse);
+    }
+    return true;
+}
+
+/// @brief Checks that a frame is sent only after a color or the brightness changed.
+bool testChanges() {
+    FakePwm pwm;
+    Ws2812<2> leds(pwm);
+    leds.update();
+    CHECK(pwm.frames == 1);
+    leds.update();
+    leds.setColor(0, 0);
+    leds.setBrightness(255);
+    leds.update();
+    CHECK(pwm.frames == 1);
+
+    leds.setColor(1, 0x00FF00);
+    leds.update();
+    CHECK(pwm.frames == 2);
+    uint8_t red, green, blue;
+    CHECK(decodeLed(pwm.frame, 1, red, green, blue));
+    CHECK(red == 0 && green == 255 && blue == 0);
+
+    // A new brightness re-encodes the LEDs whose colors did not change
+    leds.setBrightness(128);
+    leds.update();
+    CHECK(pwm.frames == 3);
+    CHECK(decodeLed(pwm.frame, 1, red, green, blue));
+    CHECK(green == gamma(128));
+    return true;
+}
+
+} // namespace
+
+int main() {
+    bool result = true;
+    result &= testExpansion();
+    result &= testBrightness();
+    result &= testChanges();
+    printf("%s\n", result ? "Passed" : "Failed");
+    return result ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+"""Compares the control loop time and the I2C transfer times at the standard and the fast bus speed.
+
+Usage: i2c_benchmark.py <port> [channel] [requests]
+
+For each speed all buses are set to it with the 'S' command, the profiler is cleared and the
+monitoring data of the channel ('m' command, one readiness check and two register reads of
+the INA219) is requested repeatedly. The control loop keeps running meanwhile. The profiler
+('p' command) then reports the processing time of the commands, the control pass of the loop
+iterations (limit switches of the PCF8574 expanders, all channels and settings commits) and
+the control time of a single channel. The original bus speeds are restored at the end.
+
+Move a channel or toggle its limit switches while measuring to include the transfers of
+moving channels, an idle loop only reads the expanders after an /INT change or once a second.
+"""
+import base64
+import struct
+import sys
+import time
+
+import serial
+
+SPEEDS = (100000, 400000)
+ZONE_CHANNEL = 0
+ZONE_PROTOCOL = 3
+ZONE_LOOP = 6
+# Profile response of the 'p' command, the firmware struct is padded to 40 bytes
+PROFILE_FORMAT = '<IIIII8HBB2x'
+
+class Device:
+    def __init__(self, port, baudrate=115200):
+        self.ser = serial.Serial(port, baudrate, timeout=1.0)
+
+    def command(self, cmd, data=b'', timeout=1.0):
+        frame = bytes([ord(cmd), len(data)]) + data + bytes(2)
+        self.ser.reset_input_buffer()
+        self.ser.write(base64.b64encode(frame) + b'\r')
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            line = self.ser.readline().decode('ascii', errors='ignore').strip()
+            if line and not line.startswith('LOG:'):
+                return base64.b64decode(line)[2:-2]  # excluding cmd, len and CRC
+        raise TimeoutError(f"No response to '{cmd}' command")
+
+    def i2c_speed(self, bus, speed=0, addr=0):
+        return struct.unpack('<II', self.command('S', struct.pack('<IBB', speed, bus, addr)))
+
+    def bus_count(self):
+        _, buses = struct.unpack('<BB', self.command('n'))
+        return buses
+
+    def profile(self, zone, reset=False):
+        values = struct.unpack(PROFILE_FORMAT, self.command('p', bytes([zone, int(reset)])))
+        frequency = values[0]
+        return values[1], values[4] * 1e6 / frequency, values[3] * 1e6 / frequency
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 1
+    port = sys.argv[1]
+    channel = int(sys.argv[2]) if len(sys.argv) > 2 else 0
+    requests = int(sys.argv[3]) if len(sys.argv) > 3 else 200
+
+    device = Device(port)
+    buses = range(device.bus_count())
+    original = [device.i2c_speed(bus)[0] for bus in buses]
+    try:
+        for speed in SPEEDS:
+            for bus in buses:
+                bus_speed, _ = device.i2c_speed(bus, speed)
+            device.profile(0, reset=True)
+            for _ in range(requests):
+                device.command('m', bytes([channel]))
+            count, avg, peak = device.profile(ZONE_PROTOCOL)
+            loops, loop_avg, loop_peak = device.profile(ZONE_LOOP)
+            runs, channel_avg, channel_peak = device.profile(ZONE_CHANNEL)
+            print(f"{bus_speed // 1000} kHz: loop avg {loop_avg:.0f} us, max {loop_peak:.0f} us ({loops} loops); "
+                  f"channel control avg {channel_avg:.0f} us, max {channel_peak:.0f} us ({runs} runs); "
+                  f"command avg {avg:.0f} us, max {peak:.0f} us ({count} commands)")
+    finally:
+        for bus, speed in zip(buses, original):
+            device.i2c_speed(bus, speed)
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,64 @@
+"""Fills in size and CRC of the application image header (see common/sup/image_header.h).
+
+Usage: image_header.py <objcopy> <elf>
+
+The binary image is extracted from the ELF file, the CRC is calculated the same way as by the
+STM32 CRC unit and the updated header is written back into the .image_header section, so the
+hex and bin files created afterwards contain it. Gaps between sections are filled with 0xFF like
+erased flash, the .bin file has to be created with the same GAP_FILL.
+"""
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+IMAGE_MAGIC = 0x46424948
+HEADER_OFFSET = 0x200
+HEADER_FORMAT = '<III32s'
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+GAP_FILL = '0xFF'  # content of erased flash, which a .hex or ELF file leaves in the gaps
+
+def stm32_crc32(data):
+    """CRC-32 of 32-bit little endian words, polynomial 0x04C11DB7, no reflection and final XOR."""
+    crc = 0xFFFFFFFF
+    for (word,) in struct.iter_unpack('<I', data):
+        crc ^= word
+        for _ in range(32):
+            crc = ((crc << 1) ^ 0x04C11DB7) if crc & 0x80000000 else (crc << 1)
+            crc &= 0xFFFFFFFF
+    return crc
+
+def build_header(image):
+    if len(image) % 4 != 0:
+        raise ValueError(f"Image size {len(image)} is not a multiple of 4")
+    magic, _, _, version = struct.unpack_from(HEADER_FORMAT, image, HEADER_OFFSET)
+    if magic != IMAGE_MAGIC:
+        raise ValueError(f"No image header at offset 0x{HEADER_OFFSET:X}")
+
+    header = struct.pack(HEADER_FORMAT, magic, len(image), 0, version)
+    image = image[:HEADER_OFFSET] + header + image[HEADER_OFFSET + HEADER_SIZE:]
+    return struct.pack(HEADER_FORMAT, magic, len(image), stm32_crc32(image), version)
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        sys.exit(1)
+    objcopy, elf = sys.argv[1:]
+
+    with tempfile.TemporaryDirectory() as tmp:
+        binary = os.path.join(tmp, 'image.bin')
+        subprocess.run([objcopy, '-O', 'binary', '--gap-fill', GAP_FILL, elf, binary], check=True)
+        with open(binary, 'rb') as f:
+            header = build_header(f.read())
+
+        section = os.path.join(tmp, 'header.bin')
+        with open(section, 'wb') as f:
+            f.write(header)
+        subprocess.run([objcopy, '--update-section', f'.image_header={section}', elf], check=True)
+
+    magic, size, crc, version = struct.unpack(HEADER_FORMAT, header)
+    print(f"Image {version.rstrip(bytes(1)).decode()}: {size} bytes, CRC 0x{crc:08X}")
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,119 @@
+"""Compresses a firmware image for the bootloader (see bootloader/app/lzss_decoder.h).
+
+Usage: lzss_pack.py <input.bin> <output.lzss>
+
+The output file is the size of the decompressed image (LE32) followed by the LZSS stream.
+The stream is decompressed again and compared with the input before it is written, so every
+build checks that the packer and the format understood by the bootloader match.
+"""
+import struct
+import sys
+
+WINDOW_SIZE = 4096  # maximal match distance
+MIN_MATCH = 3
+MAX_MATCH = MIN_MATCH + 15
+MAX_CHAIN = 256     # number of candidates checked per position
+
+def compress(data):
+    """Returns the LZSS stream of data."""
+    out = bytearray()
+    heads = {}            # last position of each 3-byte prefix
+    prev = [0] * len(data)  # previous position with the same prefix
+    flags_pos = 0
+    items = 8
+    pos = 0
+
+    def insert(i):
+        if i + MIN_MATCH <= len(data):
+            key = data[i:i + MIN_MATCH]
+            prev[i] = heads.get(key, -1)
+            heads[key] = i
+
+    while pos < len(data):
+        if items == 8:
+            flags_pos = len(out)
+            out.append(0)
+            items = 0
+
+        best_len, best_dist = 0, 0
+        if pos + MIN_MATCH <= len(data):
+            candidate = heads.get(data[pos:pos + MIN_MATCH], -1)
+            limit = min(MAX_MATCH, len(data) - pos)
+            for _ in range(MAX_CHAIN):
+                if candidate < 0 or pos - candidate > WINDOW_SIZE:
+                    break
+                length = MIN_MATCH
+                while length < limit and data[candidate + length] == data[pos + length]:
+                    length += 1
+                if length > best_len:
+                    best_len, best_dist = length, pos - candidate
+                    if length == limit:
+                        break
+                candidate = prev[candidate]
+
+        if best_len >= MIN_MATCH:
+            offset = best_dist - 1
+            out += bytes([offset & 0xFF, (offset >> 8) << 4 | (best_len - MIN_MATCH)])
+            for i in range(pos, pos + best_len):
+                insert(i)
+            pos += best_len
+        else:
+            out[flags_pos] |= 1 << items
+            out.append(data[pos])
+            insert(pos)
+            pos += 1
+        items += 1
+
+    return bytes(out)
+
+def decompress(stream, size):
+    """Decodes an LZSS stream the same way as the bootloader."""
+    out = bytearray()
+    pos = 0
+    while len(out) < size:
+        flags = stream[pos]
+        pos += 1
+        for bit in range(8):
+            if len(out) >= size:
+                break
+            if flags & (1 << bit):
+                out.append(stream[pos])
+                pos += 1
+            else:
+                lo, hi = stream[pos], stream[pos + 1]
+                pos += 2
+                distance = (lo | (hi >> 4) << 8) + 1
+                if distance > len(out):
+                    raise ValueError(f"Match distance {distance} before the start of the image")
+                for _ in range((hi & 0x0F) + MIN_MATCH):
+                    out.append(out[-distance])
+    return bytes(out)
+
+def pack(image):
+    """Returns the content of a .lzss file for image."""
+    stream = compress(image)
+    if decompress(stream, len(image)) != image:
+        raise RuntimeError("Round trip of the compressed image failed")
+    return struct.pack('<I', len(image)) + stream
+
+def unpack(packed):
+    """Returns the image size and the LZSS stream of a .lzss file."""
+    (size,) = struct.unpack_from('<I', packed)
+    return size, packed[4:]
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        sys.exit(1)
+    source, target = sys.argv[1:]
+
+    with open(source, 'rb') as f:
+        image = f.read()
+    packed = pack(image)
+    with open(target, 'wb') as f:
+        f.write(packed)
+
+    print(f"Compressed {len(image)} to {len(packed)} bytes ({100 * len(packed) / max(len(image), 1):.0f}%)")
+
+if __name__ == '__main__':
+    main()